@@ -24,13 +24,13 @@ Expr blur121(Expr a, Expr b, Expr c) {
 
 Func interleave_x(Func a, Func b) {
     Func out;
-    out(x, y) = select((x%2)==0, a(x/2, y), b(x/2, y));
+    out(x, y, _) = select((x%2)==0, a(x/2, y, _), b(x/2, y, _));
     return out;
 }
 
 Func interleave_y(Func a, Func b) {
     Func out;
-    out(x, y) = select((y%2)==0, a(x, y/2), b(x, y/2));
+    out(x, y, _) = select((y%2)==0, a(x, y/2, _), b(x, y/2, _));
     return out;
 }
 
@@ -40,9 +40,11 @@ public:
     GeneratorParam<LoopLevel> intermed_store_at{"intermed_store_at", LoopLevel::inlined()};
     GeneratorParam<LoopLevel> output_compute_at{"output_compute_at", LoopLevel::inlined()};
 
-    // Inputs and outputs
-    Input<Func> deinterleaved{ "deinterleaved", Int(16), 3 };
-    Output<Func> output{ "output", Int(16), 3 };
+    // Inputs and outputs. The input is indexed by x, y, channel, followed
+    // by any number of other dimensions (e.g. the frames of a batch), which
+    // the output has too. The output is Int(16), like the input.
+    Input<Func> deinterleaved{ "deinterleaved", Int(16) };
+    Output<Func> output{ "output" };
 
     // Defines outputs using inputs
     void generate() {
@@ -54,10 +56,10 @@ public:
         // Give more convenient names to the four channels we know
         Func r_r, g_gr, g_gb, b_b;
 
-        g_gr(x, y) = deinterleaved(x, y, 0);
-        r_r(x, y)  = deinterleaved(x, y, 1);
-        b_b(x, y)  = deinterleaved(x, y, 2);
-        g_gb(x, y) = deinterleaved(x, y, 3);
+        g_gr(x, y, _) = deinterleaved(x, y, 0, _);
+        r_r(x, y, _)  = deinterleaved(x, y, 1, _);
+        b_b(x, y, _)  = deinterleaved(x, y, 2, _);
+        g_gb(x, y, _) = deinterleaved(x, y, 3, _);
 
         // These are the ones we need to interpolate
         Func b_r, g_r, b_gr, r_gr, b_gb, r_gb, r_b, g_b;
@@ -67,37 +69,37 @@ public:
         // Try interpolating vertically and horizontally. Also compute
         // differences vertically and horizontally. Use interpolation in
         // whichever direction had the smallest difference.
-        Expr gv_r  = avg(g_gb(x, y-1), g_gb(x, y));
-        Expr gvd_r = absd(g_gb(x, y-1), g_gb(x, y));
-        Expr gh_r  = avg(g_gr(x+1, y), g_gr(x, y));
-        Expr ghd_r = absd(g_gr(x+1, y), g_gr(x, y));
+        Expr gv_r  = avg(g_gb(x, y-1, _), g_gb(x, y, _));
+        Expr gvd_r = absd(g_gb(x, y-1, _), g_gb(x, y, _));
+        Expr gh_r  = avg(g_gr(x+1, y, _), g_gr(x, y, _));
+        Expr ghd_r = absd(g_gr(x+1, y, _), g_gr(x, y, _));
 
-        g_r(x, y)  = select(ghd_r < gvd_r, gh_r, gv_r);
+        g_r(x, y, _)  = select(ghd_r < gvd_r, gh_r, gv_r);
 
-        Expr gv_b  = avg(g_gr(x, y+1), g_gr(x, y));
-        Expr gvd_b = absd(g_gr(x, y+1), g_gr(x, y));
-        Expr gh_b  = avg(g_gb(x-1, y), g_gb(x, y));
-        Expr ghd_b = absd(g_gb(x-1, y), g_gb(x, y));
+        Expr gv_b  = avg(g_gr(x, y+1, _), g_gr(x, y, _));
+        Expr gvd_b = absd(g_gr(x, y+1, _), g_gr(x, y, _));
+        Expr gh_b  = avg(g_gb(x-1, y, _), g_gb(x, y, _));
+        Expr ghd_b = absd(g_gb(x-1, y, _), g_gb(x, y, _));
 
-        g_b(x, y)  = select(ghd_b < gvd_b, gh_b, gv_b);
+        g_b(x, y, _)  = select(ghd_b < gvd_b, gh_b, gv_b);
 
         // Next interpolate red at gr by first interpolating, then
         // correcting using the error green would have had if we had
         // interpolated it in the same way (i.e. add the second derivative
         // of the green channel at the same place).
         Expr correction;
-        correction = g_gr(x, y) - avg(g_r(x, y), g_r(x-1, y));
-        r_gr(x, y) = correction + avg(r_r(x-1, y), r_r(x, y));
+        correction = g_gr(x, y, _) - avg(g_r(x, y, _), g_r(x-1, y, _));
+        r_gr(x, y, _) = correction + avg(r_r(x-1, y, _), r_r(x, y, _));
 
         // Do the same for other reds and blues at green sites
-        correction = g_gr(x, y) - avg(g_b(x, y), g_b(x, y-1));
-        b_gr(x, y) = correction + avg(b_b(x, y), b_b(x, y-1));
+        correction = g_gr(x, y, _) - avg(g_b(x, y, _), g_b(x, y-1, _));
+        b_gr(x, y, _) = correction + avg(b_b(x, y, _), b_b(x, y-1, _));
 
-        correction = g_gb(x, y) - avg(g_r(x, y), g_r(x, y+1));
-        r_gb(x, y) = correction + avg(r_r(x, y), r_r(x, y+1));
+        correction = g_gb(x, y, _) - avg(g_r(x, y, _), g_r(x, y+1, _));
+        r_gb(x, y, _) = correction + avg(r_r(x, y, _), r_r(x, y+1, _));
 
-        correction = g_gb(x, y) - avg(g_b(x, y), g_b(x+1, y));
-        b_gb(x, y) = correction + avg(b_b(x, y), b_b(x+1, y));
+        correction = g_gb(x, y, _) - avg(g_b(x, y, _), g_b(x+1, y, _));
+        b_gb(x, y, _) = correction + avg(b_b(x, y, _), b_b(x+1, y, _));
 
         // Now interpolate diagonally to get red at blue and blue at
         // red. Hold onto your hats; this gets really fancy. We do the
@@ -108,26 +110,26 @@ public:
         // sites - we correct our interpolations using the second
         // derivative of green at the same sites.
 
-        correction = g_b(x, y)  - avg(g_r(x, y), g_r(x-1, y+1));
-        Expr rp_b  = correction + avg(r_r(x, y), r_r(x-1, y+1));
-        Expr rpd_b = absd(r_r(x, y), r_r(x-1, y+1));
+        correction = g_b(x, y, _)  - avg(g_r(x, y, _), g_r(x-1, y+1, _));
+        Expr rp_b  = correction + avg(r_r(x, y, _), r_r(x-1, y+1, _));
+        Expr rpd_b = absd(r_r(x, y, _), r_r(x-1, y+1, _));
 
-        correction = g_b(x, y)  - avg(g_r(x-1, y), g_r(x, y+1));
-        Expr rn_b  = correction + avg(r_r(x-1, y), r_r(x, y+1));
-        Expr rnd_b = absd(r_r(x-1, y), r_r(x, y+1));
+        correction = g_b(x, y, _)  - avg(g_r(x-1, y, _), g_r(x, y+1, _));
+        Expr rn_b  = correction + avg(r_r(x-1, y, _), r_r(x, y+1, _));
+        Expr rnd_b = absd(r_r(x-1, y, _), r_r(x, y+1, _));
 
-        r_b(x, y)  = select(rpd_b < rnd_b, rp_b, rn_b);
+        r_b(x, y, _)  = select(rpd_b < rnd_b, rp_b, rn_b);
 
         // Same thing for blue at red
-        correction = g_r(x, y)  - avg(g_b(x, y), g_b(x+1, y-1));
-        Expr bp_r  = correction + avg(b_b(x, y), b_b(x+1, y-1));
-        Expr bpd_r = absd(b_b(x, y), b_b(x+1, y-1));
+        correction = g_r(x, y, _)  - avg(g_b(x, y, _), g_b(x+1, y-1, _));
+        Expr bp_r  = correction + avg(b_b(x, y, _), b_b(x+1, y-1, _));
+        Expr bpd_r = absd(b_b(x, y, _), b_b(x+1, y-1, _));
 
-        correction = g_r(x, y)  - avg(g_b(x+1, y), g_b(x, y-1));
-        Expr bn_r  = correction + avg(b_b(x+1, y), b_b(x, y-1));
-        Expr bnd_r = absd(b_b(x+1, y), b_b(x, y-1));
+        correction = g_r(x, y, _)  - avg(g_b(x+1, y, _), g_b(x, y-1, _));
+        Expr bn_r  = correction + avg(b_b(x+1, y, _), b_b(x, y-1, _));
+        Expr bnd_r = absd(b_b(x+1, y, _), b_b(x, y-1, _));
 
-        b_r(x, y)  =  select(bpd_r < bnd_r, bp_r, bn_r);
+        b_r(x, y, _)  =  select(bpd_r < bnd_r, bp_r, bn_r);
 
         // Resulting color channels
         Func r, g, b;
@@ -140,9 +142,9 @@ public:
         b = interleave_y(interleave_x(b_gr, b_r),
                          interleave_x(b_b, b_gb));
 
-        output(x, y, c) = select(c == 0, r(x, y),
-                                 c == 1, g(x, y),
-                                         b(x, y));
+        output(x, y, c, _) = select(c == 0, r(x, y, _),
+                                    c == 1, g(x, y, _),
+                                            b(x, y, _));
 
         // These are the stencil stages we want to schedule
         // separately. Everything else we'll just inline.
@@ -201,27 +203,36 @@ private:
     vector<Func> intermediates;
 };
 
-class CameraPipe : public Halide::Generator<CameraPipe> {
+// The camera pipe, for one raw frame (input_dims == 2) or for a batch of
+// them (input_dims == 3, with the frame as the last dimension of the input
+// and of the output). The stages are defined with an implicit trailing
+// dimension, so they are the same for both.
+template<typename T, int input_dims>
+class CameraPipeBase : public Halide::Generator<T> {
 public:
     // Parameterized output type, because LLVM PTX (GPU) backend does not
     // currently allow 8-bit computations
     GeneratorParam<Type> result_type{"result_type", UInt(8)};
 
-    Input<Buffer<uint16_t>> input{"input", 2};
-    Input<Buffer<float>> matrix_3200{"matrix_3200", 2};
-    Input<Buffer<float>> matrix_7000{"matrix_7000", 2};
-    Input<float> color_temp{"color_temp"};
-    Input<float> gamma{"gamma"};
-    Input<float> contrast{"contrast"};
-    Input<float> sharpen_strength{"sharpen_strength"};
-    Input<int> blackLevel{"blackLevel"};
-    Input<int> whiteLevel{"whiteLevel"};
+    GeneratorInput<Buffer<uint16_t>> input{"input", input_dims};
+    GeneratorInput<Buffer<float>> matrix_3200{"matrix_3200", 2};
+    GeneratorInput<Buffer<float>> matrix_7000{"matrix_7000", 2};
+    GeneratorInput<float> color_temp{"color_temp"};
+    GeneratorInput<float> gamma{"gamma"};
+    GeneratorInput<float> contrast{"contrast"};
+    GeneratorInput<float> sharpen_strength{"sharpen_strength"};
+    GeneratorInput<int> blackLevel{"blackLevel"};
+    GeneratorInput<int> whiteLevel{"whiteLevel"};
 
-    Output<Buffer<uint8_t>> processed{"processed", 3};
+    GeneratorOutput<Buffer<uint8_t>> processed{"processed", input_dims + 1};
 
     void generate();
 
 private:
+    using Halide::Generator<T>::auto_schedule;
+    using Halide::Generator<T>::get_target;
+
+    static constexpr bool is_batch = input_dims == 3;
 
     Func hot_pixel_suppression(Func input);
     Func deinterleave(Func raw);
@@ -230,31 +241,34 @@ private:
     Func sharpen(Func input);
 };
 
-Func CameraPipe::hot_pixel_suppression(Func input) {
+template<typename T, int input_dims>
+Func CameraPipeBase<T, input_dims>::hot_pixel_suppression(Func input) {
 
-    Expr a = max(input(x - 2, y), input(x + 2, y),
-                 input(x, y - 2), input(x, y + 2));
+    Expr a = max(input(x - 2, y, _), input(x + 2, y, _),
+                 input(x, y - 2, _), input(x, y + 2, _));
 
     Func denoised;
-    denoised(x, y) = clamp(input(x, y), 0, a);
+    denoised(x, y, _) = clamp(input(x, y, _), 0, a);
 
     return denoised;
 }
 
-Func CameraPipe::deinterleave(Func raw) {
+template<typename T, int input_dims>
+Func CameraPipeBase<T, input_dims>::deinterleave(Func raw) {
     // Deinterleave the color channels
     Func deinterleaved("deinterleaved");
 
-    deinterleaved(x, y, c) = select(c == 0, raw(2*x, 2*y),
-                                    c == 1, raw(2*x+1, 2*y),
-                                    c == 2, raw(2*x, 2*y+1),
-                                            raw(2*x+1, 2*y+1));
+    deinterleaved(x, y, c, _) = select(c == 0, raw(2*x, 2*y, _),
+                                       c == 1, raw(2*x+1, 2*y, _),
+                                       c == 2, raw(2*x, 2*y+1, _),
+                                               raw(2*x+1, 2*y+1, _));
     return deinterleaved;
 }
 
 
 
-Func CameraPipe::color_correct(Func input) {
+template<typename T, int input_dims>
+Func CameraPipeBase<T, input_dims>::color_correct(Func input) {
     // Get a color matrix by linearly interpolating between two
     // calibrated matrices using inverse kelvin.
     Expr kelvin = color_temp;
@@ -269,9 +283,9 @@ Func CameraPipe::color_correct(Func input) {
     }
 
     Func corrected;
-    Expr ir = cast<int32_t>(input(x, y, 0));
-    Expr ig = cast<int32_t>(input(x, y, 1));
-    Expr ib = cast<int32_t>(input(x, y, 2));
+    Expr ir = cast<int32_t>(input(x, y, 0, _));
+    Expr ig = cast<int32_t>(input(x, y, 1, _));
+    Expr ib = cast<int32_t>(input(x, y, 2, _));
 
     Expr r = matrix(3, 0) + matrix(0, 0) * ir + matrix(1, 0) * ig + matrix(2, 0) * ib;
     Expr g = matrix(3, 1) + matrix(0, 1) * ir + matrix(1, 1) * ig + matrix(2, 1) * ib;
@@ -280,14 +294,15 @@ Func CameraPipe::color_correct(Func input) {
     r = cast<int16_t>(r/256);
     g = cast<int16_t>(g/256);
     b = cast<int16_t>(b/256);
-    corrected(x, y, c) = select(c == 0, r,
-                                c == 1, g,
-                                        b);
+    corrected(x, y, c, _) = select(c == 0, r,
+                                   c == 1, g,
+                                           b);
 
     return corrected;
 }
 
-Func CameraPipe::apply_curve(Func input) {
+template<typename T, int input_dims>
+Func CameraPipeBase<T, input_dims>::apply_curve(Func input) {
     // copied from FCam
     Func curve("curve");
 
@@ -341,21 +356,22 @@ Func CameraPipe::apply_curve(Func input) {
 
     if (lutResample == 1) {
         // Use clamp to restrict size of LUT as allocated by compute_root
-        curved(x, y, c) = curve(clamp(input(x, y, c), 0, 1023));
+        curved(x, y, c, _) = curve(clamp(input(x, y, c, _), 0, 1023));
     } else {
         // Use linear interpolation to sample the LUT.
-        Expr in = input(x, y, c);
+        Expr in = input(x, y, c, _);
         Expr u0 = in/lutResample;
         Expr u = in%lutResample;
         Expr y0 = curve(clamp(u0, 0, 127));
         Expr y1 = curve(clamp(u0 + 1, 0, 127));
-        curved(x, y, c) = cast<uint8_t>((cast<uint16_t>(y0)*lutResample + (y1 - y0)*u)/lutResample);
+        curved(x, y, c, _) = cast<uint8_t>((cast<uint16_t>(y0)*lutResample + (y1 - y0)*u)/lutResample);
     }
 
     return curved;
 }
 
-Func CameraPipe::sharpen(Func input) {
+template<typename T, int input_dims>
+Func CameraPipeBase<T, input_dims>::sharpen(Func input) {
     // Convert the sharpening strength to 2.5 fixed point. This allows sharpening in the range [0, 4].
     Func sharpen_strength_x32("sharpen_strength_x32");
     sharpen_strength_x32() = u8_sat(sharpen_strength * 32);
@@ -373,43 +389,44 @@ Func CameraPipe::sharpen(Func input) {
 
     // Make an unsharp mask by blurring in y, then in x.
     Func unsharp_y("unsharp_y");
-    unsharp_y(x, y, c) = blur121(input(x, y - 1, c), input(x, y, c), input(x, y + 1, c));
+    unsharp_y(x, y, c, _) = blur121(input(x, y - 1, c, _), input(x, y, c, _), input(x, y + 1, c, _));
 
     Func unsharp("unsharp");
-    unsharp(x, y, c) = blur121(unsharp_y(x - 1, y, c), unsharp_y(x, y, c), unsharp_y(x + 1, y, c));
+    unsharp(x, y, c, _) = blur121(unsharp_y(x - 1, y, c, _), unsharp_y(x, y, c, _), unsharp_y(x + 1, y, c, _));
 
     Func mask("mask");
-    mask(x, y, c) = cast<int16_t>(input(x, y, c)) - cast<int16_t>(unsharp(x, y, c));
+    mask(x, y, c, _) = cast<int16_t>(input(x, y, c, _)) - cast<int16_t>(unsharp(x, y, c, _));
 
     // Weight the mask with the sharpening strength, and add it to the
     // input to get the sharpened result.
     Func sharpened("sharpened");
-    sharpened(x, y, c) = u8_sat(input(x, y, c) + (mask(x, y, c) * sharpen_strength_x32()) / 32);
+    sharpened(x, y, c, _) = u8_sat(input(x, y, c, _) + (mask(x, y, c, _) * sharpen_strength_x32()) / 32);
 
     return sharpened;
 }
 
-void CameraPipe::generate() {
+template<typename T, int input_dims>
+void CameraPipeBase<T, input_dims>::generate() {
     // shift things inwards to give us enough padding on the
     // boundaries so that we don't need to check bounds. We're going
     // to make a 2560x1920 output image, just like the FCam pipe, so
     // shift by 16, 12. We also convert it to be signed, so we can deal
     // with values that fall below 0 during processing.
     Func shifted;
-    shifted(x, y) = cast<int16_t>(input(x+16, y+12));
+    shifted(x, y, _) = cast<int16_t>(input(x+16, y+12, _));
 
     Func denoised = hot_pixel_suppression(shifted);
 
     Func deinterleaved = deinterleave(denoised);
 
-    auto demosaiced = create<Demosaic>();
+    auto demosaiced = this->template create<Demosaic>();
     demosaiced->apply(deinterleaved);
 
     Func corrected = color_correct(demosaiced->output);
 
     Func curved = apply_curve(corrected);
 
-    processed(x, y, c) = sharpen(curved)(x, y, c);
+    processed(x, y, c, _) = sharpen(curved)(x, y, c, _);
 
     // Schedule
     if (auto_schedule) {
@@ -426,6 +443,11 @@ void CameraPipe::generate() {
             .estimate(x, 0, 2592)
             .estimate(y, 0, 1968);
 
+        if (is_batch) {
+            input.dim(2).set_bounds_estimate(0, 8);
+            processed.estimate(_0, 0, 8);
+        }
+
     } else {
 
         Expr out_width = processed.width();
@@ -454,23 +476,35 @@ void CameraPipe::generate() {
             .split(y, yi, yii, 2, TailStrategy::RoundUp)
             .split(yi, yo, yi, strip_size / 2)
             .vectorize(x, 2*vec, TailStrategy::RoundUp)
-            .unroll(c)
-            .parallel(yo);
+            .unroll(c);
+
+        // The strips are the tasks of the thread pool. For a batch, the
+        // strips of all the frames go into one parallel loop, so the
+        // threads that run out of strips of one frame go on to the next
+        // one, and different frames are in different stages of the
+        // pipeline at the same time. The LUTs (the color matrix and the
+        // tone curve) are computed once for the whole batch.
+        Var strip = yo;
+        if (is_batch) {
+            strip = Var("frame_strip");
+            processed.fuse(yo, _0, strip);
+        }
+        processed.parallel(strip);
 
-        denoised.compute_at(processed, yi).store_at(processed, yo)
+        denoised.compute_at(processed, yi).store_at(processed, strip)
             .prefetch(input, y, 2)
             .fold_storage(y, 16)
             .tile(x, y, x, y, xi, yi, 2*vec, 2)
             .vectorize(xi)
             .unroll(yi);
 
-        deinterleaved.compute_at(processed, yi).store_at(processed, yo)
+        deinterleaved.compute_at(processed, yi).store_at(processed, strip)
             .fold_storage(y, 8)
             .reorder(c, x, y)
             .vectorize(x, 2*vec, TailStrategy::RoundUp)
             .unroll(c);
 
-        curved.compute_at(processed, yi).store_at(processed, yo)
+        curved.compute_at(processed, yi).store_at(processed, strip)
             .reorder(c, x, y)
             .tile(x, y, x, y, xi, yi, 2*vec, 2, TailStrategy::RoundUp)
             .vectorize(xi)
@@ -482,7 +516,7 @@ void CameraPipe::generate() {
             .unroll(c);
 
         demosaiced->intermed_compute_at.set({processed, yi});
-        demosaiced->intermed_store_at.set({processed, yo});
+        demosaiced->intermed_store_at.set({processed, strip});
         demosaiced->output_compute_at.set({curved, x});
 
         if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
@@ -538,8 +572,14 @@ void CameraPipe::generate() {
 
         }
     }
-};
+}
+
+class CameraPipe : public CameraPipeBase<CameraPipe, 2> {};
+
+// Processes a stack of raw frames, indexed by x, y, frame.
+class CameraPipeBatch : public CameraPipeBase<CameraPipeBatch, 3> {};
 
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(CameraPipe, camera_pipe)
+HALIDE_REGISTER_GENERATOR(CameraPipeBatch, camera_pipe_batch)
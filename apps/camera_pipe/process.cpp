@@ -4,6 +4,9 @@
 #ifndef NO_AUTO_SCHEDULE
 #include "camera_pipe_auto_schedule.h"
 #endif
+#ifndef NO_BATCH
+#include "camera_pipe_batch.h"
+#endif
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
@@ -82,6 +85,38 @@ int main(int argc, char **argv) {
     fprintf(stderr, "Halide (auto):\t%gus\n", best * 1e6);
     #endif
 
+    #ifndef NO_BATCH
+    {
+        // Process a burst of copies of the input in one call, and check
+        // that each frame matches the single frame result.
+        const int frames = 4;
+        Buffer<uint16_t> burst(input.width(), input.height(), frames);
+        for (int f = 0; f < frames; f++) {
+            burst.sliced(2, f).copy_from(input);
+        }
+        Buffer<uint8_t> burst_output(output.width(), output.height(), 3, frames);
+
+        best = benchmark(timing_iterations, 1, [&]() {
+            camera_pipe_batch(burst, matrix_3200, matrix_7000,
+                              color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                              burst_output);
+        });
+        fprintf(stderr, "Halide (batch):\t%gus per frame\n", best * 1e6 / frames);
+
+        // Compare with the manually scheduled single frame pipeline.
+        camera_pipe(input, matrix_3200, matrix_7000,
+                    color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                    output);
+        burst_output.for_each_element([&](int x, int y, int c, int f) {
+            if (burst_output(x, y, c, f) != output(x, y, c)) {
+                fprintf(stderr, "Mismatch in frame %d at %d %d %d: %d != %d\n", f, x, y, c,
+                        burst_output(x, y, c, f), output(x, y, c));
+                exit(1);
+            }
+        });
+    }
+    #endif
+
     fprintf(stderr, "output: %s\n", argv[7]);
     convert_and_save_image(output, argv[7]);
     fprintf(stderr, "        %d %d\n", output.width(), output.height());
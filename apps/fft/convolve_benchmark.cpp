@@ -0,0 +1,100 @@
+// Compare the FFT convolution against the direct and separable algorithms
+// at a few kernel sizes, checking that they compute the same result.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+#include "HalideBuffer.h"
+#include "halide_benchmark.h"
+
+#include "convolve_direct_15.h"
+#include "convolve_fft_15.h"
+#include "convolve_direct_31.h"
+#include "convolve_fft_31.h"
+#include "convolve_direct_63.h"
+#include "convolve_fft_63.h"
+#include "convolve_separable_direct_63.h"
+#include "convolve_separable_fft_63.h"
+
+using Halide::Runtime::Buffer;
+using namespace Halide::Tools;
+
+namespace {
+
+typedef int (*ConvolveFn)(halide_buffer_t *, halide_buffer_t *, halide_buffer_t *);
+
+const int W = 1536, H = 1024;
+
+// Run each of the convolutions, and check that they match the first.
+bool compare(int K, Buffer<float> input, Buffer<float> kernel,
+             const char *names[], ConvolveFn fns[], int count) {
+    Buffer<float> expected(W, H);
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        Buffer<float> output(W, H);
+        double t = benchmark(10, 1, [&]() {
+            fns[i](input, kernel, output);
+            output.device_sync();
+        });
+        printf("%3dx%-3d %-24s %10.3f ms %10.2f MP/s\n", K, K, names[i], t * 1e3, W * H / t / 1e6);
+
+        if (i == 0) {
+            expected.copy_from(output);
+            continue;
+        }
+        // The results differ by rounding, which grows with the size of the
+        // kernel.
+        const float tolerance = 1e-5f * K * K;
+        output.for_each_element([&](int x, int y) {
+            if (ok && !(std::abs(output(x, y) - expected(x, y)) <= tolerance)) {
+                printf("%s: output(%d, %d) = %f instead of %f\n",
+                       names[i], x, y, output(x, y), expected(x, y));
+                ok = false;
+            }
+        });
+    }
+    return ok;
+}
+
+Buffer<float> make_kernel(int K, int rows) {
+    Buffer<float> kernel(K, rows);
+    kernel.for_each_value([&](float &v) { v = (float)rand() / RAND_MAX / K; });
+    return kernel;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Buffer<float> input(W, H);
+    input.for_each_value([](float &v) { v = (float)rand() / RAND_MAX; });
+
+    bool ok = true;
+    {
+        const char *names[] = {"direct", "fft"};
+        ConvolveFn fns[] = {convolve_direct_15, convolve_fft_15};
+        ok = compare(15, input, make_kernel(15, 15), names, fns, 2) && ok;
+    }
+    {
+        const char *names[] = {"direct", "fft"};
+        ConvolveFn fns[] = {convolve_direct_31, convolve_fft_31};
+        ok = compare(31, input, make_kernel(31, 31), names, fns, 2) && ok;
+    }
+    {
+        const char *names[] = {"direct", "fft"};
+        ConvolveFn fns[] = {convolve_direct_63, convolve_fft_63};
+        ok = compare(63, input, make_kernel(63, 63), names, fns, 2) && ok;
+    }
+    {
+        const char *names[] = {"separable direct", "separable fft"};
+        ConvolveFn fns[] = {convolve_separable_direct_63, convolve_separable_fft_63};
+        ok = compare(63, input, make_kernel(63, 2), names, fns, 2) && ok;
+    }
+
+    if (!ok) {
+        return 1;
+    }
+    printf("Success!\n");
+    return 0;
+}
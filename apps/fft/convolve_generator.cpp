@@ -0,0 +1,265 @@
+#include "Halide.h"
+
+#include <cmath>
+
+#include "fft.h"
+
+namespace {
+
+using namespace Halide;
+
+enum class ConvolveAlgorithm { Auto, Direct, Separable, FFT };
+std::map<std::string, ConvolveAlgorithm> convolve_algorithm_enum_map() {
+    return { { "auto", ConvolveAlgorithm::Auto },
+             { "direct", ConvolveAlgorithm::Direct },
+             { "separable", ConvolveAlgorithm::Separable },
+             { "fft", ConvolveAlgorithm::FFT } };
+}
+
+// Filter an image with a kernel_size x kernel_size kernel:
+//
+//   output(x, y) = sum(kernel(i, j) * input(x + i - kernel_size / 2, y + j - kernel_size / 2))
+//
+// with the input clamped at its edges. For small kernels, this is computed
+// directly. For large kernels, this is computed with FFTs of tiles of the
+// input (the overlap-save method), which costs O(log(tile_size)) per output
+// rather than O(kernel_size^2).
+class ConvolveGenerator : public Halide::Generator<ConvolveGenerator> {
+public:
+    // The algorithm to use. "auto" picks the one with the lowest estimated
+    // cost for kernel_size. "separable" may only be used if separable is true.
+    GeneratorParam<ConvolveAlgorithm> algorithm{"algorithm", ConvolveAlgorithm::Auto,
+        convolve_algorithm_enum_map() };
+
+    // The width and height of the kernel.
+    GeneratorParam<int32_t> kernel_size{"kernel_size", 31};
+
+    // If true, the kernel is the outer product of two 1D kernels, and the
+    // kernel input holds those instead of the full 2D kernel.
+    GeneratorParam<bool> separable{"separable", false};
+
+    // The size of the FFTs used by the FFT algorithm. Each FFT computes a
+    // tile of tile_size - kernel_size + 1 outputs in each dimension. Zero
+    // picks a size based on kernel_size.
+    GeneratorParam<int32_t> tile_size{"tile_size", 0};
+
+    GeneratorParam<int32_t> vector_width{"vector_width", 0};
+
+    Input<Buffer<float>> input{"input", 2};
+
+    // The kernel_size x kernel_size kernel or, if separable is true, a
+    // kernel_size x 2 buffer holding the horizontal kernel in row 0 and the
+    // vertical kernel in row 1.
+    Input<Buffer<float>> kernel{"kernel", 2};
+
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        const int K = kernel_size;
+        _halide_user_assert(K > 0) << "kernel_size must be positive\n";
+
+        algo = algorithm;
+        if (algo == ConvolveAlgorithm::Auto) {
+            algo = choose_algorithm();
+        }
+        _halide_user_assert(algo != ConvolveAlgorithm::Separable || separable)
+            << "The separable algorithm requires a separable kernel\n";
+
+        clamped = BoundaryConditions::repeat_edge(input);
+
+        if (separable) {
+            kernel_2d(x, y) = kernel(x, 0) * kernel(y, 1);
+        } else {
+            kernel_2d(x, y) = kernel(x, y);
+        }
+
+        switch (algo) {
+        case ConvolveAlgorithm::Direct:
+            generate_direct();
+            break;
+        case ConvolveAlgorithm::Separable:
+            generate_separable();
+            break;
+        default:
+            generate_fft();
+            break;
+        }
+    }
+
+    void schedule() {
+        const int K = kernel_size;
+        if (separable) {
+            kernel.dim(0).set_bounds(0, K).dim(1).set_bounds(0, 2);
+        } else {
+            kernel.dim(0).set_bounds(0, K).dim(1).set_bounds(0, K);
+        }
+
+        const int vw = natural_vector_width();
+
+        switch (algo) {
+        case ConvolveAlgorithm::Direct:
+            output.tile(x, y, xo, yo, xi, yi, vw * 4, 32)
+                .vectorize(xi, vw)
+                .parallel(yo);
+            direct.compute_at(output, xo).vectorize(x, vw);
+            direct.update().reorder(x, r.x, y, r.y).vectorize(x, vw);
+            break;
+
+        case ConvolveAlgorithm::Separable:
+            output.split(y, yo, yi, 32)
+                .vectorize(x, vw)
+                .parallel(yo);
+            blur_y.compute_at(output, yo).vectorize(x, vw);
+            blur_y.update().reorder(x, r.x, y).vectorize(x, vw);
+            blur_x.compute_at(output, yo).vectorize(x, vw);
+            blur_x.update().reorder(x, r.x, y).vectorize(x, vw);
+            break;
+
+        default: {
+            // Each tile of the output is computed from one FFT of a tile of
+            // the input. The tiles must line up with the tiles of the output,
+            // so the output must start at 0.
+            const int B = fft_tile_size - K + 1;
+            output.dim(0).set_min(0).dim(1).set_min(0);
+            output.tile(x, y, xo, yo, xi, yi, B, B, TailStrategy::GuardWithIf)
+                .vectorize(xi, vw, TailStrategy::GuardWithIf)
+                .parallel(yo);
+            tiled_conv.compute_at(output, xo);
+            input_dft.compute_at(output, xo);
+            kernel_dft.compute_root();
+            break;
+        }
+        }
+    }
+
+private:
+    Var x{"x"}, y{"y"}, xo{"xo"}, yo{"yo"}, xi{"xi"}, yi{"yi"};
+    Var tx{"tx"}, ty{"ty"};
+    RDom r;
+
+    ConvolveAlgorithm algo = ConvolveAlgorithm::Auto;
+    int fft_tile_size = 0;
+
+    Func clamped;
+    Func kernel_2d{"kernel_2d"};
+
+    // The direct algorithm.
+    Func direct{"direct"};
+
+    // The separable algorithm.
+    Func blur_x{"blur_x"}, blur_y{"blur_y"};
+
+    // The FFT algorithm.
+    ComplexFunc input_dft, kernel_dft;
+    Func tiled_conv;
+
+    int natural_vector_width() const {
+        return vector_width > 0 ? (int)vector_width : get_target().natural_vector_size<float>();
+    }
+
+    // The cost per output of an FFT of tiles of size N, in units of the
+    // multiply-adds of the direct algorithm. The constant is a rough
+    // measurement of the forward and inverse real FFTs and the pointwise
+    // multiply; it only needs to be good enough to find the crossover to
+    // within a few sizes.
+    float fft_cost(int N) const {
+        const int K = kernel_size;
+        const int B = N - K + 1;
+        if (B <= 0) {
+            return std::numeric_limits<float>::infinity();
+        }
+        return 20.0f * N * N * std::log2((float)N) / ((float)B * B);
+    }
+
+    // Pick the FFT size with the lowest cost among sizes the FFT
+    // decomposes into radices efficiently.
+    int choose_tile_size() const {
+        if (tile_size > 0) {
+            return tile_size;
+        }
+        static const int sizes[] = { 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512 };
+        int best = 0;
+        for (int N : sizes) {
+            if (best == 0 || fft_cost(N) < fft_cost(best)) {
+                best = N;
+            }
+        }
+        return best;
+    }
+
+    ConvolveAlgorithm choose_algorithm() const {
+        const int K = kernel_size;
+        float direct_cost = separable ? 2.0f * K : (float)K * K;
+        float fft = fft_cost(choose_tile_size());
+        if (fft < direct_cost) {
+            return ConvolveAlgorithm::FFT;
+        }
+        return separable ? ConvolveAlgorithm::Separable : ConvolveAlgorithm::Direct;
+    }
+
+    void generate_direct() {
+        const int K = kernel_size;
+        r = RDom(0, K, 0, K, "r");
+        direct(x, y) = 0.0f;
+        direct(x, y) += kernel_2d(r.x, r.y) * clamped(x + r.x - K / 2, y + r.y - K / 2);
+        output(x, y) = direct(x, y);
+    }
+
+    void generate_separable() {
+        const int K = kernel_size;
+        r = RDom(0, K, "r");
+        blur_y(x, y) = 0.0f;
+        blur_y(x, y) += kernel(r, 1) * clamped(x, y + r - K / 2);
+        blur_x(x, y) = 0.0f;
+        blur_x(x, y) += kernel(r, 0) * blur_y(x + r - K / 2, y);
+        output(x, y) = blur_x(x, y);
+    }
+
+    void generate_fft() {
+        const int K = kernel_size;
+        const int N = choose_tile_size();
+        _halide_user_assert(N >= K) << "tile_size must be at least kernel_size\n";
+        fft_tile_size = N;
+        const int B = N - K + 1;
+
+        Fft2dDesc fwd_desc;
+        fwd_desc.vector_width = vector_width;
+        Fft2dDesc inv_desc = fwd_desc;
+        inv_desc.gain = 1.0f / (N * N);
+
+        // The tiles of the input. Tile (tx, ty) holds the N x N inputs
+        // needed to compute a B x B tile of the output.
+        Func input_tiles("input_tiles");
+        input_tiles(x, y, tx, ty) = clamped(tx * B + x - K / 2, ty * B + y - K / 2);
+
+        // The kernel, padded to N x N.
+        Func padded_kernel("padded_kernel");
+        padded_kernel(x, y) = select(x < K && y < K,
+                                     kernel_2d(min(x, K - 1), min(y, K - 1)),
+                                     0.0f);
+
+        fwd_desc.name = "input_dft";
+        input_dft = fft2d_r2c(input_tiles, N, N, get_target(), fwd_desc);
+        fwd_desc.name = "kernel_dft";
+        kernel_dft = fft2d_r2c(padded_kernel, N, N, get_target(), fwd_desc);
+
+        // The product of the input DFT and the conjugate of the kernel DFT
+        // is the DFT of the circular cross-correlation of the tile with
+        // the kernel. The first B x B outputs of that don't wrap around
+        // the tile, so they are what we want.
+        ComplexFunc dft_product("dft_product");
+        {
+            ComplexExpr in_dft = input_dft(x, y, tx, ty);
+            ComplexExpr k_dft = kernel_dft(x, y);
+            dft_product(x, y, tx, ty) = in_dft * conj(k_dft);
+        }
+        inv_desc.name = "tiled_conv";
+        tiled_conv = fft2d_c2r(dft_product, N, N, get_target(), inv_desc);
+
+        output(x, y) = tiled_conv(x % B, y % B, x / B, y / B);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ConvolveGenerator, convolve)
@@ -1057,3 +1057,304 @@ Func fft2d_c2r(ComplexFunc c,
                const Fft2dDesc& desc) {
     return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
 }
+
+// The remaining functions compute FFTs of sizes that are only known when the
+// pipeline runs. They can't specialize the code to a factorization of N, so
+// they use a Stockham autosort FFT in which the stages are applied by update
+// definitions that loop over the stages of each radix, with trip counts
+// computed from N. Sizes with a prime factor larger than 7 fall back to
+// Bluestein's algorithm, which rewrites the DFT as a convolution that can be
+// computed with power of two FFTs.
+
+namespace {
+
+// The number of times p divides N.
+Expr count_factors(Expr N, int p) {
+    Expr count = 0;
+    for (int64_t pk = p; pk <= std::numeric_limits<int32_t>::max(); pk *= p) {
+        count += select(N % (int)pk == 0, 1, 0);
+    }
+    return count;
+}
+
+// The largest power of p dividing N.
+Expr largest_power_dividing(Expr N, int p) {
+    Expr power = 1;
+    for (int64_t pk = p; pk <= std::numeric_limits<int32_t>::max(); pk *= p) {
+        power *= select(N % (int)pk == 0, p, 1);
+    }
+    return power;
+}
+
+// Compute p^e for a runtime e.
+Expr ipow(int p, Expr e) {
+    if (p == 2) {
+        return 1 << e;
+    } else if (p == 4) {
+        return 1 << (e * 2);
+    }
+    return cast<int>(round(pow(Expr((double)p), cast<double>(e))));
+}
+
+// Whether the factors of N are all supported by fft_dim_dynamic.
+Expr is_smooth(Expr N) {
+    return N == (1 << count_trailing_zeros(N)) *
+        largest_power_dividing(N, 3) * largest_power_dividing(N, 5) * largest_power_dividing(N, 7);
+}
+
+// The Funcs making up an FFT computed by fft_dim_dynamic. 'result' is
+// inlined into its consumers, and the caller should choose where to compute
+// 'stages' and 'twiddles'.
+struct DynamicFft {
+    ComplexFunc result;
+    // The stages of the FFT are the update definitions of this Func, which
+    // ping-pongs between two buffers in its last dimension.
+    ComplexFunc stages;
+    // A table of the N twiddle factors.
+    ComplexFunc twiddles;
+};
+
+// Compute the N point DFT of dimension dim of x, where N is of the form 2^a
+// 3^b 5^c 7^d (the result is not a DFT otherwise). Each stage reads the
+// other buffer from the one it writes, so the stages can be vectorized along
+// dimension dim even when that's the dimension being transformed.
+DynamicFft fft_dim_dynamic(ComplexFunc x, int dim, Expr N, int sign,
+                           int vector_width, const string& prefix) {
+    vector<Var> args = x.args();
+    Type type = x.output_types()[0];
+
+    // Twiddle factors for N. These are computed in double precision, because
+    // the angles of the larger FFTs don't fit in a float.
+    ComplexFunc W(prefix + "W"); {
+        Var m("m");
+        Expr theta = Expr(sign * 2 * M_PI) * cast<double>(m) / cast<double>(N);
+        W(m) = ComplexExpr(cast(type, cos(theta)), cast(type, sin(theta)));
+    }
+
+    Var p("p");
+    ComplexFunc X(prefix + "stages");
+    X(A(args, {p})) = undef_z(type);
+
+    // Update 0: The input goes in buffer 0.
+    vector<Expr> input_args(args.begin(), args.end());
+    input_args.push_back(0);
+    X(input_args) = x(args);
+
+    // Apply all the radix 4 stages, then all the radix 2 stages, etc. At
+    // stage t, the sub-transforms so far are of size S, and the stage
+    // reads buffer t % 2 and writes buffer (t + 1) % 2.
+    Expr tz = count_trailing_zeros(N);
+    const std::pair<int, Expr> passes[] = {
+        { 4, tz / 2 },
+        { 2, tz % 2 },
+        { 3, count_factors(N, 3) },
+        { 5, count_factors(N, 5) },
+        { 7, count_factors(N, 7) },
+    };
+    Expr t0 = 0;
+    Expr S0 = 1;
+    vector<RDom> pass_rdoms;
+    for (const auto &pass : passes) {
+        const int R = pass.first;
+        RDom r(0, N, 0, pass.second, prefix + "r" + std::to_string(R));
+        Expr t = t0 + r.y;
+        Expr S = S0 * ipow(R, r.y);
+        Expr SR = S * R;
+
+        // This is the same computation as an fft_dim1 stage, with the
+        // twiddle factors and the R point DFT combined into one table
+        // lookup per term, and written as a gather rather than a scatter.
+        Expr s = (r.x / SR) * S + r.x % S;
+        Expr k = r.x % SR;
+        Expr N_R = N / R;
+        Expr W_step = N / SR;
+
+        // The clamps don't change the indices; they let bounds inference
+        // see that the stage doesn't reach outside [0, N).
+        vector<Expr> in_args(args.begin(), args.end());
+        in_args.push_back(t % 2);
+        in_args[dim] = clamp(s, 0, N - 1);
+        ComplexExpr y = X(in_args);
+        for (int q = 1; q < R; q++) {
+            in_args[dim] = clamp(s + q * N_R, 0, N - 1);
+            ComplexExpr x_q = X(in_args);
+            ComplexExpr W_q = W(clamp(((q * k) % SR) * W_step, 0, N - 1));
+            y += x_q * W_q;
+        }
+
+        vector<Expr> out_args(args.begin(), args.end());
+        out_args.push_back((t + 1) % 2);
+        out_args[dim] = r.x;
+        X(out_args) = y;
+
+        pass_rdoms.push_back(r);
+        t0 = t0 + pass.second;
+        S0 = S0 * ipow(R, pass.second);
+    }
+
+    // Schedule the stages. If we are transforming dimension 0, vectorize
+    // the transform itself. Otherwise, vectorize across dimension 0.
+    Var n0 = args[0];
+    X.update(0).vectorize(n0, vector_width);
+    for (size_t i = 0; i < pass_rdoms.size(); i++) {
+        RDom r = pass_rdoms[i];
+        Stage stage = X.update(i + 1);
+        if (dim == 0) {
+            // Each stage only writes one buffer and only reads the other.
+            stage.allow_race_conditions().vectorize(r.x, vector_width);
+        } else {
+            stage.reorder(n0, r.x, r.y).vectorize(n0, vector_width);
+        }
+    }
+    W.vectorize(W.args()[0], vector_width);
+
+    ComplexFunc result(prefix + "result");
+    vector<Expr> result_args(args.begin(), args.end());
+    result_args.push_back(t0 % 2);
+    result(args) = X(result_args);
+
+    return {result, X, W};
+}
+
+}  // namespace
+
+ComplexFunc fft1d_c2c_dynamic(ComplexFunc x, int dim, Expr N, int sign,
+                              const Target& target,
+                              const Fft2dDesc& desc) {
+    string prefix = desc.name.empty() ? "dynamic_" : desc.name + "_";
+
+    vector<Var> args = x.args();
+    Var n = args[dim];
+    Type type = x.output_types()[0];
+    const ComplexExpr zero(cast(type, 0), cast(type, 0));
+
+    int vector_width = desc.vector_width;
+    if (vector_width <= 0) {
+        vector_width = target.natural_vector_size(type);
+    }
+
+    // If N only has factors of 2, 3, 5 and 7, compute the FFT directly.
+    DynamicFft direct = fft_dim_dynamic(x, dim, N, sign, vector_width, prefix);
+
+    // Otherwise, use Bluestein's algorithm: using nk = (n^2 + k^2 - (k - n)^2)/2,
+    //
+    //   X_k = sum[x_n e^(sign*2*pi*j*n*k/N)]
+    //       = c_k sum[(x_n c_n) c*_(k - n)], where c_n = e^(sign*pi*j*n^2/N)
+    //
+    // which is a convolution we can compute with FFTs of any size M at least
+    // 2N - 1. We use the next power of two.
+    Expr M = 1 << (32 - count_leading_zeros(max(2 * N - 2, 1)));
+
+    ComplexFunc chirp(prefix + "chirp"); {
+        // n^2 can overflow, and n^2 mod 2N gives the same angle.
+        Var m("m");
+        Expr n2 = cast<int>((cast<int64_t>(m) * m) % (2 * cast<int64_t>(N)));
+        Expr theta = Expr(sign * M_PI) * cast<double>(n2) / cast<double>(N);
+        chirp(m) = ComplexExpr(cast(type, cos(theta)), cast(type, sin(theta)));
+    }
+    auto chirp_at = [&](Expr i) { return chirp(clamp(i, 0, N - 1)); };
+
+    ComplexFunc a(prefix + "bluestein_a"); {
+        vector<Expr> x_args(args.begin(), args.end());
+        x_args[dim] = clamp(n, 0, N - 1);
+        ComplexExpr x_n = x(x_args);
+        ComplexExpr c_n = chirp_at(n);
+        a(args) = select(n < N, x_n * c_n, zero);
+    }
+
+    // The convolution kernel is c*_m for m in (-N, N), wrapped around M.
+    ComplexFunc b(prefix + "bluestein_b"); {
+        Var m("m");
+        b(m) = select(m < N, conj(chirp_at(m)),
+                      m > M - N, conj(chirp_at(M - m)),
+                      zero);
+    }
+
+    DynamicFft a_hat = fft_dim_dynamic(a, dim, M, -1, vector_width, prefix + "bluestein_a_hat_");
+    DynamicFft b_hat = fft_dim_dynamic(b, 0, M, -1, vector_width, prefix + "bluestein_b_hat_");
+    ComplexFunc ab_hat(prefix + "bluestein_ab_hat"); {
+        ComplexExpr a_n = a_hat.result(args);
+        ComplexExpr b_n = b_hat.result(n);
+        ab_hat(args) = a_n * b_n;
+    }
+    DynamicFft conv = fft_dim_dynamic(ab_hat, dim, M, 1, vector_width, prefix + "bluestein_conv_");
+
+    Expr smooth = is_smooth(N);
+    ComplexFunc dft(prefix + "fft1d"); {
+        ComplexExpr direct_n = direct.result(args);
+        ComplexExpr conv_n = conv.result(args);
+        ComplexExpr c_n = chirp_at(n);
+        dft(args) = select(smooth,
+                           direct_n * desc.gain,
+                           conv_n * c_n * (desc.gain / cast(type, M)));
+    }
+
+    // Schedule. Each FFT along dimension 0 is computed separately, which
+    // leaves the other dimensions for parallelism. FFTs along any other
+    // dimension are computed in groups of vectors along dimension 0.
+    Var outer = Var::outermost();
+    if (dim == 0) {
+        dft.vectorize(n, vector_width);
+        if (args.size() > 1) {
+            outer = args[1];
+            if (desc.parallel) {
+                dft.parallel(outer);
+            }
+        }
+    } else {
+        Var n0 = args[0];
+        dft.split(n0, group, n0, vector_width, TailStrategy::GuardWithIf)
+            .reorder(n0, n, group)
+            .vectorize(n0);
+        if (desc.parallel) {
+            dft.parallel(group);
+        }
+        outer = group;
+    }
+    direct.stages.compute_at(dft, outer);
+    a_hat.stages.compute_at(dft, outer);
+    conv.stages.compute_at(dft, outer);
+    // These only depend on N, but computing them at the outermost loop of
+    // dft (rather than root) means they're skipped along with the rest of
+    // the path that doesn't run.
+    direct.twiddles.compute_at(dft, Var::outermost());
+    a_hat.twiddles.compute_at(dft, Var::outermost());
+    b_hat.twiddles.compute_at(dft, Var::outermost());
+    conv.twiddles.compute_at(dft, Var::outermost());
+    b_hat.stages.compute_at(dft, Var::outermost());
+    chirp.compute_at(dft, Var::outermost()).vectorize(chirp.args()[0], vector_width);
+
+    // Only one of the two paths runs.
+    dft.specialize(smooth);
+
+    return dft;
+}
+
+ComplexFunc fft2d_c2c_dynamic(ComplexFunc x, Expr N0, Expr N1, int sign,
+                              const Target& target,
+                              const Fft2dDesc& desc) {
+    string prefix = desc.name.empty() ? "dynamic_c2c" : desc.name;
+
+    // Get the innermost variable outside the FFT.
+    Var outer = Var::outermost();
+    if (x.dimensions() > 2) {
+        outer = x.args()[2];
+    }
+
+    // Transform the rows, and then the columns.
+    Fft2dDesc desc0 = desc;
+    desc0.gain = 1.0f;
+    desc0.name = prefix + "_dim0";
+    ComplexFunc dft0 = fft1d_c2c_dynamic(x, 0, N0, sign, target, desc0);
+
+    Fft2dDesc desc1 = desc;
+    desc1.name = prefix + "_dim1";
+    ComplexFunc dft = fft1d_c2c_dynamic(dft0, 1, N1, sign, target, desc1);
+
+    dft0.compute_at(dft, outer);
+    if (desc.schedule_input) {
+        x.compute_at(dft0, x.args()[1]);
+    }
+
+    return dft;
+}
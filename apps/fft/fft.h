@@ -66,4 +66,25 @@ Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target& target,
                        const Fft2dDesc& desc = Fft2dDesc());
 
+// Compute the N point complex DFT of dimension dim of x, where N may be a
+// runtime value. x must be defined on at least [0, N) in dimension dim; all
+// other dimensions are computed independently (a batch of 1D DFTs). Sizes of
+// the form 2^a 3^b 5^c 7^d are computed with a mixed radix FFT, and all
+// others with Bluestein's algorithm, at roughly 6 times the cost. As for
+// fft2d_c2c, there is no normalization other than desc.gain. The result
+// must not be inlined.
+//
+// These are slower than the fixed size FFTs above, which can tailor the
+// code to the size, but one pipeline handles every size.
+ComplexFunc fft1d_c2c_dynamic(ComplexFunc x, int dim, Halide::Expr N, int sign,
+                              const Halide::Target& target,
+                              const Fft2dDesc& desc = Fft2dDesc());
+
+// Compute the N0 x N1 2D complex DFT of the first 2 dimensions of x, where
+// N0 and N1 may be runtime values. Any further dimensions of x are a batch.
+// If desc.parallel is set, each pass of 1D DFTs is split across threads.
+ComplexFunc fft2d_c2c_dynamic(ComplexFunc x, Halide::Expr N0, Halide::Expr N1, int sign,
+                              const Halide::Target& target,
+                              const Fft2dDesc& desc = Fft2dDesc());
+
 #endif
@@ -0,0 +1,132 @@
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+#include "fft_dynamic_forward_c2c.h"
+#include "fft_dynamic_inverse_c2c.h"
+#include "fft_dynamic_forward_c2c_axis0.h"
+#include "fft_dynamic_forward_c2c_axis1.h"
+
+namespace {
+const double kPi = 3.14159265358979310000;
+
+const int kBatch = 3;
+}
+
+using Halide::Runtime::Buffer;
+
+Buffer<float, 4> complex_buffer(int x_size, int y_size) {
+    Buffer<float, 4> b(2, x_size, y_size, kBatch);
+    b.transpose(0, 1);
+    b.transpose(1, 2);
+    return b;
+}
+
+// Compute the DFT of dimensions d0 (and d1 if >= 0) of in directly.
+Buffer<float, 4> reference_dft(const Buffer<float, 4> &in, int sign, int d0, int d1) {
+    const int N0 = in.dim(0).extent(), N1 = in.dim(1).extent();
+    auto out = complex_buffer(N0, N1);
+    std::vector<int> N = {N0, N1};
+    for (int b = 0; b < kBatch; b++) {
+        for (int k1 = 0; k1 < N1; k1++) {
+            for (int k0 = 0; k0 < N0; k0++) {
+                std::complex<double> sum = 0;
+                for (int n1 = 0; n1 < N1; n1++) {
+                    for (int n0 = 0; n0 < N0; n0++) {
+                        int k[] = {k0, k1}, n[] = {n0, n1};
+                        // Dimensions that aren't transformed must match.
+                        if ((d0 != 0 && d1 != 0 && n0 != k0) ||
+                            (d0 != 1 && d1 != 1 && n1 != k1)) {
+                            continue;
+                        }
+                        double theta = 0;
+                        for (int d : {d0, d1}) {
+                            if (d >= 0) {
+                                theta += (double)((int64_t)n[d] * k[d] % N[d]) / N[d];
+                            }
+                        }
+                        theta *= sign * 2 * kPi;
+                        sum += std::complex<double>(in(n0, n1, 0, b), in(n0, n1, 1, b)) *
+                               std::complex<double>(cos(theta), sin(theta));
+                    }
+                }
+                out(k0, k1, 0, b) = (float)sum.real();
+                out(k0, k1, 1, b) = (float)sum.imag();
+            }
+        }
+    }
+    return out;
+}
+
+bool check(const char *name, const Buffer<float, 4> &out, const Buffer<float, 4> &expected, float tolerance) {
+    bool ok = true;
+    expected.for_each_element([&](int x, int y, int c, int b) {
+        float diff = std::abs(out(x, y, c, b) - expected(x, y, c, b));
+        if (ok && !(diff <= tolerance)) {
+            std::cerr << name << " " << out.dim(0).extent() << "x" << out.dim(1).extent()
+                      << ": mismatch at (" << x << ", " << y << ", " << c << ", " << b << "): "
+                      << out(x, y, c, b) << " instead of " << expected(x, y, c, b) << std::endl;
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    // Sizes with only small factors, with some large prime factors, and
+    // degenerate sizes.
+    const int sizes[][2] = {
+        {16, 16}, {12, 10}, {30, 7}, {64, 48}, {13, 17}, {1, 37}, {22, 1}, {97, 6},
+    };
+
+    bool ok = true;
+    for (const auto &size : sizes) {
+        const int N0 = size[0], N1 = size[1];
+        std::cout << "Testing " << N0 << "x" << N1 << std::endl;
+
+        auto in = complex_buffer(N0, N1);
+        in.for_each_value([](float &v) { v = (float)rand() / RAND_MAX * 2 - 1; });
+
+        // The error grows with the size of the DFT.
+        const float tolerance = 1e-5f * (N0 + N1) * std::sqrt((float)(N0 * N1));
+
+        auto out = complex_buffer(N0, N1);
+        if (fft_dynamic_forward_c2c(in, out) != 0) {
+            std::cerr << "fft_dynamic_forward_c2c failed" << std::endl;
+            exit(1);
+        }
+        ok = check("fft_dynamic_forward_c2c", out, reference_dft(in, -1, 0, 1), tolerance) && ok;
+
+        // The inverse of the forward FFT, scaled by 1 / N, is the input.
+        auto inverse = complex_buffer(N0, N1);
+        if (fft_dynamic_inverse_c2c(out, inverse) != 0) {
+            std::cerr << "fft_dynamic_inverse_c2c failed" << std::endl;
+            exit(1);
+        }
+        inverse.for_each_value([&](float &v) { v /= N0 * N1; });
+        ok = check("fft_dynamic_inverse_c2c", inverse, in, 1e-5f * (N0 + N1)) && ok;
+
+        if (fft_dynamic_forward_c2c_axis0(in, out) != 0) {
+            std::cerr << "fft_dynamic_forward_c2c_axis0 failed" << std::endl;
+            exit(1);
+        }
+        ok = check("fft_dynamic_forward_c2c_axis0", out, reference_dft(in, -1, 0, -1), 1e-5f * N0 * 4) && ok;
+
+        if (fft_dynamic_forward_c2c_axis1(in, out) != 0) {
+            std::cerr << "fft_dynamic_forward_c2c_axis1 failed" << std::endl;
+            exit(1);
+        }
+        ok = check("fft_dynamic_forward_c2c_axis1", out, reference_dft(in, -1, 1, -1), 1e-5f * N1 * 4) && ok;
+    }
+
+    if (!ok) {
+        exit(1);
+    }
+
+    std::cout << "Success!" << std::endl;
+    return 0;
+}
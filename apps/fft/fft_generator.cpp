@@ -164,6 +164,108 @@ private:
     ComplexFunc complex_result;
 };
 
+// An FFT with sizes determined by the buffers it is called with, rather than
+// by GeneratorParams. This is slower than the fft generator, but a single
+// pipeline handles any size.
+class FFTDynamicGenerator : public Halide::Generator<FFTDynamicGenerator> {
+public:
+    // These are the same as for FFTGenerator.
+    GeneratorParam<float> gain{"gain", 1.0f};
+    GeneratorParam<int32_t> vector_width{"vector_width", 0};
+    GeneratorParam<FFTDirection> direction{"direction", FFTDirection::SamplesToFrequency,
+        fft_direction_enum_map() };
+    GeneratorParam<FFTNumberType> input_number_type{"input_number_type",
+        FFTNumberType::Real, fft_number_type_enum_map() };
+    GeneratorParam<FFTNumberType> output_number_type{"output_number_type",
+        FFTNumberType::Real, fft_number_type_enum_map() };
+
+    // Whether to split the FFTs across threads. Unlike FFTGenerator, this
+    // parallelizes across the independent 1D FFTs making up each pass,
+    // so it's useful for batches of 1D FFTs as well as large 2D FFTs.
+    GeneratorParam<bool> parallel{"parallel", true};
+
+    // The number of dimensions to transform, 1 or 2.
+    GeneratorParam<int32_t> dimensions{"dimensions", 2};
+    // For 1D FFTs, the dimension to transform, 0 or 1. The other
+    // dimension is a batch of independent FFTs.
+    GeneratorParam<int32_t> axis{"axis", 0};
+
+    // The input buffer. Must be separate from the output. The sizes of
+    // the FFT are the extents of dimensions 0 and 1, which may be any
+    // positive value; dimension 3 is a batch of independent FFTs.
+    // Dimension 2 holds the components as for FFTGenerator.
+    //
+    // Real inputs and outputs are computed with a complex FFT, so the
+    // output has the same extents as the input, and the input of a
+    // complex to real FFT is the full spectrum (only the real part of
+    // the result is stored).
+    Input<Buffer<float>>  input{"input", 4};
+    Output<Buffer<float>> output{"output", 4};
+
+    void generate() {
+        _halide_user_assert(dimensions == 1 || dimensions == 2)
+            << "FFT must be 1D or 2D\n";
+        _halide_user_assert(axis == 0 || axis == 1)
+            << "FFT axis must be 0 or 1\n";
+
+        Fft2dDesc desc;
+        desc.gain = gain;
+        desc.vector_width = vector_width;
+        desc.parallel = parallel;
+
+        const int sign = (direction == FFTDirection::SamplesToFrequency) ? -1 : 1;
+
+        ComplexFunc in;
+        if (input_number_type == FFTNumberType::Real) {
+            in(x, y, b) = ComplexExpr(input(x, y, 0, b), 0);
+        } else {
+            in(x, y, b) = ComplexExpr(input(x, y, 0, b), input(x, y, 1, b));
+        }
+
+        Expr N0 = input.dim(0).extent();
+        Expr N1 = input.dim(1).extent();
+        if (dimensions == 2) {
+            complex_result = fft2d_c2c_dynamic(in, N0, N1, sign, target, desc);
+        } else if (axis == 0) {
+            complex_result = fft1d_c2c_dynamic(in, 0, N0, sign, target, desc);
+        } else {
+            complex_result = fft1d_c2c_dynamic(in, 1, N1, sign, target, desc);
+        }
+
+        if (output_number_type == FFTNumberType::Real) {
+            output(x, y, c, b) = re(complex_result(x, y, b));
+        } else {
+            output(x, y, c, b) = select(c == 0,
+                                        re(complex_result(x, y, b)),
+                                        im(complex_result(x, y, b)));
+        }
+    }
+
+    void schedule() {
+        const int input_comps = (input_number_type == FFTNumberType::Real) ? 1 : 2;
+        const int output_comps = (output_number_type == FFTNumberType::Real) ? 1 : 2;
+
+        // The FFT reads all of the input, and computes all of the output.
+        input.dim(0).set_min(0).set_stride(input_comps)
+             .dim(1).set_min(0)
+             .dim(2).set_min(0).set_extent(input_comps).set_stride(1);
+
+        output.dim(0).set_bounds(0, input.dim(0).extent()).set_stride(output_comps)
+              .dim(1).set_bounds(0, input.dim(1).extent())
+              .dim(2).set_min(0).set_extent(output_comps).set_stride(1);
+
+        if (output_comps != 1) {
+            output.reorder(c, x, y, b).unroll(c);
+        }
+
+        complex_result.compute_at(output, b);
+    }
+private:
+    Var x{"x"}, y{"y"}, c{"c"}, b{"b"};
+    ComplexFunc complex_result;
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(FFTGenerator, fft)
+HALIDE_REGISTER_GENERATOR(FFTDynamicGenerator, fft_dynamic)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include "Halide.h"
 
@@ -158,7 +159,259 @@ class GEMMGenerator :
     }
 };
 
+// Generator class for BLAS gemm operations on large matrices, in the
+// style of GotoBLAS. Each parallel task computes one block of the
+// output. For each block of the reduction, the parts of A and B the task
+// needs are first copied ("packed") into panels laid out in the order the
+// inner loop reads them, so the inner loop streams through contiguous
+// memory that stays in cache. The inner loop then accumulates a tile of
+// the output small enough to live in registers.
+template<class T>
+class PackedGEMMGenerator :
+        public Generator<PackedGEMMGenerator<T>> {
+  public:
+    typedef Generator<PackedGEMMGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+
+    GeneratorParam<bool> transpose_A_ = {"transpose_A", false};
+    GeneratorParam<bool> transpose_B_ = {"transpose_B", false};
+
+    // The size of the block of the output computed by each task (rounded
+    // down to a multiple of the register tile), and of the blocks of the
+    // reduction that are packed at once. The defaults keep a packed block
+    // of A in L2 and a panel of B in L1 on typical x86 and ARM cores.
+    GeneratorParam<int> block_m_ = {"block_m", 128};
+    GeneratorParam<int> block_n_ = {"block_n", 192};
+    GeneratorParam<int> block_k_ = {"block_k", 256};
+
+    // Standard ordering of parameters in GEMM functions.
+    Input<T>         a_ = {"a_", 1};
+    Input<Buffer<T>> A_ = {"A_", 2};
+    Input<Buffer<T>> B_ = {"B_", 2};
+    Input<T>         b_ = {"b_", 1};
+    Input<Buffer<T>> C_ = {"C_", 2};
+
+    Output<Buffer<T>> result_ = {"result", 2};
+
+    void generate() {
+        // Matrices are column-major; the transpose GeneratorParams say
+        // that A and/or B are actually row-major.
+        const Expr num_rows = (bool)transpose_A_ ? A_.height() : A_.width();
+        const Expr num_cols = (bool)transpose_B_ ? B_.width() : B_.height();
+        const Expr sum_size = (bool)transpose_A_ ? A_.width() : A_.height();
+
+        // The register tile is two vectors down by kn columns across,
+        // which leaves enough registers for a column of A and an element
+        // of B: 16 registers with AVX2, 32 with AVX-512 or on ARMv8.
+        const Target tgt = get_target();
+        const bool has_avx512 = tgt.has_feature(Target::AVX512) ||
+                                tgt.has_feature(Target::AVX512_KNL) ||
+                                tgt.has_feature(Target::AVX512_Skylake) ||
+                                tgt.has_feature(Target::AVX512_Cannonlake);
+        const int vec = natural_vector_size(a_.type());
+        const int km = vec * 2;
+        int kn = 4;
+        if (has_avx512 || (tgt.arch == Target::ARM && tgt.bits == 64)) {
+            kn = 8;
+        } else if (tgt.has_feature(Target::AVX2)) {
+            kn = 6;
+        }
+        const int bm = std::max(km, (int)block_m_ / km * km);
+        const int bn = std::max(kn, (int)block_n_ / kn * kn);
+        const int bk = block_k_;
+
+        Var i("i"), j("j"), k("k"), ko("ko");
+        Var ii("ii"), io("io"), ji("ji"), jo("jo");
+
+        // Out-of-bounds reads happen in the partial blocks at the edges
+        // of the output, and contribute zero.
+        Func A_bounded = BoundaryConditions::constant_exterior(A_, cast<T>(0));
+        Func B_bounded = BoundaryConditions::constant_exterior(B_, cast<T>(0));
+
+        Func A("A"), B("B");
+        if (transpose_A_) {
+            A(i, k) = A_bounded(k, i);
+        } else {
+            A(i, k) = A_bounded(i, k);
+        }
+        if (transpose_B_) {
+            B(k, j) = B_bounded(j, k);
+        } else {
+            B(k, j) = B_bounded(k, j);
+        }
+
+        // The packed panels: A in strips of km rows, and B in strips of kn
+        // columns, each stored with k outside the strip.
+        Func A_packed("A_packed"), B_packed("B_packed");
+        A_packed(ii, k, io) = A(io * km + ii, k);
+        B_packed(ji, k, jo) = B(k, jo * kn + ji);
+
+        // The product of one block of the reduction.
+        RDom rk(0, bk);
+        rk.where(ko * bk + rk < sum_size);
+        Func ABk("ABk");
+        ABk(i, j, ko) += A_packed(i % km, ko * bk + rk, i / km) * B_packed(j % kn, ko * bk + rk, j / kn);
+
+        // Sum over the blocks of the reduction.
+        RDom rko(0, (sum_size + bk - 1) / bk);
+        Func AB("AB");
+        AB(i, j) += ABk(i, j, rko);
+
+        // Do the part that makes it a 'general' matrix multiply.
+        result_(i, j) = a_ * AB(i, j) + b_ * C_(i, j);
+
+        Var t("t"), ib("ib"), jb("jb"), im("im"), jm("jm"), iu("iu"), ju("ju");
+        result_
+            .tile(i, j, ib, jb, i, j, bm, bn, TailStrategy::GuardWithIf)
+            .fuse(ib, jb, t).parallel(t)
+            .vectorize(i, vec, TailStrategy::GuardWithIf);
+
+        // Each task's block of the output, accumulated across blocks of
+        // the reduction. Partial blocks at the edges are computed in full.
+        AB.compute_at(result_, t)
+            .bound_extent(i, bm).bound_extent(j, bn)
+            .vectorize(i, vec)
+            .update()
+            .split(i, im, iu, km).split(j, jm, ju, kn)
+            .reorder(iu, ju, im, jm, rko)
+            .vectorize(iu).unroll(ju);
+
+        // Pack the block of A and B needed for each block of the reduction.
+        A_packed.compute_at(AB, rko)
+            .bound_extent(ii, km).vectorize(ii);
+        B_packed.compute_at(AB, rko)
+            .bound_extent(ji, kn).unroll(ji);
+
+        // The register tile.
+        ABk.compute_at(AB, im)
+            .bound_extent(i, km).vectorize(i)
+            .bound_extent(j, kn).unroll(j)
+            .update()
+            .reorder(i, j, rk).vectorize(i).unroll(j);
+
+        result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
+
+        A_.dim(0).set_min(0).dim(1).set_min(0);
+        B_.dim(0).set_min(0).dim(1).set_min(0);
+        if (transpose_B_) {
+            B_.dim(1).set_extent(sum_size);
+        } else {
+            B_.dim(0).set_extent(sum_size);
+        }
+        C_.dim(0).set_bounds(0, num_rows);
+        C_.dim(1).set_bounds(0, num_cols);
+        result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols);
+    }
+};
+
+// Generator class for many small BLAS gemm operations at once. Dimension
+// 2 of every matrix indexes the problem in the batch. Each problem is
+// small enough to run straight out of L1, so there's no packing: the
+// output is computed one register tile at a time, reading A and B in
+// place, and parallelism comes from spreading the batch across tasks.
+template<class T>
+class BatchedGEMMGenerator :
+        public Generator<BatchedGEMMGenerator<T>> {
+  public:
+    typedef Generator<BatchedGEMMGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+
+    GeneratorParam<bool> transpose_A_ = {"transpose_A", false};
+    GeneratorParam<bool> transpose_B_ = {"transpose_B", false};
+
+    // The approximate number of multiply-adds to give each parallel
+    // task; small enough problems are grouped together to reach it.
+    GeneratorParam<int> task_size_ = {"task_size", 1 << 16};
+
+    // Standard ordering of parameters in GEMM functions.
+    Input<T>         a_ = {"a_", 1};
+    Input<Buffer<T>> A_ = {"A_", 3};
+    Input<Buffer<T>> B_ = {"B_", 3};
+    Input<T>         b_ = {"b_", 1};
+    Input<Buffer<T>> C_ = {"C_", 3};
+
+    Output<Buffer<T>> result_ = {"result", 3};
+
+    void generate() {
+        const Expr num_rows = (bool)transpose_A_ ? A_.dim(1).extent() : A_.dim(0).extent();
+        const Expr num_cols = (bool)transpose_B_ ? B_.dim(0).extent() : B_.dim(1).extent();
+        const Expr sum_size = (bool)transpose_A_ ? A_.dim(0).extent() : A_.dim(1).extent();
+        const Expr batch_size = C_.dim(2).extent();
+
+        const int vec = natural_vector_size(a_.type());
+        const int kn = 4;
+
+        Var i("i"), j("j"), k("k"), n("n");
+
+        Func A("A"), B("B");
+        if (transpose_A_) {
+            A(i, k, n) = A_(k, i, n);
+        } else {
+            A(i, k, n) = A_(i, k, n);
+        }
+        if (transpose_B_) {
+            B(k, j, n) = B_(j, k, n);
+        } else {
+            B(k, j, n) = B_(k, j, n);
+        }
+
+        RDom rk(0, sum_size);
+        Func AB("AB");
+        AB(i, j, n) += A(i, rk, n) * B(rk, j, n);
+
+        // Do the part that makes it a 'general' matrix multiply.
+        result_(i, j, n) = a_ * AB(i, j, n) + b_ * C_(i, j, n);
+
+        // The register tile is one vector down by kn columns across. The
+        // tiles at the edges of a problem are trimmed rather than rounded
+        // up, so nothing is read out of bounds.
+        Var io("io"), jo("jo");
+        // The work per problem is computed in 64 bits, as it overflows
+        // 32 bits for large problems.
+        const Expr work_per_problem = max(1, cast<int64_t>(num_rows) * num_cols * sum_size);
+        const Expr problems_per_task = cast<int>(max(1, cast<int64_t>(task_size_) / work_per_problem));
+        result_
+            .tile(i, j, io, jo, i, j, vec, kn, TailStrategy::GuardWithIf)
+            .vectorize(i).unroll(j)
+            .parallel(n, problems_per_task, TailStrategy::GuardWithIf);
+
+        AB.compute_at(result_, io)
+            .vectorize(i, vec, TailStrategy::GuardWithIf)
+            .unroll(j, kn, TailStrategy::GuardWithIf)
+            .update()
+            .reorder(i, j, rk)
+            .vectorize(i, vec, TailStrategy::GuardWithIf)
+            .unroll(j, kn, TailStrategy::GuardWithIf);
+
+        A_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        B_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        if (transpose_B_) {
+            B_.dim(1).set_extent(sum_size);
+        } else {
+            B_.dim(0).set_extent(sum_size);
+        }
+        C_.dim(0).set_bounds(0, num_rows);
+        C_.dim(1).set_bounds(0, num_cols);
+        C_.dim(2).set_min(0);
+        result_.dim(0).set_bounds(0, num_rows)
+            .dim(1).set_bounds(0, num_cols)
+            .dim(2).set_bounds(0, batch_size);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(PackedGEMMGenerator<float>, sgemm_packed)
+HALIDE_REGISTER_GENERATOR(PackedGEMMGenerator<double>, dgemm_packed)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<float>, sgemm_batched)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<double>, dgemm_batched)
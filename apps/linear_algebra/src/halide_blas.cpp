@@ -1,5 +1,7 @@
 #include <string.h>
+#include <cstddef>
 #include <iostream>
+#include <vector>
 #include "halide_blas.h"
 #include "HalideBuffer.h"
 
@@ -29,6 +31,171 @@ Buffer<T> init_matrix_buffer(const int M, const int N, T *A, const int lda) {
     return Buffer<T>(A, 2, shape);
 }
 
+template<typename T>
+Buffer<T> init_batched_matrix_buffer(const int M, const int N, T *A, const int lda,
+                                     const int stride, const int batch_count) {
+    halide_dimension_t shape[] = {{0, M, 1}, {0, N, lda}, {0, batch_count, stride}};
+    return Buffer<T>(A, 3, shape);
+}
+
+bool is_trans(const enum HBLAS_TRANSPOSE trans) {
+    return trans == HblasTrans || trans == HblasConjTrans;
+}
+
+// If the pointers are evenly spaced, as they are when the caller
+// allocated all the problems in one array, get the spacing, so that
+// the batch can be run in place.
+template<typename T>
+bool get_uniform_stride(const T *const ptrs[], const int count, int *stride) {
+    const ptrdiff_t s = count > 1 ? ptrs[1] - ptrs[0] : 0;
+    if ((ptrdiff_t)(int)s != s) {
+        return false;
+    }
+    for (int n = 2; n < count; n++) {
+        if (ptrs[n] - ptrs[0] != s * n) {
+            return false;
+        }
+    }
+    *stride = (int)s;
+    return true;
+}
+
+// Copy a batch of M x N matrices, with element (i, j) at i * inc + j * ld,
+// into and out of one dense array. Vectors are matrices with one column.
+template<typename T>
+void gather_matrices(const int M, const int N, const T *const src[], const int inc,
+                     const int ld, const int count, std::vector<T> *dst) {
+    dst->resize((size_t)M * N * count);
+    T *d = dst->data();
+    for (int n = 0; n < count; n++) {
+        for (int j = 0; j < N; j++) {
+            for (int i = 0; i < M; i++) {
+                *d++ = src[n][(ptrdiff_t)i * inc + (ptrdiff_t)j * ld];
+            }
+        }
+    }
+}
+
+template<typename T>
+void scatter_matrices(const int M, const int N, const std::vector<T> &src, T *const dst[],
+                      const int inc, const int ld, const int count) {
+    const T *s = src.data();
+    for (int n = 0; n < count; n++) {
+        for (int j = 0; j < N; j++) {
+            for (int i = 0; i < M; i++) {
+                dst[n][(ptrdiff_t)i * inc + (ptrdiff_t)j * ld] = *s++;
+            }
+        }
+    }
+}
+
+template<typename T>
+using BatchedGEMM = int (*)(bool, bool, T, halide_buffer_t *, halide_buffer_t *, T, halide_buffer_t *);
+
+template<typename T>
+void gemm_strided_batched(BatchedGEMM<T> kernel, const bool tA, const bool tB,
+                          const int M, const int N, const int K, const T alpha,
+                          const T *A, const int lda, const int strideA,
+                          const T *B, const int ldb, const int strideB,
+                          const T beta, T *C, const int ldc, const int strideC,
+                          const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+    auto buff_A = init_batched_matrix_buffer(tA ? K : M, tA ? M : K, const_cast<T*>(A), lda, strideA, batch_count);
+    auto buff_B = init_batched_matrix_buffer(tB ? N : K, tB ? K : N, const_cast<T*>(B), ldb, strideB, batch_count);
+    auto buff_C = init_batched_matrix_buffer(M, N, C, ldc, strideC, batch_count);
+
+    assert_no_error(kernel(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
+template<typename T>
+void gemm_batched(BatchedGEMM<T> kernel, const bool tA, const bool tB,
+                  const int M, const int N, const int K, const T alpha,
+                  const T *const A[], const int lda, const T *const B[], const int ldb,
+                  const T beta, T *const C[], const int ldc, const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+    int strideA, strideB, strideC;
+    if (get_uniform_stride(A, batch_count, &strideA) &&
+        get_uniform_stride(B, batch_count, &strideB) &&
+        get_uniform_stride<T>(C, batch_count, &strideC)) {
+        gemm_strided_batched(kernel, tA, tB, M, N, K, alpha, A[0], lda, strideA,
+                             B[0], ldb, strideB, beta, C[0], ldc, strideC, batch_count);
+        return;
+    }
+
+    // The problems are scattered through memory, so copy them together.
+    const int rows_A = tA ? K : M, cols_A = tA ? M : K;
+    const int rows_B = tB ? N : K, cols_B = tB ? K : N;
+    std::vector<T> a, b, c;
+    gather_matrices(rows_A, cols_A, A, 1, lda, batch_count, &a);
+    gather_matrices(rows_B, cols_B, B, 1, ldb, batch_count, &b);
+    gather_matrices<T>(M, N, C, 1, ldc, batch_count, &c);
+    gemm_strided_batched(kernel, tA, tB, M, N, K, alpha, a.data(), rows_A, rows_A * cols_A,
+                         b.data(), rows_B, rows_B * cols_B, beta, c.data(), M, M * N, batch_count);
+    scatter_matrices(M, N, c, C, 1, ldc, batch_count);
+}
+
+// A batch of gemvs is a batch of gemms with one column.
+template<typename T>
+void gemv_strided_batched(BatchedGEMM<T> kernel, const bool t, const int M, const int N,
+                          const T alpha, const T *A, const int lda, const int strideA,
+                          const T *x, const int incx, const int strideX,
+                          const T beta, T *y, const int incy, const int strideY,
+                          const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+    const int size_x = t ? M : N, size_y = t ? N : M;
+    if (incx != 1 || incy != 1) {
+        // The kernels want dense vectors.
+        std::vector<const T *> xs(batch_count);
+        std::vector<T *> ys(batch_count);
+        for (int n = 0; n < batch_count; n++) {
+            xs[n] = x + (ptrdiff_t)n * strideX;
+            ys[n] = y + (ptrdiff_t)n * strideY;
+        }
+        std::vector<T> dense_x, dense_y;
+        gather_matrices(size_x, 1, xs.data(), incx, 0, batch_count, &dense_x);
+        gather_matrices<T>(size_y, 1, ys.data(), incy, 0, batch_count, &dense_y);
+        gemv_strided_batched(kernel, t, M, N, alpha, A, lda, strideA, dense_x.data(), 1, size_x,
+                             beta, dense_y.data(), 1, size_y, batch_count);
+        scatter_matrices(size_y, 1, dense_y, ys.data(), incy, 0, batch_count);
+        return;
+    }
+    gemm_strided_batched(kernel, t, false, size_y, 1, size_x, alpha, A, lda, strideA,
+                         x, size_x, strideX, beta, y, size_y, strideY, batch_count);
+}
+
+template<typename T>
+void gemv_batched(BatchedGEMM<T> kernel, const bool t, const int M, const int N,
+                  const T alpha, const T *const A[], const int lda,
+                  const T *const x[], const int incx,
+                  const T beta, T *const y[], const int incy, const int batch_count) {
+    if (batch_count <= 0) {
+        return;
+    }
+    int strideA, strideX, strideY;
+    if (get_uniform_stride(A, batch_count, &strideA) &&
+        get_uniform_stride(x, batch_count, &strideX) &&
+        get_uniform_stride<T>(y, batch_count, &strideY)) {
+        gemv_strided_batched(kernel, t, M, N, alpha, A[0], lda, strideA, x[0], incx, strideX,
+                             beta, y[0], incy, strideY, batch_count);
+        return;
+    }
+
+    const int size_x = t ? M : N, size_y = t ? N : M;
+    std::vector<T> a, dense_x, dense_y;
+    gather_matrices(M, N, A, 1, lda, batch_count, &a);
+    gather_matrices(size_x, 1, x, incx, 0, batch_count, &dense_x);
+    gather_matrices<T>(size_y, 1, y, incy, 0, batch_count, &dense_y);
+    gemv_strided_batched(kernel, t, M, N, alpha, a.data(), M, M * N, dense_x.data(), 1, size_x,
+                         beta, dense_y.data(), 1, size_y, batch_count);
+    scatter_matrices(size_y, 1, dense_y, y, incy, 0, batch_count);
+}
+
 }
 
 #ifdef __cplusplus
@@ -279,6 +446,93 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
     assert_no_error(halide_dgemm(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
 }
 
+/////////////
+// batched //
+/////////////
+
+void hblas_sgemv_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                                 const int M, const int N, const float a,
+                                 const float *A, const int lda, const int strideA,
+                                 const float *x, const int incx, const int stridex,
+                                 const float b, float *y, const int incy, const int stridey,
+                                 const int batch_count) {
+    gemv_strided_batched<float>(halide_sgemm_batched, is_trans(trans), M, N, a, A, lda, strideA,
+                                x, incx, stridex, b, y, incy, stridey, batch_count);
+}
+
+void hblas_dgemv_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                                 const int M, const int N, const double a,
+                                 const double *A, const int lda, const int strideA,
+                                 const double *x, const int incx, const int stridex,
+                                 const double b, double *y, const int incy, const int stridey,
+                                 const int batch_count) {
+    gemv_strided_batched<double>(halide_dgemm_batched, is_trans(trans), M, N, a, A, lda, strideA,
+                                 x, incx, stridex, b, y, incy, stridey, batch_count);
+}
+
+void hblas_sgemv_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                         const int M, const int N, const float a,
+                         const float *const A[], const int lda,
+                         const float *const x[], const int incx,
+                         const float b, float *const y[], const int incy,
+                         const int batch_count) {
+    gemv_batched<float>(halide_sgemm_batched, is_trans(trans), M, N, a, A, lda,
+                        x, incx, b, y, incy, batch_count);
+}
+
+void hblas_dgemv_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                         const int M, const int N, const double a,
+                         const double *const A[], const int lda,
+                         const double *const x[], const int incx,
+                         const double b, double *const y[], const int incy,
+                         const int batch_count) {
+    gemv_batched<double>(halide_dgemm_batched, is_trans(trans), M, N, a, A, lda,
+                         x, incx, b, y, incy, batch_count);
+}
+
+void hblas_sgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const float alpha,
+                                 const float *A, const int lda, const int strideA,
+                                 const float *B, const int ldb, const int strideB,
+                                 const float beta, float *C, const int ldc, const int strideC,
+                                 const int batch_count) {
+    gemm_strided_batched<float>(halide_sgemm_batched, is_trans(TransA), is_trans(TransB), M, N, K, alpha,
+                                A, lda, strideA, B, ldb, strideB, beta, C, ldc, strideC, batch_count);
+}
+
+void hblas_dgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const double alpha,
+                                 const double *A, const int lda, const int strideA,
+                                 const double *B, const int ldb, const int strideB,
+                                 const double beta, double *C, const int ldc, const int strideC,
+                                 const int batch_count) {
+    gemm_strided_batched<double>(halide_dgemm_batched, is_trans(TransA), is_trans(TransB), M, N, K, alpha,
+                                 A, lda, strideA, B, ldb, strideB, beta, C, ldc, strideC, batch_count);
+}
+
+void hblas_sgemm_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                         const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                         const int K, const float alpha,
+                         const float *const A[], const int lda,
+                         const float *const B[], const int ldb,
+                         const float beta, float *const C[], const int ldc,
+                         const int batch_count) {
+    gemm_batched<float>(halide_sgemm_batched, is_trans(TransA), is_trans(TransB), M, N, K, alpha,
+                        A, lda, B, ldb, beta, C, ldc, batch_count);
+}
+
+void hblas_dgemm_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                         const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                         const int K, const double alpha,
+                         const double *const A[], const int lda,
+                         const double *const B[], const int ldb,
+                         const double beta, double *const C[], const int ldc,
+                         const int batch_count) {
+    gemm_batched<double>(halide_dgemm_batched, is_trans(TransA), is_trans(TransB), M, N, K, alpha,
+                         A, lda, B, ldb, beta, C, ldc, batch_count);
+}
 
 #ifdef __cplusplus
 }
@@ -28,6 +28,22 @@
 #include "halide_dgemm_transB.h"
 #include "halide_sgemm_transAB.h"
 #include "halide_dgemm_transAB.h"
+#include "halide_sgemm_packed_notrans.h"
+#include "halide_dgemm_packed_notrans.h"
+#include "halide_sgemm_packed_transA.h"
+#include "halide_dgemm_packed_transA.h"
+#include "halide_sgemm_packed_transB.h"
+#include "halide_dgemm_packed_transB.h"
+#include "halide_sgemm_packed_transAB.h"
+#include "halide_dgemm_packed_transAB.h"
+#include "halide_sgemm_batched_notrans.h"
+#include "halide_dgemm_batched_notrans.h"
+#include "halide_sgemm_batched_transA.h"
+#include "halide_dgemm_batched_transA.h"
+#include "halide_sgemm_batched_transB.h"
+#include "halide_dgemm_batched_transB.h"
+#include "halide_sgemm_batched_transAB.h"
+#include "halide_dgemm_batched_transAB.h"
 
 inline int halide_scopy(halide_buffer_t *x, halide_buffer_t *y) {
     return halide_scopy_impl(0, x, nullptr, y);
@@ -77,7 +93,29 @@ inline int halide_dger(float a, halide_buffer_t *x, halide_buffer_t *y, halide_b
     return halide_dger_impl(a, x, y, A);
 }
 
+// The packed gemm kernels pay for copying their operands, and compute
+// whole blocks even at the edges of the output, so they only win on
+// large matrices.
+inline bool use_packed_gemm(bool transA, halide_buffer_t *A, halide_buffer_t *C) {
+    const int min_size = 256;
+    const int M = C->dim[0].extent;
+    const int N = C->dim[1].extent;
+    const int K = transA ? A->dim[0].extent : A->dim[1].extent;
+    return M >= min_size && N >= min_size && K >= min_size;
+}
+
 inline int halide_sgemm(bool transA, bool transB, float a, halide_buffer_t *A, halide_buffer_t *B, float b, halide_buffer_t *C) {
+    if (use_packed_gemm(transA, A, C)) {
+        if (transA && transB) {
+            return halide_sgemm_packed_transAB(a, A, B, b, C, C);
+        } else if (transA) {
+            return halide_sgemm_packed_transA(a, A, B, b, C, C);
+        } else if (transB) {
+            return halide_sgemm_packed_transB(a, A, B, b, C, C);
+        } else {
+            return halide_sgemm_packed_notrans(a, A, B, b, C, C);
+        }
+    }
     if (transA && transB) {
         return halide_sgemm_transAB(a, A, B, b, C, C);
     } else if (transA) {
@@ -91,6 +129,17 @@ inline int halide_sgemm(bool transA, bool transB, float a, halide_buffer_t *A, h
 }
 
 inline int halide_dgemm(bool transA, bool transB, double a, halide_buffer_t *A, halide_buffer_t *B, double b, halide_buffer_t *C) {
+    if (use_packed_gemm(transA, A, C)) {
+        if (transA && transB) {
+            return halide_dgemm_packed_transAB(a, A, B, b, C, C);
+        } else if (transA) {
+            return halide_dgemm_packed_transA(a, A, B, b, C, C);
+        } else if (transB) {
+            return halide_dgemm_packed_transB(a, A, B, b, C, C);
+        } else {
+            return halide_dgemm_packed_notrans(a, A, B, b, C, C);
+        }
+    }
     if (transA && transB) {
         return halide_dgemm_transAB(a, A, B, b, C, C);
     } else if (transA) {
@@ -103,6 +152,31 @@ inline int halide_dgemm(bool transA, bool transB, double a, halide_buffer_t *A,
     return -1;
 }
 
+// Dimension 2 of A, B and C indexes the problem in the batch.
+inline int halide_sgemm_batched(bool transA, bool transB, float a, halide_buffer_t *A, halide_buffer_t *B, float b, halide_buffer_t *C) {
+    if (transA && transB) {
+        return halide_sgemm_batched_transAB(a, A, B, b, C, C);
+    } else if (transA) {
+        return halide_sgemm_batched_transA(a, A, B, b, C, C);
+    } else if (transB) {
+        return halide_sgemm_batched_transB(a, A, B, b, C, C);
+    } else {
+        return halide_sgemm_batched_notrans(a, A, B, b, C, C);
+    }
+}
+
+inline int halide_dgemm_batched(bool transA, bool transB, double a, halide_buffer_t *A, halide_buffer_t *B, double b, halide_buffer_t *C) {
+    if (transA && transB) {
+        return halide_dgemm_batched_transAB(a, A, B, b, C, C);
+    } else if (transA) {
+        return halide_dgemm_batched_transA(a, A, B, b, C, C);
+    } else if (transB) {
+        return halide_dgemm_batched_transB(a, A, B, b, C, C);
+    } else {
+        return halide_dgemm_batched_notrans(a, A, B, b, C, C);
+    }
+}
+
 enum HBLAS_ORDER {HblasRowMajor=101, HblasColMajor=102};
 enum HBLAS_TRANSPOSE {HblasNoTrans=111, HblasTrans=112, HblasConjTrans=113};
 enum HBLAS_UPLO {HblasUpper=121, HblasLower=122};
@@ -244,6 +318,78 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
                  const int lda, const double *B, const int ldb,
                  const double beta, double *C, const int ldc);
 
+/*
+ * ===========================================================================
+ * Prototypes for batched BLAS
+ * ===========================================================================
+ */
+
+/*
+ * Each of these does batch_count independent operations of the same
+ * shape in one call. In the strided versions, the operands of each
+ * problem start stride elements after those of the one before; in the
+ * others, they're given by arrays of pointers.
+ */
+void hblas_sgemv_strided_batched(const enum HBLAS_ORDER order,
+                                 const enum HBLAS_TRANSPOSE TransA, const int M, const int N,
+                                 const float alpha, const float *A, const int lda, const int strideA,
+                                 const float *X, const int incX, const int strideX,
+                                 const float beta, float *Y, const int incY, const int strideY,
+                                 const int batch_count);
+
+void hblas_dgemv_strided_batched(const enum HBLAS_ORDER order,
+                                 const enum HBLAS_TRANSPOSE TransA, const int M, const int N,
+                                 const double alpha, const double *A, const int lda, const int strideA,
+                                 const double *X, const int incX, const int strideX,
+                                 const double beta, double *Y, const int incY, const int strideY,
+                                 const int batch_count);
+
+void hblas_sgemv_batched(const enum HBLAS_ORDER order,
+                         const enum HBLAS_TRANSPOSE TransA, const int M, const int N,
+                         const float alpha, const float *const A[], const int lda,
+                         const float *const X[], const int incX,
+                         const float beta, float *const Y[], const int incY,
+                         const int batch_count);
+
+void hblas_dgemv_batched(const enum HBLAS_ORDER order,
+                         const enum HBLAS_TRANSPOSE TransA, const int M, const int N,
+                         const double alpha, const double *const A[], const int lda,
+                         const double *const X[], const int incX,
+                         const double beta, double *const Y[], const int incY,
+                         const int batch_count);
+
+void hblas_sgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const float alpha,
+                                 const float *A, const int lda, const int strideA,
+                                 const float *B, const int ldb, const int strideB,
+                                 const float beta, float *C, const int ldc, const int strideC,
+                                 const int batch_count);
+
+void hblas_dgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const double alpha,
+                                 const double *A, const int lda, const int strideA,
+                                 const double *B, const int ldb, const int strideB,
+                                 const double beta, double *C, const int ldc, const int strideC,
+                                 const int batch_count);
+
+void hblas_sgemm_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                         const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                         const int K, const float alpha,
+                         const float *const A[], const int lda,
+                         const float *const B[], const int ldb,
+                         const float beta, float *const C[], const int ldc,
+                         const int batch_count);
+
+void hblas_dgemm_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                         const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                         const int K, const double alpha,
+                         const double *const A[], const int lda,
+                         const double *const B[], const int ldb,
+                         const double beta, double *const C[], const int ldc,
+                         const int batch_count);
+
 #ifdef __cplusplus
 }
 #endif
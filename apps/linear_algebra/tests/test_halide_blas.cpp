@@ -1,14 +1,16 @@
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <random>
 #include <string>
+#include <vector>
 #include <cblas.h>
 #include <halide_blas.h>
 
 #define RUN_TEST(method)                                                \
-    std::cout << std::setw(30) << ("Testing " #method ": ") << std::flush; \
+    std::cout << std::setw(40) << ("Testing " #method ": ") << std::flush; \
     if (test_##method(N)) {                                             \
         std::cout << "PASSED\n";                                        \
     }                                                                   \
@@ -111,6 +113,89 @@
         return compareMatrices(N, eC, aC);      \
     }
 
+// The batched tests run a batch of non-square problems through one
+// hblas call and compare against calling cblas on each problem in
+// turn. If 'permute' is true, the problems are passed out of order, so
+// that they aren't evenly spaced in memory; otherwise the pointer-array
+// entry points can treat them as a strided batch. The vectors of the
+// gemv tests are spaced inc_x and inc_y elements apart.
+#define L2_BATCHED_TEST(method, permute, inc_x, inc_y, cblas_code, hblas_code) \
+    bool test_##method(int size) {                                      \
+        const int batch = 4;                                            \
+        const int permuted[batch] = {2, 0, 3, 1};                       \
+        const int identity[batch] = {0, 1, 2, 3};                       \
+        const int *order = (permute) ? permuted : identity;             \
+        const int M = size + 3, N = size / 2 + 1;                       \
+        const int incx = inc_x, incy = inc_y;                           \
+        const int strideA = M * N;                                      \
+        const int strideX = std::max(M, N) * incx;                      \
+        const int strideY = std::max(M, N) * incy;                      \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        Vector ex(random_vector(strideX * batch));                      \
+        Vector ey(random_vector(strideY * batch));                      \
+        Matrix eA(random_vector(strideA * batch));                      \
+        Vector ax(ex), ay(ey);                                          \
+        Matrix aA(eA);                                                  \
+                                                                        \
+        for (int n = 0; n < batch; n++) {                               \
+            Scalar *x = &(ex[order[n] * strideX]);                      \
+            Scalar *y = &(ey[order[n] * strideY]);                      \
+            Scalar *A = &(eA[order[n] * strideA]);                      \
+            cblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        {                                                               \
+            std::vector<Scalar *> x(batch), y(batch), A(batch);         \
+            for (int n = 0; n < batch; n++) {                           \
+                x[n] = &(ax[order[n] * strideX]);                       \
+                y[n] = &(ay[order[n] * strideY]);                       \
+                A[n] = &(aA[order[n] * strideA]);                       \
+            }                                                           \
+            hblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        return compareVectors(strideY * batch, ey, ay);                 \
+    }
+
+#define L3_BATCHED_TEST(method, permute, trans_a, trans_b, cblas_code, hblas_code) \
+    bool test_##method(int size) {                                      \
+        const int batch = 4;                                            \
+        const int permuted[batch] = {2, 0, 3, 1};                       \
+        const int identity[batch] = {0, 1, 2, 3};                       \
+        const int *order = (permute) ? permuted : identity;             \
+        const int M = size + 3, N = size / 2 + 1, K = size + 1;         \
+        const int lda = (trans_a) ? K : M;                              \
+        const int ldb = (trans_b) ? N : K;                              \
+        const int ldc = M;                                              \
+        const int strideA = M * K, strideB = K * N, strideC = M * N;    \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        Matrix eA(random_vector(strideA * batch));                      \
+        Matrix eB(random_vector(strideB * batch));                      \
+        Matrix eC(random_vector(strideC * batch));                      \
+        Matrix aA(eA), aB(eB), aC(eC);                                  \
+                                                                        \
+        for (int n = 0; n < batch; n++) {                               \
+            Scalar *A = &(eA[order[n] * strideA]);                      \
+            Scalar *B = &(eB[order[n] * strideB]);                      \
+            Scalar *C = &(eC[order[n] * strideC]);                      \
+            cblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        {                                                               \
+            std::vector<Scalar *> A(batch), B(batch), C(batch);         \
+            for (int n = 0; n < batch; n++) {                           \
+                A[n] = &(aA[order[n] * strideA]);                       \
+                B[n] = &(aB[order[n] * strideB]);                       \
+                C[n] = &(aC[order[n] * strideC]);                       \
+            }                                                           \
+            hblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        return compareVectors(strideC * batch, eC, aC);                 \
+    }
+
 
 template<class T>
 struct BLASTestBase {
@@ -210,6 +295,16 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(sgemv_batched_notrans);
+        RUN_TEST(sgemv_batched_trans);
+        RUN_TEST(sgemv_batched_uniform);
+        RUN_TEST(sgemv_batched_inc);
+        RUN_TEST(sgemv_strided_batched);
+        RUN_TEST(sgemv_strided_batched_inc);
+        RUN_TEST(sgemm_strided_batched_notrans);
+        RUN_TEST(sgemm_strided_batched_transAB);
+        RUN_TEST(sgemm_batched_transA);
+        RUN_TEST(sgemm_batched_transB_uniform);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -241,6 +336,44 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+
+    L2_BATCHED_TEST(sgemv_batched_notrans, true, 1, 1,
+            cblas_sgemv(CblasColMajor, CblasNoTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_sgemv_batched(HblasColMajor, HblasNoTrans, M, N, alpha, A.data(), M, x.data(), 1, beta, y.data(), 1, batch));
+    L2_BATCHED_TEST(sgemv_batched_trans, true, 1, 1,
+            cblas_sgemv(CblasColMajor, CblasTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_sgemv_batched(HblasColMajor, HblasTrans, M, N, alpha, A.data(), M, x.data(), 1, beta, y.data(), 1, batch));
+    L2_BATCHED_TEST(sgemv_batched_uniform, false, 1, 1,
+            cblas_sgemv(CblasColMajor, CblasNoTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_sgemv_batched(HblasColMajor, HblasNoTrans, M, N, alpha, A.data(), M, x.data(), 1, beta, y.data(), 1, batch));
+    L2_BATCHED_TEST(sgemv_batched_inc, true, 2, 3,
+            cblas_sgemv(CblasColMajor, CblasTrans, M, N, alpha, A, M, x, incx, beta, y, incy),
+            hblas_sgemv_batched(HblasColMajor, HblasTrans, M, N, alpha, A.data(), M, x.data(), incx, beta, y.data(), incy, batch));
+    L2_BATCHED_TEST(sgemv_strided_batched, false, 1, 1,
+            cblas_sgemv(CblasColMajor, CblasNoTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_sgemv_strided_batched(HblasColMajor, HblasNoTrans, M, N, alpha, A[0], M, strideA,
+                                        x[0], 1, strideX, beta, y[0], 1, strideY, batch));
+    L2_BATCHED_TEST(sgemv_strided_batched_inc, false, 3, 2,
+            cblas_sgemv(CblasColMajor, CblasTrans, M, N, alpha, A, M, x, incx, beta, y, incy),
+            hblas_sgemv_strided_batched(HblasColMajor, HblasTrans, M, N, alpha, A[0], M, strideA,
+                                        x[0], incx, strideX, beta, y[0], incy, strideY, batch));
+
+    L3_BATCHED_TEST(sgemm_strided_batched_notrans, false, false, false,
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_sgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasNoTrans, M, N, K, alpha,
+                                        A[0], lda, strideA, B[0], ldb, strideB, beta, C[0], ldc, strideC, batch));
+    L3_BATCHED_TEST(sgemm_strided_batched_transAB, false, true, true,
+            cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_sgemm_strided_batched(HblasColMajor, HblasTrans, HblasTrans, M, N, K, alpha,
+                                        A[0], lda, strideA, B[0], ldb, strideB, beta, C[0], ldc, strideC, batch));
+    L3_BATCHED_TEST(sgemm_batched_transA, true, true, false,
+            cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_sgemm_batched(HblasColMajor, HblasTrans, HblasNoTrans, M, N, K, alpha,
+                                A.data(), lda, B.data(), ldb, beta, C.data(), ldc, batch));
+    L3_BATCHED_TEST(sgemm_batched_transB_uniform, false, false, true,
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_sgemm_batched(HblasColMajor, HblasNoTrans, HblasTrans, M, N, K, alpha,
+                                A.data(), lda, B.data(), ldb, beta, C.data(), ldc, batch));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -257,6 +390,16 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dgemv_batched_notrans);
+        RUN_TEST(dgemv_batched_trans);
+        RUN_TEST(dgemv_batched_uniform);
+        RUN_TEST(dgemv_batched_inc);
+        RUN_TEST(dgemv_strided_batched);
+        RUN_TEST(dgemv_strided_batched_inc);
+        RUN_TEST(dgemm_strided_batched_notrans);
+        RUN_TEST(dgemm_strided_batched_transAB);
+        RUN_TEST(dgemm_batched_transA);
+        RUN_TEST(dgemm_batched_transB_uniform);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -288,6 +431,44 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+
+    L2_BATCHED_TEST(dgemv_batched_notrans, true, 1, 1,
+            cblas_dgemv(CblasColMajor, CblasNoTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_dgemv_batched(HblasColMajor, HblasNoTrans, M, N, alpha, A.data(), M, x.data(), 1, beta, y.data(), 1, batch));
+    L2_BATCHED_TEST(dgemv_batched_trans, true, 1, 1,
+            cblas_dgemv(CblasColMajor, CblasTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_dgemv_batched(HblasColMajor, HblasTrans, M, N, alpha, A.data(), M, x.data(), 1, beta, y.data(), 1, batch));
+    L2_BATCHED_TEST(dgemv_batched_uniform, false, 1, 1,
+            cblas_dgemv(CblasColMajor, CblasNoTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_dgemv_batched(HblasColMajor, HblasNoTrans, M, N, alpha, A.data(), M, x.data(), 1, beta, y.data(), 1, batch));
+    L2_BATCHED_TEST(dgemv_batched_inc, true, 2, 3,
+            cblas_dgemv(CblasColMajor, CblasTrans, M, N, alpha, A, M, x, incx, beta, y, incy),
+            hblas_dgemv_batched(HblasColMajor, HblasTrans, M, N, alpha, A.data(), M, x.data(), incx, beta, y.data(), incy, batch));
+    L2_BATCHED_TEST(dgemv_strided_batched, false, 1, 1,
+            cblas_dgemv(CblasColMajor, CblasNoTrans, M, N, alpha, A, M, x, 1, beta, y, 1),
+            hblas_dgemv_strided_batched(HblasColMajor, HblasNoTrans, M, N, alpha, A[0], M, strideA,
+                                        x[0], 1, strideX, beta, y[0], 1, strideY, batch));
+    L2_BATCHED_TEST(dgemv_strided_batched_inc, false, 3, 2,
+            cblas_dgemv(CblasColMajor, CblasTrans, M, N, alpha, A, M, x, incx, beta, y, incy),
+            hblas_dgemv_strided_batched(HblasColMajor, HblasTrans, M, N, alpha, A[0], M, strideA,
+                                        x[0], incx, strideX, beta, y[0], incy, strideY, batch));
+
+    L3_BATCHED_TEST(dgemm_strided_batched_notrans, false, false, false,
+            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_dgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasNoTrans, M, N, K, alpha,
+                                        A[0], lda, strideA, B[0], ldb, strideB, beta, C[0], ldc, strideC, batch));
+    L3_BATCHED_TEST(dgemm_strided_batched_transAB, false, true, true,
+            cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_dgemm_strided_batched(HblasColMajor, HblasTrans, HblasTrans, M, N, K, alpha,
+                                        A[0], lda, strideA, B[0], ldb, strideB, beta, C[0], ldc, strideC, batch));
+    L3_BATCHED_TEST(dgemm_batched_transA, true, true, false,
+            cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_dgemm_batched(HblasColMajor, HblasTrans, HblasNoTrans, M, N, K, alpha,
+                                A.data(), lda, B.data(), ldb, beta, C.data(), ldc, batch));
+    L3_BATCHED_TEST(dgemm_batched_transB_uniform, false, false, true,
+            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc),
+            hblas_dgemm_batched(HblasColMajor, HblasNoTrans, HblasTrans, M, N, K, alpha,
+                                A.data(), lda, B.data(), ldb, beta, C.data(), ldc, batch));
 };
 
 int main(int argc, char *argv[]) {
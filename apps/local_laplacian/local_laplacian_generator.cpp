@@ -8,6 +8,13 @@ constexpr int maxJ = 20;
 class LocalLaplacian : public Halide::Generator<LocalLaplacian> {
 public:
     GeneratorParam<int>     pyramid_levels{"pyramid_levels", 8, 1, maxJ};
+    // If nonzero, the CPU schedule computes the output in strips of this
+    // many rows, one strip at a time, and computes each level of the
+    // pyramids as the strips need it, sliding down the image. Each level
+    // only keeps the rows the current strip needs, so the memory used
+    // grows with the strip size and the width of the image, but not with
+    // its height. The work within a strip is parallelized.
+    GeneratorParam<int>     strip_size{"strip_size", 0, 0, 4096};
 
     Input<Buffer<uint16_t>> input{"input", 3};
     Input<int>              levels{"levels"};
@@ -119,6 +126,35 @@ public:
                 }
                 outGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
             }
+        } else if (strip_size > 0) {
+            // streaming cpu schedule
+            remap.compute_root();
+            Var yo;
+            // The strips of the output are computed in order, so each
+            // level of the pyramids only needs to compute the rows that
+            // the previous strips didn't need. The parallel loops within
+            // a strip are guarded rather than shifted, so that they don't
+            // compute rows outside of the folded storage.
+            const TailStrategy guard = TailStrategy::GuardWithIf;
+            output.reorder(c, x, y).split(y, yo, y, strip_size)
+                .parallel(y, 8, guard).vectorize(x, 8);
+            gray.store_root().compute_at(output, yo)
+                .fold_storage(y, strip_fold_factor(0))
+                .parallel(y, 8, guard).vectorize(x, 8);
+            for (int j = 1; j < J; j++) {
+                const int fold = strip_fold_factor(j);
+                inGPyramid[j]
+                    .store_root().compute_at(output, yo).fold_storage(y, fold)
+                    .parallel(y, 8, guard).vectorize(x, 8);
+                gPyramid[j]
+                    .store_root().compute_at(output, yo).fold_storage(y, fold)
+                    .reorder_storage(x, k, y)
+                    .reorder(k, y).parallel(y, 4, guard).vectorize(x, 8);
+                outGPyramid[j]
+                    .store_root().compute_at(output, yo).fold_storage(y, fold)
+                    .parallel(y, 8, guard).vectorize(x, 8);
+            }
+            outGPyramid[0].compute_at(output, y).vectorize(x, 8);
         } else {
             // cpu schedule
             remap.compute_root();
@@ -207,6 +243,41 @@ public:
 private:
     Var x, y, c, k;
 
+    // The number of rows of level j of the pyramids that may be needed to
+    // compute one strip of the output, rounded up to a power of two. This
+    // follows the bounds of downsample and upsample below: a row y of
+    // level j + 1 needs rows [2*y - 1, 2*y + 2] of level j, and a row y of
+    // level j needs rows [y/2 - 1, y/2 + 1] of level j + 1. The strips may
+    // start at any row.
+    int strip_fold_factor(int j) const {
+        const int J = pyramid_levels;
+        // Halide rounds division down.
+        auto half = [](int a) { return (a < 0 ? a - 1 : a) / 2; };
+        int rows = 1;
+        for (int y0 = 0; y0 < (1 << J); y0++) {
+            // The rows of each level needed by the output pyramid.
+            int lo[maxJ], hi[maxJ];
+            lo[0] = y0;
+            hi[0] = y0 + strip_size - 1;
+            for (int i = 1; i < J; i++) {
+                lo[i] = half(lo[i - 1]) - 1;
+                hi[i] = half(hi[i - 1]) + 1;
+            }
+            // The coarser levels of the input pyramids also need rows of
+            // the finer levels.
+            for (int i = J - 1; i > j; i--) {
+                lo[i - 1] = std::min(lo[i - 1], 2 * lo[i] - 1);
+                hi[i - 1] = std::max(hi[i - 1], 2 * hi[i] + 2);
+            }
+            rows = std::max(rows, hi[j] - lo[j] + 1);
+        }
+        int fold = 1;
+        while (fold < rows) {
+            fold *= 2;
+        }
+        return fold;
+    }
+
     // Downsample with a 1 3 3 1 filter
     Func downsample(Func f) {
         using Halide::_;
@@ -1,10 +1,15 @@
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include <chrono>
 
 #include "local_laplacian.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "local_laplacian_auto_schedule.h"
 #endif
+#ifndef NO_STREAMING
+#include "local_laplacian_streaming.h"
+#endif
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -13,6 +18,47 @@
 using namespace Halide::Runtime;
 using namespace Halide::Tools;
 
+namespace {
+
+// The heap memory allocated by the pipelines, to report the peak of each.
+std::atomic<size_t> allocated_bytes(0), peak_allocated_bytes(0);
+
+void *counting_malloc(void *user_context, size_t size) {
+    // Halide requires the allocation to be aligned to the natural vector
+    // size. Keep the original pointer and the size just before it.
+    const size_t alignment = 128;
+    void *orig = malloc(size + alignment);
+    if (orig == nullptr) {
+        return nullptr;
+    }
+    void *ptr = (void *)((((size_t)orig + alignment) / alignment) * alignment);
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = size;
+
+    size_t total = (allocated_bytes += size);
+    size_t peak = peak_allocated_bytes;
+    while (total > peak && !peak_allocated_bytes.compare_exchange_weak(peak, total)) {
+    }
+    return ptr;
+}
+
+void counting_free(void *user_context, void *ptr) {
+    allocated_bytes -= ((size_t *)ptr)[-2];
+    free(((void **)ptr)[-1]);
+}
+
+// Run a benchmark of one of the pipelines, and report its time and the
+// peak memory it allocated.
+template<typename F>
+void benchmark_pipeline(const char *name, int timing, F pipeline) {
+    peak_allocated_bytes = (size_t)allocated_bytes;
+    double best = benchmark(timing, 1, pipeline);
+    printf("%s time: %gms, peak memory: %.1fMB\n", name, best * 1e3,
+           peak_allocated_bytes / (1024.0 * 1024.0));
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
     if (argc < 7) {
         printf("Usage: ./process input.png levels alpha beta timing_iterations output.png\n"
@@ -28,22 +74,39 @@ int main(int argc, char **argv) {
     Buffer<uint16_t> output(input.width(), input.height(), 3);
     int timing = atoi(argv[5]);
 
+    halide_set_custom_malloc(counting_malloc);
+    halide_set_custom_free(counting_free);
+
     local_laplacian(input, levels, alpha/(levels-1), beta, output);
 
     // Timing code
 
     // Manually-tuned version
-    double best_manual = benchmark(timing, 1, [&]() {
+    benchmark_pipeline("Manually-tuned", timing, [&]() {
         local_laplacian(input, levels, alpha/(levels-1), beta, output);
     });
-    printf("Manually-tuned time: %gms\n", best_manual * 1e3);
+
+    #ifndef NO_STREAMING
+    // Manually-tuned version that streams the pyramids in strips. It
+    // should compute exactly the same output.
+    Buffer<uint16_t> streamed_output(input.width(), input.height(), 3);
+    benchmark_pipeline("Streaming", timing, [&]() {
+        local_laplacian_streaming(input, levels, alpha/(levels-1), beta, streamed_output);
+    });
+    streamed_output.for_each_element([&](int x, int y, int c) {
+        if (streamed_output(x, y, c) != output(x, y, c)) {
+            printf("Streaming output mismatch at %d %d %d: %d != %d\n", x, y, c,
+                   streamed_output(x, y, c), output(x, y, c));
+            exit(1);
+        }
+    });
+    #endif
 
     #ifndef NO_AUTO_SCHEDULE
     // Auto-scheduled version
-    double best_auto = benchmark(timing, 1, [&]() {
+    benchmark_pipeline("Auto-scheduled", timing, [&]() {
         local_laplacian_auto_schedule(input, levels, alpha/(levels-1), beta, output);
     });
-    printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
     #endif
 
     convert_and_save_image(output, argv[6]);
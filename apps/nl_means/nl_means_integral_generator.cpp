@@ -0,0 +1,145 @@
+#include "Halide.h"
+
+namespace {
+
+using namespace Halide;
+
+// The same non-local means filter as nl_means, with the patch differences
+// computed from integral images of the difference images rather than by
+// summing over each patch, so the cost per search offset doesn't depend on
+// the patch size. The sums are accumulated in a different order than in
+// nl_means, so the result differs by rounding.
+class NonLocalMeansIntegral : public Halide::Generator<NonLocalMeansIntegral> {
+public:
+    // The number of rows of the output computed by each parallel task.
+    GeneratorParam<int>   strip_size{"strip_size", 32};
+
+    Input<Buffer<float>>  input{"input", 3};
+    Input<int>            patch_size{"patch_size"};
+    Input<int>            search_area{"search_area"};
+    Input<float>          sigma{"sigma"};
+
+    Output<Buffer<float>> non_local_means{"non_local_means", 3};
+
+    void generate() {
+        /* THE ALGORITHM */
+
+        Var x("x"), y("y"), c("c");
+
+        Expr inv_sigma_sq = -1.0f/(sigma*sigma*patch_size*patch_size);
+
+        // The patch around (x, y) covers [x + lo, x + hi] x [y + lo, y + hi].
+        Expr lo = -(patch_size/2);
+        Expr hi = lo + patch_size - 1;
+
+        // Add a boundary condition
+        Func clamped = BoundaryConditions::repeat_edge(input);
+
+        // Define the difference images, summed across color channels
+        Var dx("dx"), dy("dy");
+        Func d("d");
+        d(x, y, dx, dy) = (pow(clamped(x, y, 0) - clamped(x + dx, y + dy, 0), 2) +
+                           pow(clamped(x, y, 1) - clamped(x + dx, y + dy, 1), 2) +
+                           pow(clamped(x, y, 2) - clamped(x + dx, y + dy, 2), 2));
+
+        // The running sum of each row of the difference images, from the
+        // left edge of the patches of the output.
+        Expr out_x_min = non_local_means.dim(0).min();
+        Expr out_width = non_local_means.dim(0).extent();
+        RDom rx(out_x_min + lo, out_width + patch_size - 1);
+        Func integral_x("integral_x");
+        integral_x(x, y, dx, dy) = 0.0f;
+        integral_x(rx, y, dx, dy) = integral_x(rx - 1, y, dx, dy) + d(rx, y, dx, dy);
+
+        // The sums over the width of the patches.
+        Func blur_d_x("blur_d_x");
+        blur_d_x(x, y, dx, dy) = integral_x(x + hi, y, dx, dy) - integral_x(x + lo - 1, y, dx, dy);
+
+        // The running sum down the columns of blur_d_x, restarting at each
+        // strip of the output, so the sums stay small enough to subtract
+        // accurately. Row j of strip t is the sum of the rows before row
+        // y_start + j, where y_start is the top of the patches of the strip.
+        const int T = strip_size;
+        Var j("j"), t("t");
+        Expr out_y_min = non_local_means.dim(1).min();
+        Expr y_start = out_y_min + t * T + lo;
+        RDom ry(1, T + patch_size - 1);
+        Func integral_y("integral_y");
+        integral_y(x, j, t, dx, dy) = 0.0f;
+        integral_y(x, ry, t, dx, dy) =
+            integral_y(x, ry - 1, t, dx, dy) + blur_d_x(x, y_start + ry - 1, dx, dy);
+
+        // Find the patch differences from the running sums
+        Expr strip = (y - out_y_min) / T;
+        Expr row = y - out_y_min - strip * T;
+        Func blur_d("blur_d");
+        blur_d(x, y, dx, dy) = (integral_y(x, row + patch_size, strip, dx, dy) -
+                                integral_y(x, row, strip, dx, dy));
+
+        // Compute the weights from the patch differences
+        Func w("w");
+        w(x, y, dx, dy) = fast_exp(blur_d(x, y, dx, dy)*inv_sigma_sq);
+
+        // Add an alpha channel
+        Func clamped_with_alpha("clamped_with_alpha");
+        clamped_with_alpha(x, y, c) = select(c == 0, clamped(x, y, 0),
+                                             c == 1, clamped(x, y, 1),
+                                             c == 2, clamped(x, y, 2),
+                                             1.0f);
+
+        // Define a reduction domain for the search area
+        RDom s_dom(-(search_area/2), search_area, -(search_area/2), search_area);
+
+        // Compute the sum of the pixels in the search area
+        Func non_local_means_sum("non_local_means_sum");
+        non_local_means_sum(x, y, c) += w(x, y, s_dom.x, s_dom.y) * clamped_with_alpha(x + s_dom.x, y + s_dom.y, c);
+
+        non_local_means(x, y, c) =
+            clamp(non_local_means_sum(x, y, c) / non_local_means_sum(x, y, 3), 0.0f, 1.0f);
+
+        /* THE SCHEDULE */
+
+        // Require 3 channels for output
+        non_local_means.dim(2).set_bounds(0, 3);
+
+        // Each task computes a strip of the output. The strips must line
+        // up with the strips of integral_y, so the last one is guarded
+        // rather than shifted up.
+        Var yo("yo");
+        non_local_means.compute_root()
+            .reorder(c, x, y)
+            .split(y, yo, y, T, TailStrategy::GuardWithIf)
+            .parallel(yo)
+            .vectorize(x, 8);
+        non_local_means_sum.compute_at(non_local_means, yo)
+            .reorder(c, x, y)
+            .bound(c, 0, 4).unroll(c)
+            .vectorize(x, 8);
+
+        // For each row of the search area, compute the running sums of the
+        // strip for all of the offsets in the row, and then accumulate the
+        // weighted pixels for each offset.
+        non_local_means_sum.update(0)
+            .reorder(c, x, y, s_dom.x, s_dom.y)
+            .unroll(c)
+            .vectorize(x, 8);
+
+        // The running sums along x are sequential in x, so vectorize them
+        // across the offsets instead.
+        integral_x.compute_at(non_local_means_sum, s_dom.y)
+            .vectorize(x, 8);
+        integral_x.update(0)
+            .reorder(dx, rx, y)
+            .vectorize(dx, 8, TailStrategy::GuardWithIf);
+
+        integral_y.compute_at(non_local_means_sum, s_dom.y)
+            .vectorize(x, 8);
+        integral_y.update(0)
+            .reorder(x, ry, dx)
+            .vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(NonLocalMeansIntegral, nl_means_integral)
@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <chrono>
 
 #include "nl_means.h"
 #include "nl_means_auto_schedule.h"
+#include "nl_means_integral.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -44,6 +47,24 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // Version computing the patch differences from integral images. It
+    // should match the others up to rounding.
+    Buffer<float> integral_output(input.width(), input.height(), 3);
+    double min_t_integral = benchmark(timing_iterations, 1, [&]() {
+        nl_means_integral(input, patch_size, search_area, sigma, integral_output);
+    });
+    printf("Integral image time: %gms\n", min_t_integral * 1e3);
+
+    float max_error = 0.0f;
+    integral_output.for_each_element([&](int x, int y, int c) {
+        max_error = std::max(max_error, std::abs(integral_output(x, y, c) - output(x, y, c)));
+    });
+    printf("Integral image max error: %g\n", max_error);
+    if (max_error > 1e-2f) {
+        printf("Integral image output differs from the brute force output\n");
+        return 1;
+    }
+
     convert_and_save_image(output, argv[6]);
 
     return 0;
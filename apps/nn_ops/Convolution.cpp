@@ -10,6 +10,10 @@
 
 #include "common_reference.h"
 #include "Convolution.h"
+#include "Convolution_direct.h"
+#include "Convolution_im2col_gemm.h"
+#include "Convolution_winograd_2.h"
+#include "Convolution_winograd_4.h"
 
 #include "HalideBuffer.h"
 
@@ -113,63 +117,88 @@ int main(int argc, char **argv) {
     halide_hexagon_power_hvx_on(nullptr);
 #endif
 
-    printf("Running pipeline...\n");
-    double time = Halide::Tools::benchmark([&]() {
-        int result = Convolution(input_tensor, filter_tensor, bias_tensor,
-                                 input_offset, filter_offset, input_depth,
-                                 stride, pad_width, pad_height, byte_zero,
-                                 output_multiplier, output_shift, output_offset,
-                                 output_min, output_max, output_tensor);
-        if (result != 0) {
-            printf("pipeline failed! %d\n", result);
+    // The automatically dispatched convolution, and each of the algorithms
+    // it chooses from.
+    struct {
+        const char *name;
+        decltype(&Convolution) fn;
+        bool applies;
+    } variants[] = {
+        { "auto", Convolution, true },
+        { "direct", Convolution_direct, true },
+        { "im2col_gemm", Convolution_im2col_gemm, true },
+        { "winograd_2", Convolution_winograd_2,
+          filter_width == 3 && filter_height == 3 && stride == 1 },
+        { "winograd_4", Convolution_winograd_4,
+          filter_width == 3 && filter_height == 3 && stride == 1 },
+    };
+
+    for (const auto &variant : variants) {
+        if (!variant.applies) {
+            continue;
         }
-    });
 
-    printf("Done, time: %g s\n", time);
+        // Make sure we don't validate the output of the previous variant.
+        output_tensor.fill(0);
+
+        printf("Running pipeline (%s)...\n", variant.name);
+        double time = Halide::Tools::benchmark([&]() {
+            int result = variant.fn(input_tensor, filter_tensor, bias_tensor,
+                                    input_offset, filter_offset, input_depth,
+                                    stride, pad_width, pad_height, byte_zero,
+                                    output_multiplier, output_shift, output_offset,
+                                    output_min, output_max, output_tensor);
+            if (result != 0) {
+                printf("pipeline failed! %d\n", result);
+            }
+        });
 
-#ifdef HALIDE_RUNTIME_HEXAGON
-    // We're done with HVX, power it off, and reset the performance mode
-    // to default to save power.
-    halide_hexagon_power_hvx_off(nullptr);
-    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
-#endif
+        printf("Done, time (%s): %g s\n", variant.name, time);
 
-    // Copy the output back to the host. If the buffer is zero-copy (as
-    // it should be on a real device), this will be a no-op.
-    output_tensor.copy_to_host();
+        // Copy the output back to the host. If the buffer is zero-copy (as
+        // it should be on a real device), this will be a no-op.
+        output_tensor.copy_to_host();
 
-    // Validate that the algorithm did what we expect.
-    output_tensor.for_each_element([&](int c, int x, int y, int b) {
-        int32_t output = bias_tensor(c);
+        // Validate that the algorithm did what we expect.
+        output_tensor.for_each_element([&](int c, int x, int y, int b) {
+            int32_t output = bias_tensor(c);
 
-        for (int filter_y = 0; filter_y < filter_height; filter_y++) {
-            for (int filter_x = 0; filter_x < filter_width; filter_x++) {
-                for (int index_c = 0; index_c < input_depth; index_c++) {
-                    int32_t input_value = static_cast<int32_t>(byte_zero);
+            for (int filter_y = 0; filter_y < filter_height; filter_y++) {
+                for (int filter_x = 0; filter_x < filter_width; filter_x++) {
+                    for (int index_c = 0; index_c < input_depth; index_c++) {
+                        int32_t input_value = static_cast<int32_t>(byte_zero);
 
-                    int x_offset = x * stride + filter_x - pad_width;
-                    int y_offset = y * stride + filter_y - pad_height;
-                    if ((x_offset >= 0) && (x_offset < W) && (y_offset >= 0) && (y_offset < H)) {
-                        input_value = static_cast<int32_t>(
-                            (int16_t) input_tensor(index_c, x_offset, y_offset, b) + input_offset);
-                    }
-                    int32_t filter_value = static_cast<int32_t>(
-                        (int16_t) filter_tensor(index_c, filter_x, filter_y, c) + filter_offset);
+                        int x_offset = x * stride + filter_x - pad_width;
+                        int y_offset = y * stride + filter_y - pad_height;
+                        if ((x_offset >= 0) && (x_offset < W) && (y_offset >= 0) && (y_offset < H)) {
+                            input_value = static_cast<int32_t>(
+                                (int16_t) input_tensor(index_c, x_offset, y_offset, b) + input_offset);
+                        }
+                        int32_t filter_value = static_cast<int32_t>(
+                            (int16_t) filter_tensor(index_c, filter_x, filter_y, c) + filter_offset);
 
-                    output += input_value * filter_value;
+                        output += input_value * filter_value;
+                    }
                 }
             }
-        }
 
-        output = multiply_quantized_multiplier_reference(output, output_multiplier, output_shift);
-        output += output_offset;
-        output = std::max(output, (int32_t) output_min);
-        output = std::min(output, (int32_t) output_max);
-        if (output != output_tensor(c, x, y, b)) {
-            printf("Mismatch at %d %d: %d != %d\n", x, y, output, output_tensor(c, x, y, b));
-            abort();
-        }
-    });
+            output = multiply_quantized_multiplier_reference(output, output_multiplier, output_shift);
+            output += output_offset;
+            output = std::max(output, (int32_t) output_min);
+            output = std::min(output, (int32_t) output_max);
+            if (output != output_tensor(c, x, y, b)) {
+                printf("Mismatch (%s) at %d %d: %d != %d\n", variant.name, x, y, output, output_tensor(c, x, y, b));
+                abort();
+            }
+        });
+    }
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // We're done with HVX, power it off, and reset the performance mode
+    // to default to save power.
+    halide_hexagon_power_hvx_off(nullptr);
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
+#endif
 
     printf("Success!\n");
     return 0;
@@ -10,3 +10,6 @@ $CONVOLUTION 8 17 17 1 3 3 8 -128 -128 8 2 1 1 0
 $CONVOLUTION 8 17 17 1 3 3 16 -128 -128 8 1 1 1 0
 $CONVOLUTION 8 17 17 1 3 3 16 -128 -140 8 1 1 1 0
 $CONVOLUTION 12 17 17 1 3 3 16 -128 -140 12 1 1 1 0
+# 3x3 stride 1 layers, which use the Winograd algorithm.
+$CONVOLUTION 32 56 56 1 3 3 32 -128 -128 32 1 1 1 0
+$CONVOLUTION 64 28 28 1 3 3 128 -128 -128 64 1 1 1 0
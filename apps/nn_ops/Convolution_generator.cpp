@@ -16,10 +16,26 @@
 // Output dimension: {filter_batches, ceil((input_width + 2 * pad_width -
 // filter_width) / stride) + 1, ceil((input_height + 2 * pad_height -
 // filter_height) / stride) + 1, input_batches}
+//
+// Step (3) can be computed with one of several algorithms, selected by the
+// algorithm generator param:
+// * direct: a reduction over the filter for each output.
+// * im2col_gemm: the windows of the input for a row of the output are copied
+//   into a contiguous (im2col) buffer, and multiplied by the filter with a
+//   register-blocked matrix multiply.
+// * winograd: Winograd's minimal filtering algorithm F(m x m, 3 x 3), with
+//   m given by winograd_tile. This only applies to 3x3 filters with stride 1.
+// * auto: pick one of the above at runtime based on the shape of the layer.
+// All of them compute exactly the same result.
 
 #include "common.h"
 #include <Halide.h>
 
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
 using Halide::Generator;
 using Halide::Var;
 using Halide::BoundaryConditions::constant_exterior;
@@ -27,8 +43,86 @@ using Halide::ConciseCasts::i16;
 using Halide::ConciseCasts::u16_sat;
 using Halide::ConciseCasts::u8_sat;
 
+enum class ConvolutionAlgorithm { Auto, Direct, Im2colGemm, Winograd };
+
+namespace {
+
+std::map<std::string, ConvolutionAlgorithm> convolution_algorithm_enum_map() {
+    return { { "auto", ConvolutionAlgorithm::Auto },
+             { "direct", ConvolutionAlgorithm::Direct },
+             { "im2col_gemm", ConvolutionAlgorithm::Im2colGemm },
+             { "winograd", ConvolutionAlgorithm::Winograd } };
+}
+
+// The matrices of the Winograd transforms F(m x m, 3 x 3) from "Fast
+// Algorithms for Convolutional Neural Networks" (Lavin and Gray), with G
+// scaled by filter_scale so that all of the entries are integers. This makes
+// the result filter_scale^2 times larger, which we divide out at the end.
+struct WinogradTransform {
+    int filter_scale;
+    std::vector<std::vector<int>> BT, G, AT;
+};
+
+const WinogradTransform &winograd_transform(int m) {
+    static const WinogradTransform f2 = {
+        2,
+        { { 1, 0, -1, 0 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { 0, 1, 0, -1 } },
+        { { 2, 0, 0 }, { 1, 1, 1 }, { 1, -1, 1 }, { 0, 0, 2 } },
+        { { 1, 1, 1, 0 }, { 0, 1, -1, -1 } },
+    };
+    static const WinogradTransform f4 = {
+        24,
+        { { 4, 0, -5, 0, 1, 0 },
+          { 0, -4, -4, 1, 1, 0 },
+          { 0, 4, -4, -1, 1, 0 },
+          { 0, -2, -1, 2, 1, 0 },
+          { 0, 2, -1, -2, 1, 0 },
+          { 0, 4, 0, -5, 0, 1 } },
+        { { 6, 0, 0 }, { -4, -4, -4 }, { -4, 4, -4 }, { 1, 2, 4 }, { 1, -2, 4 }, { 0, 0, 24 } },
+        { { 1, 1, 1, 1, 1, 0 }, { 0, 1, -1, 2, -2, 0 }, { 0, 1, 1, 4, 4, 0 }, { 0, 1, -1, 8, -8, 1 } },
+    };
+    return m == 4 ? f4 : f2;
+}
+
+// Compute row 'row' of the product of the constant matrix m and the vector
+// v. 'row' should be a Var that is unrolled (or bounded to a single value),
+// so the selects and the multiplications by 0 and 1 simplify away.
+Halide::Expr matrix_times_vector(const std::vector<std::vector<int>> &m, Halide::Expr row,
+                                 std::function<Halide::Expr(int)> v) {
+    Halide::Expr result;
+    for (int i = (int)m.size() - 1; i >= 0; i--) {
+        Halide::Expr sum;
+        for (size_t j = 0; j < m[i].size(); j++) {
+            if (m[i][j] == 0) continue;
+            Halide::Expr term = v(j);
+            if (m[i][j] != 1 && m[i][j] != -1) {
+                term = term * Halide::cast(term.type(), std::abs(m[i][j]));
+            }
+            if (!sum.defined()) {
+                sum = m[i][j] > 0 ? term : -term;
+            } else {
+                sum = m[i][j] > 0 ? sum + term : sum - term;
+            }
+        }
+        result = result.defined() ? Halide::select(row == i, sum, result) : sum;
+    }
+    return result;
+}
+
+}  // namespace
+
 class Convolution : public Generator<Convolution> {
 public:
+    // The algorithm used to compute the convolution.
+    GeneratorParam<ConvolutionAlgorithm> algorithm_{
+        "algorithm", ConvolutionAlgorithm::Auto, convolution_algorithm_enum_map() };
+
+    // The size of the output tiles computed by the Winograd algorithm, 2 or
+    // 4. F(2x2, 3x3) does 2.25x fewer multiplies than the direct algorithm in
+    // 32-bit integers. F(4x4, 3x3) does 4x fewer, but needs doubles to
+    // compute the result exactly.
+    GeneratorParam<int> winograd_tile_{ "winograd_tile", 2 };
+
     // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
     // input_batch.
     Input<Buffer<uint8_t>> input_{"input", 4};
@@ -73,9 +167,6 @@ public:
     void generate() {
         // The algorithm.
 
-        // Some free variables, where x and y represent the spatial dimensions.
-        Var x("x"), y("y"), depth("depth"), batch("batch");
-
         // For the input, add the offset and upcast to 16-bit.
         Func input_with_offset("input_with_offset");
         input_with_offset(depth, x, y, batch) =
@@ -99,29 +190,78 @@ public:
         shifted_input_with_offset(depth, x, y, batch) = input_with_offset_bounded(
             depth, x - pad_width_, y - pad_height_, batch);
 
-        // Do the convolution in 32-bit.
-        Func convolved("convolved");
+        // Do the convolution in 32-bit, with each of the algorithms we might
+        // use. Each of these is only computed if it is used below.
+        Func convolved_direct("convolved_direct");
         RDom filter_dom(0, input_depth_, 0, filter_.dim(1).extent(), 0,
                         filter_.dim(2).extent());
-        convolved(depth, x, y, batch) +=
+        convolved_direct(depth, x, y, batch) +=
             cast<int32_t>(filter_with_offset(filter_dom[0], filter_dom[1],
                                              filter_dom[2], depth)) *
             cast<int32_t>(shifted_input_with_offset(
                 filter_dom[0], x * stride_ + filter_dom[1],
                 y * stride_ + filter_dom[2], batch));
 
-        Func scaled_plus_offset("scaled_plus_offset");
-        scaled_plus_offset(depth, x, y, batch) =
-            multiply_quantized_multiplier(
-                convolved(depth, x, y, batch) + bias_(depth), output_multiplier_,
-                output_shift_) +
-            output_offset_;
+        const int winograd_m = winograd_tile_;
+        _halide_user_assert(winograd_m == 2 || winograd_m == 4)
+            << "winograd_tile must be 2 or 4\n";
+
+        // The Winograd algorithm only works for 3x3 filters with stride 1.
+        // It computes the result exactly as long as the intermediate values
+        // don't overflow, which limits the depth of the input: For F(2x2,
+        // 3x3), the transformed input and filter values are at most 4 * 255
+        // and 9 * 255, and their products are summed over the input depth in
+        // int32. For F(4x4, 3x3), all of the values are integers less than
+        // 2^53 in doubles for depths up to about 6000.
+        const int max_winograd_depth = winograd_m == 2 ? (1u << 31) / (4 * 255 * 9 * 255) : 4096;
+        // It also computes the output in m x m tiles, so the output must
+        // start at a multiple of m.
+        Expr use_winograd =
+            filter_.dim(1).extent() == 3 && filter_.dim(2).extent() == 3 &&
+            stride_ == 1 && input_depth_ <= max_winograd_depth &&
+            output_.dim(1).min() % winograd_m == 0 && output_.dim(2).min() % winograd_m == 0;
+        // 1x1 convolutions are already a matrix multiply without im2col.
+        Expr use_im2col_gemm =
+            filter_.dim(1).extent() * filter_.dim(2).extent() > 1;
 
-        // Saturate and narrow the output.
-        output_(depth, x, y, batch) =
-            min(output_max_,
-                max(output_min_,
-                    u8_sat(u16_sat(scaled_plus_offset(depth, x, y, batch)))));
+        const bool allow_winograd = algorithm_ == ConvolutionAlgorithm::Auto ||
+                                    algorithm_ == ConvolutionAlgorithm::Winograd;
+        const bool allow_im2col_gemm = algorithm_ == ConvolutionAlgorithm::Auto ||
+                                       algorithm_ == ConvolutionAlgorithm::Im2colGemm;
+
+        // Scale, offset, saturate, and narrow the result of a convolution.
+        auto quantize = [&](Expr convolved) {
+            Expr scaled_plus_offset =
+                multiply_quantized_multiplier(convolved + bias_(depth), output_multiplier_,
+                                              output_shift_) +
+                output_offset_;
+            return min(output_max_, max(output_min_, u8_sat(u16_sat(scaled_plus_offset))));
+        };
+
+        // The choice of algorithm must be made in the definition of the
+        // output itself, so that each of the specializations below sees
+        // only its own algorithm.
+        switch ((ConvolutionAlgorithm)algorithm_) {
+        case ConvolutionAlgorithm::Auto:
+            output_(depth, x, y, batch) =
+                select(use_winograd,
+                       quantize(convolve_winograd(shifted_input_with_offset, filter_with_offset, winograd_m)(depth, x, y, batch)),
+                       use_im2col_gemm,
+                       quantize(convolve_im2col_gemm(shifted_input_with_offset, filter_with_offset)(depth, x, y, batch)),
+                       quantize(convolved_direct(depth, x, y, batch)));
+            break;
+        case ConvolutionAlgorithm::Direct:
+            output_(depth, x, y, batch) = quantize(convolved_direct(depth, x, y, batch));
+            break;
+        case ConvolutionAlgorithm::Im2colGemm:
+            output_(depth, x, y, batch) =
+                quantize(convolve_im2col_gemm(shifted_input_with_offset, filter_with_offset)(depth, x, y, batch));
+            break;
+        case ConvolutionAlgorithm::Winograd:
+            output_(depth, x, y, batch) =
+                quantize(convolve_winograd(shifted_input_with_offset, filter_with_offset, winograd_m)(depth, x, y, batch));
+            break;
+        }
 
         const bool use_hexagon =
             get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
@@ -141,15 +281,189 @@ public:
         } else if (get_target().has_feature(Target::HVX_128)) {
             vector_size_u8 = 128;
         }
-        // We only perform vectorization when the depth >= vector size.
-        Expr can_vectorize_across_depth =
-            filter_.dim(3).extent() >= vector_size_u8;
+        int vector_size_i32 = vector_size_u8 / 4;
 
-        output_.parallel(y)
-            .specialize(can_vectorize_across_depth)
-            .vectorize(depth, vector_size_u8);
+        // Each algorithm is a separate specialization of the output, and
+        // the Funcs computing it are computed within that specialization,
+        // so only the algorithm in use runs.
+        if (allow_winograd) {
+            if (algorithm_ == ConvolutionAlgorithm::Winograd) {
+                // Align the output tiles, so that only the filter shape
+                // and stride can fail the specialization below.
+                output_.dim(1).set_min(0).dim(2).set_min(0);
+            }
+
+            Var xo("xo_winograd"), yo("yo_winograd"), xi("xi_winograd"), yi("yi_winograd");
+            output_.specialize(use_winograd)
+                .tile(x, y, xo, yo, xi, yi, winograd_m, winograd_m, TailStrategy::GuardWithIf)
+                .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf)
+                .parallel(yo);
+            schedule_winograd(xo, yo, winograd_m, vector_size_i32);
+            if (algorithm_ == ConvolutionAlgorithm::Winograd) {
+                output_.specialize_fail("The Winograd algorithm requires a 3x3 filter with "
+                                        "stride 1, and an input depth it can compute exactly.");
+            }
+        }
+        if (allow_im2col_gemm) {
+            Var xo("xo_gemm"), xi("xi_gemm");
+            Halide::Stage gemm_stage = algorithm_ == ConvolutionAlgorithm::Auto ?
+                output_.specialize(use_im2col_gemm) : Halide::Stage(output_);
+            gemm_stage
+                .split(x, xo, xi, kGemmTileWidth, TailStrategy::GuardWithIf)
+                .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf)
+                .parallel(y);
+            schedule_im2col_gemm(xo, vector_size_i32);
+        }
+
+        if (algorithm_ == ConvolutionAlgorithm::Auto ||
+            algorithm_ == ConvolutionAlgorithm::Direct) {
+            // We only perform vectorization when the depth >= vector size.
+            Expr can_vectorize_across_depth =
+                filter_.dim(3).extent() >= vector_size_u8;
+
+            output_.parallel(y)
+                .specialize(can_vectorize_across_depth)
+                .vectorize(depth, vector_size_u8);
+        }
         shifted_input_with_offset.compute_at(output_, batch);
     }
+
+private:
+    // The number of output pixels computed together by the im2col + gemm
+    // algorithm.
+    static constexpr int kGemmTileWidth = 4;
+
+    // Some free variables, where x and y represent the spatial dimensions.
+    Var x{"x"}, y{"y"}, depth{"depth"}, batch{"batch"};
+    Var k{"k"}, c{"c"}, fx{"fx"}, fy{"fy"}, u{"u"}, v{"v"}, i{"i"}, j{"j"}, tx{"tx"}, ty{"ty"};
+
+    Func im2col{"im2col"}, filter_packed{"filter_packed"}, gemm{"gemm"};
+    RDom gemm_r;
+
+    Func winograd_filter{"winograd_filter"}, winograd_input{"winograd_input"};
+    Func winograd_product{"winograd_product"}, winograd_output{"winograd_output"};
+    RDom winograd_r;
+
+    // Compute the convolution of input by filter by copying the windows of
+    // the input into an im2col buffer, and multiplying that with the filter.
+    Func convolve_im2col_gemm(Func input, Func filter) {
+        // The im2col buffer, indexed by the position in the window (c, fx,
+        // fy) and the output position (x, y, batch). This is computed a row of
+        // the output at a time, with the window innermost, so the reduction
+        // below reads contiguous memory.
+        im2col(c, fx, fy, x, y, batch) = input(c, x * stride_ + fx, y * stride_ + fy, batch);
+
+        // The filter, packed with the output depth innermost.
+        filter_packed(k, c, fx, fy) = filter(c, fx, fy, k);
+
+        gemm_r = RDom(0, input_depth_, 0, filter_.dim(1).extent(), 0, filter_.dim(2).extent(), "gemm_r");
+        gemm(k, x, y, batch) = 0;
+        gemm(k, x, y, batch) +=
+            cast<int32_t>(filter_packed(k, gemm_r[0], gemm_r[1], gemm_r[2])) *
+            cast<int32_t>(im2col(gemm_r[0], gemm_r[1], gemm_r[2], x, y, batch));
+        return gemm;
+    }
+
+    void schedule_im2col_gemm(Var xo, int vector_size) {
+        // Each tile computes a vector of the output depth for
+        // kGemmTileWidth pixels, accumulating in registers over the entire
+        // reduction.
+        Var ko("ko"), ki("ki");
+        gemm.compute_at(output_, xo)
+            .vectorize(k, vector_size, TailStrategy::GuardWithIf);
+        gemm.update()
+            .split(k, ko, ki, vector_size, TailStrategy::GuardWithIf)
+            .reorder(ki, x, gemm_r[0], gemm_r[1], gemm_r[2], ko, y, batch)
+            .vectorize(ki);
+
+        im2col.compute_at(output_, y)
+            .vectorize(c, vector_size * 2, TailStrategy::GuardWithIf);
+
+        filter_packed.compute_at(output_, Var::outermost())
+            .vectorize(k, vector_size * 2, TailStrategy::GuardWithIf);
+    }
+
+    // Compute the convolution of input by a 3x3 filter with stride 1 using
+    // Winograd's F(m x m, 3 x 3).
+    Func convolve_winograd(Func input, Func filter, int m) {
+        const WinogradTransform &t = winograd_transform(m);
+        Type type = m == 2 ? Int(32) : Float(64);
+
+        // Transform the filter: G * g * G^T.
+        winograd_filter(k, c, u, v) = matrix_times_vector(t.G, v, [&](int dy) {
+            return matrix_times_vector(t.G, u, [&](int dx) {
+                return cast(type, filter(c, dx, dy, k));
+            });
+        });
+
+        // Transform the (m + 2) x (m + 2) tiles of the input, which overlap
+        // by 2: B^T * d * B.
+        winograd_input(c, u, v, tx, ty, batch) = matrix_times_vector(t.BT, v, [&](int dy) {
+            return matrix_times_vector(t.BT, u, [&](int dx) {
+                return cast(type, input(c, tx * m + dx, ty * m + dy, batch));
+            });
+        });
+
+        // The elementwise product, summed over the input depth.
+        winograd_r = RDom(0, input_depth_, "winograd_r");
+        winograd_product(k, u, v, tx, ty, batch) = cast(type, 0);
+        winograd_product(k, u, v, tx, ty, batch) +=
+            winograd_filter(k, winograd_r, u, v) * winograd_input(winograd_r, u, v, tx, ty, batch);
+
+        // Transform the products back to m x m tiles of the output: A^T * M * A.
+        // For F(2x2, 3x3), the values before undoing the scaling of the
+        // filter may not fit in 32 bits, so do this in 64 bits.
+        Type output_type = m == 2 ? Int(64) : Float(64);
+        winograd_output(k, i, j, tx, ty, batch) = matrix_times_vector(t.AT, j, [&](int dv) {
+            return matrix_times_vector(t.AT, i, [&](int du) {
+                return cast(output_type, winograd_product(k, du, dv, tx, ty, batch));
+            });
+        });
+
+        const int scale = t.filter_scale * t.filter_scale;
+        Func convolved("convolved_winograd");
+        convolved(k, x, y, batch) =
+            cast<int32_t>(winograd_output(k, x % m, y % m, x / m, y / m, batch) / scale);
+        return convolved;
+    }
+
+    void schedule_winograd(Var xo, Var yo, int m, int vector_size) {
+        const int a = m + 2;
+
+        winograd_output.compute_at(output_, xo)
+            .bound(i, 0, m)
+            .bound(j, 0, m)
+            .vectorize(k, vector_size, TailStrategy::GuardWithIf)
+            .unroll(i)
+            .unroll(j);
+
+        Var ko("ko"), ki("ki");
+        winograd_product.compute_at(output_, xo)
+            .bound(u, 0, a)
+            .bound(v, 0, a)
+            .vectorize(k, vector_size, TailStrategy::GuardWithIf);
+        winograd_product.update()
+            .split(k, ko, ki, vector_size, TailStrategy::GuardWithIf)
+            .reorder(ki, winograd_r, ko, u, v, tx, ty, batch)
+            .vectorize(ki)
+            .unroll(u)
+            .unroll(v);
+
+        // Transform a row of tiles of the input at a time.
+        winograd_input.compute_at(output_, yo)
+            .bound(u, 0, a)
+            .bound(v, 0, a)
+            .vectorize(c, vector_size, TailStrategy::GuardWithIf)
+            .unroll(u)
+            .unroll(v);
+
+        winograd_filter.compute_at(output_, Var::outermost())
+            .bound(u, 0, a)
+            .bound(v, 0, a)
+            .vectorize(k, vector_size, TailStrategy::GuardWithIf)
+            .unroll(u)
+            .unroll(v);
+    }
 };
 
 HALIDE_REGISTER_GENERATOR(Convolution, Convolution)
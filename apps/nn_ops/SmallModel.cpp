@@ -0,0 +1,212 @@
+#include <assert.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "halide_benchmark.h"
+
+#include "Convolution.h"
+#include "DepthwiseConvolution_1.h"
+#include "MaxPool.h"
+#include "SmallModel.h"
+#include "SmallModel_unfused.h"
+
+#include "HalideBuffer.h"
+
+using Halide::Runtime::Buffer;
+
+namespace {
+
+// Hexagon's device_malloc implementation will also set the host
+// pointer if it is null, giving a zero copy buffer.
+template<typename T>
+void allocate(Buffer<T> &buf) {
+#ifdef HALIDE_RUNTIME_HEXAGON
+    buf.device_malloc(halide_hexagon_device_interface());
+#else
+    buf.allocate();
+#endif
+}
+
+template<typename T>
+void randomize(Buffer<T> &buf) {
+    buf.for_each_value([](T &x) {
+        x = static_cast<T>(rand());
+    });
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 7) {
+        printf("Usage: %s C W H N conv_depth pointwise_depth\n", argv[0]);
+        return 0;
+    }
+
+    int C = atoi(argv[1]);
+    int W = atoi(argv[2]);
+    int H = atoi(argv[3]);
+    int N = atoi(argv[4]);
+    int conv_depth = atoi(argv[5]);
+    int pointwise_depth = atoi(argv[6]);
+
+    printf("Benchmarking %dx%dx%dx%d -> %d -> %d\n", C, W, H, N, conv_depth, pointwise_depth);
+
+    // The depthwise convolution requires its depth to be aligned. 128 is
+    // conservative to enable Hexagon with 128-byte vectors.
+    int c_alignment = 128;
+    conv_depth = (conv_depth + c_alignment - 1) & ~(c_alignment - 1);
+
+    // These parameters lead to reasonable values for testing in
+    // most cases (expected value of the input matrices is ~0,
+    // expected value of the product is ~0). The clamps of the first two
+    // layers are narrower than the range of a uint8, so they have an effect.
+    int16_t input_offset = -128;
+    int16_t filter_offset = -128;
+    int output_multiplier = 1 << 30;
+    int output_shift = 8;
+    int output_offset = 128;
+    uint8_t activation_min = 16;
+    uint8_t activation_max = 240;
+
+    // The layers pad their input by 1, so the convolution with stride 2 has
+    // output (W + 1) / 2 x (H + 1) / 2, and the pool halves that.
+    const int conv_width = (W + 1) / 2;
+    const int conv_height = (H + 1) / 2;
+    const int output_width = conv_width / 2;
+    const int output_height = conv_height / 2;
+
+    Buffer<uint8_t> input_tensor(nullptr, C, W, H, N);
+    Buffer<uint8_t> conv_filter(nullptr, C, 3, 3, conv_depth);
+    Buffer<int32_t> conv_bias(nullptr, conv_depth);
+    Buffer<uint8_t> depthwise_filter(nullptr, conv_depth, 3, 3);
+    Buffer<int32_t> depthwise_bias(nullptr, conv_depth);
+    Buffer<uint8_t> pointwise_filter(nullptr, conv_depth, 1, 1, pointwise_depth);
+    Buffer<int32_t> pointwise_bias(nullptr, pointwise_depth);
+
+    // The activations between the layers, for running each of them as a
+    // separate pipeline.
+    Buffer<uint8_t> conv_tensor(nullptr, conv_depth, conv_width, conv_height, N);
+    Buffer<uint8_t> depthwise_tensor(nullptr, conv_depth, conv_width, conv_height, N);
+    Buffer<uint8_t> pointwise_tensor(nullptr, pointwise_depth, conv_width, conv_height, N);
+
+    Buffer<uint8_t> output_tensor(nullptr, pointwise_depth, output_width, output_height, N);
+    Buffer<uint8_t> expected_tensor(nullptr, pointwise_depth, output_width, output_height, N);
+
+    allocate(input_tensor);
+    allocate(conv_filter);
+    allocate(conv_bias);
+    allocate(depthwise_filter);
+    allocate(depthwise_bias);
+    allocate(pointwise_filter);
+    allocate(pointwise_bias);
+    allocate(conv_tensor);
+    allocate(depthwise_tensor);
+    allocate(pointwise_tensor);
+    allocate(output_tensor);
+    allocate(expected_tensor);
+
+    randomize(input_tensor);
+    randomize(conv_filter);
+    randomize(conv_bias);
+    randomize(depthwise_filter);
+    randomize(depthwise_bias);
+    randomize(pointwise_filter);
+    randomize(pointwise_bias);
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // To avoid the cost of powering HVX on in each call of the
+    // pipeline, power it on once now. Also, set Hexagon performance to turbo.
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_turbo);
+    halide_hexagon_power_hvx_on(nullptr);
+#endif
+
+    // Run the layers as separate pipelines, with each activation going
+    // through memory. This is the result the fused pipelines should match.
+    printf("Running pipelines (separate)...\n");
+    double separate_time = Halide::Tools::benchmark([&]() {
+        int result = Convolution(input_tensor, conv_filter, conv_bias,
+                                 input_offset, filter_offset, C,
+                                 2, 1, 1, 0,
+                                 output_multiplier, output_shift, output_offset,
+                                 activation_min, activation_max, conv_tensor);
+        if (result == 0) {
+            result = DepthwiseConvolution_1(conv_tensor, depthwise_filter, depthwise_bias,
+                                            -output_offset, filter_offset,
+                                            output_multiplier, output_shift, output_offset,
+                                            1, 1, 1,
+                                            activation_min, activation_max, depthwise_tensor);
+        }
+        if (result == 0) {
+            result = Convolution(depthwise_tensor, pointwise_filter, pointwise_bias,
+                                 -output_offset, filter_offset, conv_depth,
+                                 1, 0, 0, 0,
+                                 output_multiplier, output_shift, output_offset,
+                                 0, 255, pointwise_tensor);
+        }
+        if (result == 0) {
+            result = MaxPool(pointwise_tensor, 2, 0, 0, 2, 2, 0, 255, expected_tensor);
+        }
+        if (result != 0) {
+            printf("pipeline failed! %d\n", result);
+        }
+    });
+    printf("Done, time (separate): %g s\n", separate_time);
+    expected_tensor.copy_to_host();
+
+    struct {
+        const char *name;
+        decltype(&SmallModel) fn;
+    } variants[] = {
+        { "unfused", SmallModel_unfused },
+        { "fused", SmallModel },
+    };
+
+    for (const auto &variant : variants) {
+        // Make sure we don't validate the output of the previous variant.
+        output_tensor.fill(0);
+
+        printf("Running pipeline (%s)...\n", variant.name);
+        double time = Halide::Tools::benchmark([&]() {
+            int result = variant.fn(input_tensor, input_offset,
+                                    conv_filter, conv_bias, filter_offset,
+                                    output_multiplier, output_shift, output_offset,
+                                    activation_min, activation_max,
+                                    depthwise_filter, depthwise_bias, filter_offset,
+                                    output_multiplier, output_shift, output_offset,
+                                    activation_min, activation_max,
+                                    pointwise_filter, pointwise_bias, filter_offset,
+                                    output_multiplier, output_shift, output_offset,
+                                    0, 255, output_tensor);
+            if (result != 0) {
+                printf("pipeline failed! %d\n", result);
+            }
+        });
+
+        printf("Done, time (%s): %g s\n", variant.name, time);
+
+        // Copy the output back to the host. If the buffer is zero-copy (as
+        // it should be on a real device), this will be a no-op.
+        output_tensor.copy_to_host();
+
+        // Validate that the pipeline computes exactly what the separate
+        // layers do.
+        output_tensor.for_each_element([&](int c, int x, int y, int b) {
+            if (output_tensor(c, x, y, b) != expected_tensor(c, x, y, b)) {
+                printf("Mismatch (%s) at %d %d %d %d: %d != %d\n", variant.name, c, x, y, b,
+                       output_tensor(c, x, y, b), expected_tensor(c, x, y, b));
+                abort();
+            }
+        });
+    }
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // We're done with HVX, power it off, and reset the performance mode
+    // to default to save power.
+    halide_hexagon_power_hvx_off(nullptr);
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,7 @@
+SMALL_MODEL=$1
+# Columns are: schedule C W H N conv_depth pointwise_depth
+
+$SMALL_MODEL 8 17 17 1 8 16
+$SMALL_MODEL 8 64 64 1 32 64
+# The first block of MobileNet v1 on a 224x224 image.
+$SMALL_MODEL 3 224 224 1 32 64
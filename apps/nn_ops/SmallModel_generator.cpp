@@ -0,0 +1,210 @@
+// This generator implements a small quantized network, the first block of
+// MobileNet v1 followed by a pooling layer, as a single pipeline:
+//
+// (1) a 3x3 convolution with stride 2
+// (2) a 3x3 depthwise convolution
+// (3) a 1x1 (pointwise) convolution
+// (4) a 2x2 max pool with stride 2
+//
+// Each convolution adds a bias, requantizes the result with its own output
+// multiplier, shift and offset, and clamps it to [output_min, output_max]
+// (e.g. to apply a ReLU6 activation), as in the standalone Convolution and
+// DepthwiseConvolution generators. The input offset of each layer is the
+// negated output offset of the layer before it.
+//
+// All of the convolutions pad their input by 1 in x and y, so the output of
+// (1), (2) and (3) is half the width and height of the input (rounded up),
+// and the output of the network is a quarter of it (rounded down):
+// Input dimension: {input_depth, width, height, batches}
+// Output dimension: {pointwise_depth, ((width + 1) / 2) / 2,
+//                    ((height + 1) / 2) / 2, batches}
+//
+// The layers are defined with the functions in layers.h, and computed one
+// strip of rows at a time, so the intermediate activations of a strip stay
+// in cache rather than going through memory between layers. The depths of
+// the layers should be multiples of the vector size.
+
+#include "common.h"
+#include "layers.h"
+#include <Halide.h>
+
+#include <vector>
+
+using Halide::Expr;
+using Halide::Func;
+using Halide::Generator;
+using Halide::TailStrategy;
+using Halide::Var;
+
+class SmallModel : public Generator<SmallModel> {
+public:
+    // If false, each layer is computed in full before the next one starts,
+    // as it would be if the layers were separate pipelines. This is only
+    // useful to measure the benefit of fusing them.
+    GeneratorParam<bool> fuse_{ "fuse", true };
+
+    // Unsigned 8-bit input tensor, indexed by depth, x, y, batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+    Input<int16_t> input_offset_{ "input_offset", 0, -255, 0 };
+
+    // The 3x3 convolution. The filter is indexed by input depth, x, y,
+    // output depth, and the bias by output depth.
+    Input<Buffer<uint8_t>> conv_filter_{"conv_filter", 4};
+    Input<Buffer<int32_t>> conv_bias_{"conv_bias", 1};
+    Input<int16_t> conv_filter_offset_{ "conv_filter_offset", 0, -255, 0 };
+    Input<int> conv_output_multiplier_{ "conv_output_multiplier" };
+    Input<int> conv_output_shift_{ "conv_output_shift" };
+    Input<int> conv_output_offset_{ "conv_output_offset", 0, 0, 255 };
+    Input<uint8_t> conv_output_min_{ "conv_output_min" };
+    Input<uint8_t> conv_output_max_{ "conv_output_max" };
+
+    // The 3x3 depthwise convolution. The filter is indexed by depth, x, y,
+    // and the bias by depth.
+    Input<Buffer<uint8_t>> depthwise_filter_{"depthwise_filter", 3};
+    Input<Buffer<int32_t>> depthwise_bias_{"depthwise_bias", 1};
+    Input<int16_t> depthwise_filter_offset_{ "depthwise_filter_offset", 0, -255, 0 };
+    Input<int> depthwise_output_multiplier_{ "depthwise_output_multiplier" };
+    Input<int> depthwise_output_shift_{ "depthwise_output_shift" };
+    Input<int> depthwise_output_offset_{ "depthwise_output_offset", 0, 0, 255 };
+    Input<uint8_t> depthwise_output_min_{ "depthwise_output_min" };
+    Input<uint8_t> depthwise_output_max_{ "depthwise_output_max" };
+
+    // The 1x1 convolution. The filter is indexed by input depth, x, y,
+    // output depth, and the bias by output depth.
+    Input<Buffer<uint8_t>> pointwise_filter_{"pointwise_filter", 4};
+    Input<Buffer<int32_t>> pointwise_bias_{"pointwise_bias", 1};
+    Input<int16_t> pointwise_filter_offset_{ "pointwise_filter_offset", 0, -255, 0 };
+    Input<int> pointwise_output_multiplier_{ "pointwise_output_multiplier" };
+    Input<int> pointwise_output_shift_{ "pointwise_output_shift" };
+    Input<int> pointwise_output_offset_{ "pointwise_output_offset", 0, 0, 255 };
+    Input<uint8_t> pointwise_output_min_{ "pointwise_output_min" };
+    Input<uint8_t> pointwise_output_max_{ "pointwise_output_max" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // The width and height of the input and of the activations of the
+        // convolutions.
+        Expr width = input_.dim(1).extent();
+        Expr height = input_.dim(2).extent();
+        Expr conv_width = (width + 1) / 2;
+        Expr conv_height = (height + 1) / 2;
+
+        Func conv_input = pad_with_offset(input_, input_offset_, width, height,
+                                          1, 1, "conv_input");
+        conv_sums = convolve(conv_input, conv_filter_, conv_filter_offset_,
+                             conv_filter_.dim(0).extent(), 3, 3, 2, "conv_sums");
+        conv = requantize(conv_sums, conv_bias_, conv_output_multiplier_,
+                          conv_output_shift_, conv_output_offset_,
+                          conv_output_min_, conv_output_max_, "conv");
+
+        Func depthwise_input =
+            pad_with_offset(conv, -conv_output_offset_, conv_width, conv_height,
+                            1, 1, "depthwise_input");
+        depthwise_sums = depthwise_convolve(depthwise_input, depthwise_filter_,
+                                            depthwise_filter_offset_, 3, 3, 1,
+                                            "depthwise_sums");
+        depthwise = requantize(depthwise_sums, depthwise_bias_,
+                               depthwise_output_multiplier_,
+                               depthwise_output_shift_,
+                               depthwise_output_offset_, depthwise_output_min_,
+                               depthwise_output_max_, "depthwise");
+
+        Func pointwise_input =
+            pad_with_offset(depthwise, -depthwise_output_offset_, conv_width,
+                            conv_height, 0, 0, "pointwise_input");
+        pointwise_sums = convolve(pointwise_input, pointwise_filter_,
+                                  pointwise_filter_offset_,
+                                  pointwise_filter_.dim(0).extent(), 1, 1, 1,
+                                  "pointwise_sums");
+        pointwise = requantize(pointwise_sums, pointwise_bias_,
+                               pointwise_output_multiplier_,
+                               pointwise_output_shift_,
+                               pointwise_output_offset_, pointwise_output_min_,
+                               pointwise_output_max_, "pointwise");
+
+        Func pool = max_pool(pointwise, conv_width, conv_height, 2, 2, 2, 0, 0,
+                             Halide::UInt(8).min(), Halide::UInt(8).max(),
+                             "pool");
+        output_(depth, x, y, batch) = pool(depth, x, y, batch);
+
+        // The schedule.
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+        const int vector_size_i32 = vector_size_u8 / 4;
+
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        // Parallelize across strips of rows of the output.
+        Var yi("yi");
+        constexpr int kSplitFactor = 4;
+        output_.compute_root()
+            .split(y, y, yi, kSplitFactor, TailStrategy::GuardWithIf)
+            .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf)
+            .parallel(y);
+
+        if (fuse_) {
+            // Each row of the output needs two rows of the pointwise and
+            // depthwise convolutions, with no overlap between rows. The
+            // depthwise convolution needs a window of three rows of the
+            // first convolution, which is kept for the whole strip so that
+            // each row of it is only computed once per strip.
+            pointwise.compute_at(output_, yi);
+            depthwise.compute_at(output_, yi);
+            conv.store_at(output_, y).compute_at(output_, yi);
+        } else {
+            pointwise.compute_root().parallel(y);
+            depthwise.compute_root().parallel(y);
+            conv.compute_root().parallel(y);
+        }
+        for (Func layer : { pointwise, depthwise, conv }) {
+            layer.vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf);
+        }
+
+        schedule_sums(conv_sums, conv, vector_size_i32);
+        schedule_sums(depthwise_sums, depthwise, vector_size_i32);
+        schedule_sums(pointwise_sums, pointwise, vector_size_i32);
+    }
+
+private:
+    Var depth{"depth"}, x{"x"}, y{"y"}, batch{"batch"};
+
+    Func conv_sums, conv;
+    Func depthwise_sums, depthwise;
+    Func pointwise_sums, pointwise;
+
+    // The sums for each pixel of a layer are computed in registers,
+    // vectorized across the output depth, with the loops over the (constant
+    // size) filter unrolled.
+    void schedule_sums(Func sums, Func layer, int vector_size_i32) {
+        sums.compute_at(layer, x)
+            .vectorize(depth, vector_size_i32, TailStrategy::GuardWithIf);
+
+        // The last two reduction variables are the x and y of the filter.
+        std::vector<Halide::RVar> r = sums.rvars();
+        std::vector<Halide::VarOrRVar> order = { depth };
+        order.insert(order.end(), r.begin(), r.end());
+        sums.update()
+            .reorder(order)
+            .vectorize(depth, vector_size_i32, TailStrategy::GuardWithIf)
+            .unroll(r[r.size() - 2])
+            .unroll(r[r.size() - 1]);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(SmallModel, SmallModel)
@@ -0,0 +1,96 @@
+#include "layers.h"
+#include "common.h"
+
+using namespace Halide;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::u8_sat;
+
+namespace {
+
+Var depth("depth"), x("x"), y("y"), batch("batch");
+
+}  // namespace
+
+Func pad_with_offset(Func input, Expr offset, Expr width, Expr height,
+                     Expr pad_width, Expr pad_height, const std::string &name) {
+    Func with_offset(name + "_with_offset");
+    with_offset(depth, x, y, batch) = i16(input(depth, x, y, batch)) + offset;
+
+    Func bounded = constant_exterior(with_offset, i16(0),
+                                     { { Expr(), Expr() },
+                                       { 0, width },
+                                       { 0, height },
+                                       { Expr(), Expr() } });
+
+    Func padded(name + "_padded");
+    padded(depth, x, y, batch) =
+        bounded(depth, x - pad_width, y - pad_height, batch);
+    return padded;
+}
+
+Func convolve(Func padded_input, Func filter, Expr filter_offset,
+              Expr input_depth, Expr filter_width, Expr filter_height,
+              Expr stride, const std::string &name) {
+    Func filter_with_offset(name + "_filter_with_offset");
+    filter_with_offset(depth, x, y, batch) =
+        i16(filter(depth, x, y, batch)) + filter_offset;
+
+    Func sums(name);
+    RDom r(0, input_depth, 0, filter_width, 0, filter_height, name + "_r");
+    sums(depth, x, y, batch) +=
+        cast<int32_t>(filter_with_offset(r[0], r[1], r[2], depth)) *
+        cast<int32_t>(padded_input(r[0], x * stride + r[1],
+                                   y * stride + r[2], batch));
+    return sums;
+}
+
+Func depthwise_convolve(Func padded_input, Func filter, Expr filter_offset,
+                        Expr filter_width, Expr filter_height, Expr stride,
+                        const std::string &name) {
+    Func filter_with_offset(name + "_filter_with_offset");
+    filter_with_offset(depth, x, y) = i16(filter(depth, x, y)) + filter_offset;
+
+    Func sums(name);
+    RDom r(0, filter_width, 0, filter_height, name + "_r");
+    sums(depth, x, y, batch) +=
+        cast<int32_t>(filter_with_offset(depth, r.x, r.y)) *
+        cast<int32_t>(padded_input(depth, x * stride + r.x,
+                                   y * stride + r.y, batch));
+    return sums;
+}
+
+Func requantize(Func sums, Func bias, Expr output_multiplier, Expr output_shift,
+                Expr output_offset, Expr output_min, Expr output_max,
+                const std::string &name) {
+    Expr scaled_plus_offset =
+        multiply_quantized_multiplier(sums(depth, x, y, batch) + bias(depth),
+                                      output_multiplier, output_shift) +
+        output_offset;
+
+    Func output(name);
+    output(depth, x, y, batch) =
+        clamp(u8_sat(scaled_plus_offset), output_min, output_max);
+    return output;
+}
+
+Func max_pool(Func input, Expr width, Expr height, Expr filter_width,
+              Expr filter_height, Expr stride, Expr pad_width, Expr pad_height,
+              Expr output_min, Expr output_max, const std::string &name) {
+    // Pad with the minimum 32-bit integer, which never wins the maximum.
+    Func input_upcast(name + "_upcast");
+    input_upcast(depth, x, y, batch) = cast<int32_t>(input(depth, x, y, batch));
+    Func bounded = constant_exterior(input_upcast, Int(32).min(),
+                                     { { Expr(), Expr() },
+                                       { 0, width },
+                                       { 0, height },
+                                       { Expr(), Expr() } });
+
+    RDom r(0, filter_width, 0, filter_height, name + "_r");
+    Func output(name);
+    output(depth, x, y, batch) =
+        clamp(u8_sat(maximum(bounded(depth, x * stride + r.x - pad_width,
+                                     y * stride + r.y - pad_height, batch))),
+              output_min, output_max);
+    return output;
+}
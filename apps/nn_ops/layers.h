@@ -0,0 +1,62 @@
+// Building blocks for quantized networks, shared by the generators that
+// compose several operations into one pipeline.
+//
+// Each function takes the Funcs of its inputs and returns the Func of its
+// result, without scheduling anything, so that the caller can fuse the
+// layers of a network with compute_at. Tensors are indexed by depth, x, y,
+// batch, as in the rest of this app. Each layer computes exactly the same
+// result as the standalone generator for the same operation.
+
+#ifndef LAYERS_HALIDE_H_
+#define LAYERS_HALIDE_H_
+
+#include <string>
+
+#include <Halide.h>
+
+// Add offset to an 8-bit tensor, widening it to 16 bits, and pad it with
+// zeros outside of [0, width) x [0, height). The result is shifted by
+// [pad_width, pad_height], so that the window of a convolution starts at
+// [x * stride, y * stride].
+Halide::Func pad_with_offset(Halide::Func input, Halide::Expr offset,
+                             Halide::Expr width, Halide::Expr height,
+                             Halide::Expr pad_width, Halide::Expr pad_height,
+                             const std::string &name);
+
+// The 32-bit sums of a convolution of a padded input from pad_with_offset()
+// with an 8-bit filter indexed by depth, x, y, output_depth. The sum runs
+// over the first input_depth elements of the depth of the input.
+Halide::Func convolve(Halide::Func padded_input, Halide::Func filter,
+                      Halide::Expr filter_offset, Halide::Expr input_depth,
+                      Halide::Expr filter_width, Halide::Expr filter_height,
+                      Halide::Expr stride, const std::string &name);
+
+// The 32-bit sums of a depthwise convolution (with a depth multiplier of 1)
+// of a padded input from pad_with_offset() with an 8-bit filter indexed by
+// depth, x, y.
+Halide::Func depthwise_convolve(Halide::Func padded_input, Halide::Func filter,
+                                Halide::Expr filter_offset,
+                                Halide::Expr filter_width,
+                                Halide::Expr filter_height,
+                                Halide::Expr stride, const std::string &name);
+
+// Add a bias indexed by depth to the sums of a convolution, scale them by
+// the quantized multiplier and shift, add the output offset, and saturate
+// to 8 bits. The result is clamped to [output_min, output_max], which is
+// how activation functions such as ReLU6 are applied to quantized data.
+Halide::Func requantize(Halide::Func sums, Halide::Func bias,
+                        Halide::Expr output_multiplier, Halide::Expr output_shift,
+                        Halide::Expr output_offset, Halide::Expr output_min,
+                        Halide::Expr output_max, const std::string &name);
+
+// The maximum of each filter_width x filter_height window of an 8-bit
+// tensor with the given width and height, sampled with the given stride and
+// clamped to [output_min, output_max]. Windows that hang over the edge of
+// the tensor only include the part inside it.
+Halide::Func max_pool(Halide::Func input, Halide::Expr width, Halide::Expr height,
+                      Halide::Expr filter_width, Halide::Expr filter_height,
+                      Halide::Expr stride, Halide::Expr pad_width,
+                      Halide::Expr pad_height, Halide::Expr output_min,
+                      Halide::Expr output_max, const std::string &name);
+
+#endif
@@ -9,26 +9,32 @@
 #include "resize_cubic_float32_up.h"
 #include "resize_linear_float32_up.h"
 #include "resize_lanczos_float32_up.h"
+#include "resize_area_float32_up.h"
 #include "resize_box_float32_down.h"
 #include "resize_cubic_float32_down.h"
 #include "resize_linear_float32_down.h"
 #include "resize_lanczos_float32_down.h"
+#include "resize_area_float32_down.h"
 #include "resize_box_uint8_up.h"
 #include "resize_cubic_uint8_up.h"
 #include "resize_linear_uint8_up.h"
 #include "resize_lanczos_uint8_up.h"
+#include "resize_area_uint8_up.h"
 #include "resize_box_uint8_down.h"
 #include "resize_cubic_uint8_down.h"
 #include "resize_linear_uint8_down.h"
 #include "resize_lanczos_uint8_down.h"
+#include "resize_area_uint8_down.h"
 #include "resize_box_uint16_up.h"
 #include "resize_cubic_uint16_up.h"
 #include "resize_linear_uint16_up.h"
 #include "resize_lanczos_uint16_up.h"
+#include "resize_area_uint16_up.h"
 #include "resize_box_uint16_down.h"
 #include "resize_cubic_uint16_down.h"
 #include "resize_linear_uint16_down.h"
 #include "resize_lanczos_uint16_down.h"
+#include "resize_area_uint16_down.h"
 
 std::string infile, outfile, input_type, interpolation_type;
 float scale_factor = 1.0f;
@@ -40,7 +46,7 @@ void show_usage_and_exit() {
             "Usage:\n"
             "\t./resample [-f scalefactor] "
             "[-b benchmark_iterations] "
-            "[-i box|linear|cubic|lanczos] "
+            "[-i box|linear|cubic|lanczos|area] "
             "[-t float32|uint8|uint16] in.png out.png\n");
     exit(1);
 }
@@ -80,32 +86,38 @@ int main(int argc, char **argv) {
     int out_width = in.width() * scale_factor;
     int out_height = in.height() * scale_factor;
 
-    decltype(&resize_box_float32_up) variants[3][2][4] =
+    decltype(&resize_box_float32_up) variants[3][2][5] =
     {
         {{&resize_box_float32_up,
           &resize_cubic_float32_up,
           &resize_linear_float32_up,
-          &resize_lanczos_float32_up},
+          &resize_lanczos_float32_up,
+          &resize_area_float32_up},
          {&resize_box_float32_down,
           &resize_cubic_float32_down,
           &resize_linear_float32_down,
-          &resize_lanczos_float32_down}},
+          &resize_lanczos_float32_down,
+          &resize_area_float32_down}},
         {{&resize_box_uint8_up,
           &resize_cubic_uint8_up,
           &resize_linear_uint8_up,
-          &resize_lanczos_uint8_up},
+          &resize_lanczos_uint8_up,
+          &resize_area_uint8_up},
          {&resize_box_uint8_down,
           &resize_cubic_uint8_down,
           &resize_linear_uint8_down,
-          &resize_lanczos_uint8_down}},
+          &resize_lanczos_uint8_down,
+          &resize_area_uint8_down}},
         {{&resize_box_uint16_up,
           &resize_cubic_uint16_up,
           &resize_linear_uint16_up,
-          &resize_lanczos_uint16_up},
+          &resize_lanczos_uint16_up,
+          &resize_area_uint16_up},
          {&resize_box_uint16_down,
           &resize_cubic_uint16_down,
           &resize_linear_uint16_down,
-          &resize_lanczos_uint16_down}}
+          &resize_lanczos_uint16_down,
+          &resize_area_uint16_down}}
     };
 
     int interpolation_idx = 0;
@@ -117,6 +129,8 @@ int main(int argc, char **argv) {
         interpolation_idx = 2;
     } else if (interpolation_type == "lanczos") {
         interpolation_idx = 3;
+    } else if (interpolation_type == "area") {
+        interpolation_idx = 4;
     } else {
         fprintf(stderr, "Unknown interpolation type: %s\n", interpolation_type.c_str());
         show_usage_and_exit();
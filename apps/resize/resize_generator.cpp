@@ -3,7 +3,12 @@
 using namespace Halide;
 
 enum InterpolationType {
-    Box, Linear, Cubic, Lanczos
+    Box, Linear, Cubic, Lanczos, Area
+};
+
+// The order of the two passes of the separable resize.
+enum class PassOrder {
+    Auto, HorizontalFirst, VerticalFirst
 };
 
 Expr kernel_box(Expr x) {
@@ -39,6 +44,14 @@ Expr kernel_lanczos(Expr x) {
     return value;
 }
 
+// The area of an input pixel centered at x (in units of input pixels)
+// covered by an output pixel centered at zero that is 1 / scale input
+// pixels wide.
+Expr kernel_area(Expr x, Expr scale) {
+    Expr half_width = 0.5f / scale;
+    return max(min(x + 0.5f, half_width) - max(x - 0.5f, -half_width), 0.0f);
+}
+
 struct KernelInfo {
     const char *name;
     int taps;
@@ -49,7 +62,9 @@ static KernelInfo kernel_info[] = {
     { "box", 1, kernel_box },
     { "linear", 2, kernel_linear },
     { "cubic", 4, kernel_cubic },
-    { "lanczos", 6, kernel_lanczos }
+    { "lanczos", 6, kernel_lanczos },
+    // The area kernel depends on the scale, so it is handled separately.
+    { "area", 1, nullptr }
 };
 
 class Resize : public Halide::Generator<Resize> {
@@ -59,13 +74,32 @@ public:
          {{"box", Box},
           {"linear", Linear},
           {"cubic", Cubic},
-          {"lanczos", Lanczos}}};
+          {"lanczos", Lanczos},
+          {"area", Area}}};
 
     // If we statically know whether we're upsampling or downsampling,
     // we can generate different pipelines (we want to reorder the
     // resample in x and in y).
     GeneratorParam<bool> upsample{"upsample", false};
 
+    // Which of the two passes to do first. By default, the resize in
+    // x, which vectorizes poorly compared to the resize in y, is done
+    // on the smaller of the input and the output: first if we're
+    // upsampling, and second if we're downsampling.
+    GeneratorParam<PassOrder> pass_order
+        {"pass_order", PassOrder::Auto,
+         {{"auto", PassOrder::Auto},
+          {"horizontal_first", PassOrder::HorizontalFirst},
+          {"vertical_first", PassOrder::VerticalFirst}}};
+
+    // When downsampling by a large factor, the filter reads a large
+    // footprint of the input for each output. Instead, we can first
+    // reduce the input by 2x2 box filtering up to this many times, and
+    // resize the result with a scale factor that is at most 1/2. Each
+    // level of the pyramid is only used if the scale factor is small
+    // enough. Ignored when upsampling.
+    GeneratorParam<int> pyramid_levels{"pyramid_levels", 3};
+
     Input<Buffer<>> input{"input", 3};
     Input<float> scale_factor{"scale_factor"};
     Output<Buffer<>> output{"output", 3};
@@ -74,116 +108,217 @@ public:
     Var x, y, c, k;
 
     // Intermediate Funcs
-    Func as_float, clamped, resized_x, resized_y,
-        unnormalized_kernel_x, unnormalized_kernel_y,
-        kernel_x, kernel_y,
-        kernel_sum_x, kernel_sum_y;
-
-    void generate() {
-
-        clamped = BoundaryConditions::repeat_edge(input,
-                 {{input.dim(0).min(), input.dim(0).extent()},
-                  {input.dim(1).min(), input.dim(1).extent()}});
+    Func as_float, clamped;
+
+    // The Funcs that resize one level of the pyramid (level 0 is the
+    // input itself).
+    struct Level {
+        Func source,
+            unnormalized_kernel_x, unnormalized_kernel_y,
+            kernel_x, kernel_y,
+            kernel_sum_x, kernel_sum_y,
+            begin_x, begin_y,
+            resized_x, resized_y;
+        // Whether to use this level (or a smaller one).
+        Expr use;
+    };
+    std::vector<Level> levels;
+
+    bool horizontal_first() const {
+        return pass_order == PassOrder::Auto ?
+            (bool)upsample : pass_order == PassOrder::HorizontalFirst;
+    }
 
-        // Handle different types by just casting to float
-        as_float(x, y, c) = cast<float>(clamped(x, y, c));
+    // Define the resize of a source image by the given scale factor.
+    void define_resize(Level &l, Expr scale) {
+        const KernelInfo &info = kernel_info[interpolation_type];
 
         // For downscaling, widen the interpolation kernel to perform lowpass
         // filtering.
-
-        Expr kernel_scaling = upsample ? Expr(1.0f) : scale_factor;
-
-        Expr kernel_radius = 0.5f * kernel_info[interpolation_type].taps / kernel_scaling;
-
-        Expr kernel_taps = ceil(kernel_info[interpolation_type].taps / kernel_scaling);
+        Expr kernel_scaling = upsample ? Expr(1.0f) : scale;
+
+        Expr kernel_radius, kernel_taps;
+        if (interpolation_type == Area) {
+            // The output pixel covers 1 / scale input pixels, plus
+            // partially covered input pixels at each end.
+            kernel_radius = 0.5f / scale + 0.5f;
+            kernel_taps = ceil(1.0f / scale) + 1;
+        } else {
+            kernel_radius = 0.5f * info.taps / kernel_scaling;
+            kernel_taps = ceil(info.taps / kernel_scaling);
+        }
 
         // source[xy] are the (non-integer) coordinates inside the source image
-        Expr sourcex = (x + 0.5f) / scale_factor - 0.5f;
-        Expr sourcey = (y + 0.5f) / scale_factor - 0.5f;
+        Expr sourcex = (x + 0.5f) / scale - 0.5f;
+        Expr sourcey = (y + 0.5f) / scale - 0.5f;
 
         // Initialize interpolation kernels. Since we allow an arbitrary
         // scaling factor, the filter coefficients are different for each x
-        // and y coordinate.
-        Expr beginx = cast<int>(ceil(sourcex - kernel_radius));
-        Expr beginy = cast<int>(ceil(sourcey - kernel_radius));
+        // and y coordinate. They are computed once into tables of the
+        // first tap and the normalized weights for each output column and
+        // row, which the resize then reads.
+        l.begin_x(x) = cast<int>(ceil(sourcex - kernel_radius));
+        l.begin_y(y) = cast<int>(ceil(sourcey - kernel_radius));
 
         RDom r(0, kernel_taps);
-        const KernelInfo &info = kernel_info[interpolation_type];
 
-        unnormalized_kernel_x(x, k) = info.kernel((k + beginx - sourcex) * kernel_scaling);
-        unnormalized_kernel_y(y, k) = info.kernel((k + beginy - sourcey) * kernel_scaling);
+        if (interpolation_type == Area) {
+            l.unnormalized_kernel_x(x, k) = kernel_area(k + l.begin_x(x) - sourcex, scale);
+            l.unnormalized_kernel_y(y, k) = kernel_area(k + l.begin_y(y) - sourcey, scale);
+        } else {
+            l.unnormalized_kernel_x(x, k) = info.kernel((k + l.begin_x(x) - sourcex) * kernel_scaling);
+            l.unnormalized_kernel_y(y, k) = info.kernel((k + l.begin_y(y) - sourcey) * kernel_scaling);
+        }
 
-        kernel_sum_x(x) = sum(unnormalized_kernel_x(x, r), "kernel_sum_x");
-        kernel_sum_y(y) = sum(unnormalized_kernel_y(y, r), "kernel_sum_y");
+        l.kernel_sum_x(x) = sum(l.unnormalized_kernel_x(x, r), "kernel_sum_x");
+        l.kernel_sum_y(y) = sum(l.unnormalized_kernel_y(y, r), "kernel_sum_y");
 
-        kernel_x(x, k) = unnormalized_kernel_x(x, k) / kernel_sum_x(x);
-        kernel_y(y, k) = unnormalized_kernel_y(y, k) / kernel_sum_y(y);
+        l.kernel_x(x, k) = l.unnormalized_kernel_x(x, k) / l.kernel_sum_x(x);
+        l.kernel_y(y, k) = l.unnormalized_kernel_y(y, k) / l.kernel_sum_y(y);
 
-        // Perform separable resizing. The resize in x vectorizes
-        // poorly compared to the resize in y, so do it first if we're
-        // upsampling, and do it second if we're downsampling.
-        Func resized;
-        if (upsample) {
-            resized_x(x, y, c) = sum(kernel_x(x, r) * as_float(r + beginx, y, c), "resized_x");
-            resized_y(x, y, c) = sum(kernel_y(y, r) * resized_x(x, r + beginy, c), "resized_y");
-            resized = resized_y;
+        // Perform separable resizing.
+        if (horizontal_first()) {
+            l.resized_x(x, y, c) = sum(l.kernel_x(x, r) * l.source(r + l.begin_x(x), y, c), "resized_x");
+            l.resized_y(x, y, c) = sum(l.kernel_y(y, r) * l.resized_x(x, r + l.begin_y(y), c), "resized_y");
         } else {
-            resized_y(x, y, c) = sum(kernel_y(y, r) * as_float(x, r + beginy, c), "resized_y");
-            resized_x(x, y, c) = sum(kernel_x(x, r) * resized_y(r + beginx, y, c), "resized_x");
-            resized = resized_x;
+            l.resized_y(x, y, c) = sum(l.kernel_y(y, r) * l.source(x, r + l.begin_y(y), c), "resized_y");
+            l.resized_x(x, y, c) = sum(l.kernel_x(x, r) * l.resized_y(r + l.begin_x(x), y, c), "resized_x");
+        }
+    }
+
+    void generate() {
+        _halide_user_assert(pyramid_levels >= 0) << "pyramid_levels must not be negative\n";
+
+        clamped = BoundaryConditions::repeat_edge(input,
+                 {{input.dim(0).min(), input.dim(0).extent()},
+                  {input.dim(1).min(), input.dim(1).extent()}});
+
+        // Handle different types by just casting to float
+        as_float(x, y, c) = cast<float>(clamped(x, y, c));
+
+        const int num_levels = upsample ? 1 : pyramid_levels + 1;
+        levels.resize(num_levels);
+        for (int i = 0; i < num_levels; i++) {
+            Level &l = levels[i];
+            const std::string suffix = "_" + std::to_string(i);
+            l.source = i == 0 ? as_float : Func("level" + suffix);
+            l.unnormalized_kernel_x = Func("unnormalized_kernel_x" + suffix);
+            l.unnormalized_kernel_y = Func("unnormalized_kernel_y" + suffix);
+            l.kernel_x = Func("kernel_x" + suffix);
+            l.kernel_y = Func("kernel_y" + suffix);
+            l.kernel_sum_x = Func("kernel_sum_x" + suffix);
+            l.kernel_sum_y = Func("kernel_sum_y" + suffix);
+            l.begin_x = Func("begin_x" + suffix);
+            l.begin_y = Func("begin_y" + suffix);
+            l.resized_x = Func("resized_x" + suffix);
+            l.resized_y = Func("resized_y" + suffix);
+
+            if (i > 0) {
+                // Each level of the pyramid is the average of 2x2 blocks of
+                // the one before it. Outside of the input, the levels see
+                // its clamped edges.
+                Func prev = levels[i - 1].source;
+                l.source(x, y, c) = 0.25f * (prev(2 * x, 2 * y, c) + prev(2 * x + 1, 2 * y, c) +
+                                             prev(2 * x, 2 * y + 1, c) + prev(2 * x + 1, 2 * y + 1, c));
+            }
+
+            // Use the level if the remaining scale factor would still be
+            // at most 1/2, so it still gets filtered.
+            l.use = i == 0 ? Expr() : scale_factor <= 1.0f / (1 << (i + 1));
+            define_resize(l, scale_factor * (1 << i));
+        }
+
+        // Pick the largest level we can use. This is a select nested in
+        // the same way as the specializations of the output below, so
+        // each specialization only uses one of the levels.
+        Expr resized;
+        for (int i = num_levels - 1; i >= 0; i--) {
+            const Level &l = levels[i];
+            Expr r = horizontal_first() ? l.resized_y(x, y, c) : l.resized_x(x, y, c);
+            resized = resized.defined() ? select(levels[i + 1].use, resized, r) : r;
         }
 
         if (input.type().is_float()) {
-            output(x, y, c) = clamp(resized(x, y, c), 0.0f, 1.0f);
+            output(x, y, c) = clamp(resized, 0.0f, 1.0f);
         } else {
-            output(x, y, c) = saturating_cast(input.type(), resized(x, y, c));
+            output(x, y, c) = saturating_cast(input.type(), resized);
         }
     }
 
     void schedule() {
         Var xi, yi;
-        unnormalized_kernel_x
-            .compute_at(kernel_x, x)
-            .vectorize(x);
-        kernel_sum_x
-            .compute_at(kernel_x, x)
-            .vectorize(x);
-        kernel_x
-            .compute_root()
-            .reorder(k, x)
-            .vectorize(x, 8);
-
-        unnormalized_kernel_y
-            .compute_at(kernel_y, y)
-            .vectorize(y, 8);
-        kernel_sum_y
-            .compute_at(kernel_y, y)
-            .vectorize(y);
-        kernel_y
-            .compute_at(output, y)
-            .reorder(k, y).vectorize(y, 8);
-
-        if (upsample) {
+
+        if (horizontal_first()) {
             output
                 .tile(x, y, xi, yi, 16, 64)
                 .parallel(y)
                 .vectorize(xi);
-            resized_x
-                .compute_at(output, x)
-                .vectorize(x, 8);
-            as_float
-                .compute_at(output, y)
-                .vectorize(x, 8);
         } else {
             output
                 .tile(x, y, xi, yi, 32, 8)
                 .parallel(y)
                 .vectorize(xi);
-            resized_y
-                .compute_at(output, y)
+        }
+
+        for (size_t i = 0; i < levels.size(); i++) {
+            Level &l = levels[i];
+
+            // The tables are computed once per call, outside of the loop
+            // over the channels, and only for the level in use.
+            l.unnormalized_kernel_x
+                .compute_at(l.kernel_x, x)
+                .vectorize(x);
+            l.kernel_sum_x
+                .compute_at(l.kernel_x, x)
+                .vectorize(x);
+            l.kernel_x
+                .compute_at(output, Var::outermost())
+                .reorder(k, x)
                 .vectorize(x, 8);
-            resized_x
-                .compute_at(output, xi);
+            l.begin_x
+                .compute_at(output, Var::outermost())
+                .vectorize(x, 8);
+
+            l.unnormalized_kernel_y
+                .compute_at(l.kernel_y, y)
+                .vectorize(y, 8);
+            l.kernel_sum_y
+                .compute_at(l.kernel_y, y)
+                .vectorize(y);
+            l.kernel_y
+                .compute_at(output, Var::outermost())
+                .reorder(k, y).vectorize(y, 8);
+            l.begin_y
+                .compute_at(output, Var::outermost())
+                .vectorize(y, 8);
+
+            if (horizontal_first()) {
+                l.resized_x
+                    .compute_at(output, x)
+                    .vectorize(x, 8);
+                l.source
+                    .compute_at(output, y)
+                    .vectorize(x, 8);
+            } else {
+                l.resized_y
+                    .compute_at(output, y)
+                    .vectorize(x, 8);
+                l.resized_x
+                    .compute_at(output, xi);
+                if (i > 0) {
+                    l.source
+                        .compute_at(output, y)
+                        .vectorize(x, 8);
+                }
+            }
+        }
+
+        // Specialize the output for each level of the pyramid, nested in
+        // the same way as the select in the algorithm, so that the
+        // branch for each level only computes that level.
+        std::vector<Stage> level_stages = { output };
+        for (size_t i = 1; i < levels.size(); i++) {
+            level_stages.push_back(level_stages.back().specialize(levels[i].use));
         }
 
         // Allow the input and output to have arbitrary memory layout,
@@ -212,16 +347,17 @@ public:
                             input.dim(2).min() == 0 &&
                             input.dim(2).extent() == 4);
 
+        for (Stage s : level_stages) {
+            s.specialize(planar);
 
-        output.specialize(planar);
-
-        output.specialize(packed_rgb)
-            .reorder(c, xi, yi, x, y)
-            .unroll(c);
+            s.specialize(packed_rgb)
+                .reorder(c, xi, yi, x, y)
+                .unroll(c);
 
-        output.specialize(packed_rgba)
-            .reorder(c, xi, yi, x, y)
-            .unroll(c);
+            s.specialize(packed_rgba)
+                .reorder(c, xi, yi, x, y)
+                .unroll(c);
+        }
     }
 };
 
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""Run the apps through a common benchmark harness and check for regressions.
+
+Each benchmark below is a Generator from one of the apps, run via its RunGen
+binary at a fixed input size and at each of a fixed set of thread counts. The
+timings come from RunGen's --benchmark_stats mode, so every result has a median
+and a confidence interval for it. The results of a run are written to a single
+JSON file, which can be compared against a stored baseline:
+
+    benchmark_apps.py list
+        Print the RunGen targets that need to be built, as app/library.
+
+    benchmark_apps.py run --rungen=bin/apps/{app}/{lib}.rungen --output=results.json
+        Run every benchmark and write the results. {app}, {lib} and {name}
+        (the last component of {lib}) are replaced for each benchmark.
+
+    benchmark_apps.py compare baseline.json results.json [--threshold=5] [--threshold=blur=10]
+        Exit with a non-zero status if any benchmark got slower than its
+        threshold (a percentage of the baseline median) allows.
+
+'make benchmark_apps' (or the CMake target of the same name) does the
+building and runs 'run' followed by 'compare' if BENCHMARK_BASELINE is set.
+Only CPU targets are used, so this works on any Linux machine; results are
+only comparable between runs on the same machine, so the baseline is not
+checked in.
+"""
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+
+# (name, app, library, arguments to RunGen). Sizes are chosen to take tens of
+# milliseconds per call with one thread, so that the whole suite runs in a few
+# minutes.
+BENCHMARKS = [
+    ('bilateral_grid', 'bilateral_grid', 'bilateral_grid',
+     ['input=zero:[1536,2560]', 'r_sigma=0.1']),
+    ('blur', 'blur', 'host/halide_blur',
+     ['input=zero:[6408,4802]', '--output_extents=[6400,4800]']),
+    ('camera_pipe', 'camera_pipe', 'camera_pipe',
+     ['input=zero:[2592,1968]', 'matrix_3200=zero:[4,3]', 'matrix_7000=zero:[4,3]',
+      'color_temp=3700', 'gamma=2.0', 'contrast=50', 'sharpen_strength=1.0',
+      'blackLevel=25', 'whiteLevel=1023', '--output_extents=[2560,1920,3]']),
+    ('conv_layer', 'conv_layer', 'conv_layer',
+     ['input=zero:[67,67,32,4]', 'filter=zero:[3,3,32,32]', 'bias=zero:[32]',
+      '--output_extents=[64,64,32,4]']),
+    ('lens_blur', 'lens_blur', 'lens_blur',
+     ['left_im=zero:[1536,1024,3]', 'right_im=zero:[1536,1024,3]',
+      'slices=32', 'focus_depth=13', 'blur_radius_scale=0.5', 'aperture_samples=32']),
+    ('local_laplacian', 'local_laplacian', 'local_laplacian',
+     ['input=zero:[1536,2560,3]', 'levels=8', 'alpha=1', 'beta=1']),
+    ('nl_means', 'nl_means', 'nl_means',
+     ['input=zero:[1536,2560,3]', 'patch_size=7', 'search_area=7', 'sigma=0.12']),
+    ('stencil_chain', 'stencil_chain', 'stencil_chain',
+     ['input=zero:[1536,2560]']),
+]
+
+DEFAULT_THREADS = '1,4'
+
+
+def result_key(name, threads):
+    return '%s/threads:%d' % (name, threads)
+
+
+def cpu_governor():
+    try:
+        with open('/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor') as f:
+            return f.read().strip()
+    except IOError:
+        return ''
+
+
+def run_one(rungen, args, threads, min_time):
+    with tempfile.NamedTemporaryFile(suffix='.json') as tmp:
+        cmd = [rungen, '--benchmarks=all', '--benchmark_stats',
+               '--benchmark_min_time=%g' % min_time,
+               '--benchmark_json=' + tmp.name] + args
+        env = dict(os.environ, HL_NUM_THREADS=str(threads))
+        subprocess.check_call(cmd, env=env, stdout=sys.stderr)
+        with open(tmp.name) as f:
+            lines = [l for l in f.read().splitlines() if l.strip()]
+    return json.loads(lines[-1])
+
+
+def cmd_list(args):
+    for _, app, lib, _ in BENCHMARKS:
+        print('%s/%s' % (app, lib))
+    return 0
+
+
+def cmd_run(args):
+    threads = [int(t) for t in args.threads.split(',')]
+    results = {
+        'machine': {
+            'platform': platform.platform(),
+            'processor': platform.processor(),
+            'cpu_count': os.cpu_count(),
+            'cpu_governor': cpu_governor(),
+        },
+        'benchmarks': {},
+    }
+    for name, app, lib, rungen_args in BENCHMARKS:
+        if args.filter and args.filter not in name:
+            continue
+        rungen = args.rungen.format(app=app, lib=lib, name=os.path.basename(lib))
+        for t in threads:
+            key = result_key(name, t)
+            sys.stderr.write('Benchmarking %s...\n' % key)
+            stats = run_one(rungen, rungen_args, t, args.min_time)
+            stats['threads'] = t
+            results['benchmarks'][key] = stats
+    with open(args.output, 'w') as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write('\n')
+    print('Wrote %d results to %s' % (len(results['benchmarks']), args.output))
+    return 0
+
+
+def parse_thresholds(values):
+    default = 5.0
+    overrides = {}
+    for v in values or []:
+        if '=' in v:
+            name, pct = v.split('=', 1)
+            overrides[name] = float(pct)
+        else:
+            default = float(v)
+    return default, overrides
+
+
+def cmd_compare(args):
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    with open(args.results) as f:
+        results = json.load(f)
+    default, overrides = parse_thresholds(args.threshold)
+
+    if baseline.get('machine') != results.get('machine'):
+        print('Warning: the baseline was recorded on a different machine configuration:\n'
+              '  baseline: %s\n  results:  %s' % (baseline.get('machine'), results.get('machine')))
+
+    regressions = []
+    print('%-40s %12s %12s %9s %9s' % ('benchmark', 'baseline', 'current', 'change', 'limit'))
+    for key in sorted(results['benchmarks']):
+        cur = results['benchmarks'][key]
+        base = baseline['benchmarks'].get(key)
+        if base is None:
+            print('%-40s %12s %12.6f %9s' % (key, '-', cur['median'], 'new'))
+            continue
+        name = key.split('/')[0]
+        limit = overrides.get(key, overrides.get(name, default))
+        change = 100.0 * (cur['median'] / base['median'] - 1.0)
+        # Only count it if the slowdown is both larger than the threshold and
+        # larger than the noise in either measurement.
+        regressed = (change > limit and cur['median_ci_low'] > base['median_ci_high'])
+        print('%-40s %12.6f %12.6f %+8.1f%% %8.1f%%%s' %
+              (key, base['median'], cur['median'], change, limit,
+               '  REGRESSION' if regressed else ''))
+        if regressed:
+            regressions.append(key)
+    for key in sorted(set(baseline['benchmarks']) - set(results['benchmarks'])):
+        print('%-40s missing from results' % key)
+
+    if regressions:
+        print('%d benchmark(s) regressed: %s' % (len(regressions), ', '.join(regressions)))
+        return 1
+    print('No regressions.')
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command')
+
+    p = sub.add_parser('list', help='list the RunGen targets to build')
+    p.set_defaults(func=cmd_list)
+
+    p = sub.add_parser('run', help='run the benchmarks')
+    p.add_argument('--rungen', required=True,
+                   help='path to each RunGen binary, with {app}, {lib} and {name} substituted')
+    p.add_argument('--output', required=True, help='file to write the results to')
+    p.add_argument('--threads', default=DEFAULT_THREADS,
+                   help='comma-separated list of values of HL_NUM_THREADS (default %s)' % DEFAULT_THREADS)
+    p.add_argument('--min_time', type=float, default=1.0,
+                   help='minimum time to spend on each benchmark, in seconds')
+    p.add_argument('--filter', default='', help='only run benchmarks whose name contains this')
+    p.set_defaults(func=cmd_run)
+
+    p = sub.add_parser('compare', help='compare results against a baseline')
+    p.add_argument('baseline')
+    p.add_argument('results')
+    p.add_argument('--threshold', action='append',
+                   help='allowed slowdown in percent, either for all benchmarks (e.g. 5) or '
+                        'for one (e.g. blur=10 or blur/threads:4=10); may be repeated')
+    p.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    if not hasattr(args, 'func'):
+        parser.print_help()
+        return 1
+    return args.func(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -83,6 +83,29 @@ def test():
             for z in range(input_3d.shape[2]):
                 assert output_3d[x, y, z] == input_3d[x, y, z] + constant_i8
 
+    # Arguments can also be passed by name.
+    output_3d.fill(0)
+    addconstant.addconstant(
+        constant_u1,
+        constant_u8, constant_u16, constant_u32, constant_u64,
+        constant_i8, constant_i16, constant_i32, constant_i64,
+        constant_float, constant_double,
+        input_u8, input_u16, input_u32, input_u64,
+        input_i8, input_i16, input_i32, input_i64,
+        input_float, input_double, input_2d,
+        output_uint8=output_u8, output_uint16=output_u16,
+        output_uint32=output_u32, output_uint64=output_u64,
+        output_int8=output_i8, output_int16=output_i16,
+        output_int32=output_i32, output_int64=output_i64,
+        output_float=output_float, output_double=output_double,
+        buffer_2d=output_2d, buffer_3d=output_3d, input_3d=input_3d,
+    )
+
+    for x in range(input_3d.shape[0]):
+        for y in range(input_3d.shape[1]):
+            for z in range(input_3d.shape[2]):
+                assert output_3d[x, y, z] == input_3d[x, y, z] + constant_i8
+
 
 if __name__ == "__main__":
   test()
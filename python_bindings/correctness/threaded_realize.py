@@ -0,0 +1,124 @@
+from __future__ import print_function
+from __future__ import division
+
+import halide as hl
+import numpy as np
+import os
+import threading
+import time
+
+# The number of steps of a linear congruential generator to run per
+# pixel, to make each realization take a while.
+STEPS = 32
+
+def make_pipeline(input):
+    x, y = hl.Var('x'), hl.Var('y')
+    f = hl.Func('f')
+    v = input[x, y]
+    for i in range(STEPS):
+        v = v * 1664525 + 1013904223
+    f[x, y] = v
+    f.vectorize(x, 8)
+    return f
+
+def reference(a):
+    v = a.copy()
+    for i in range(STEPS):
+        v = v * np.uint32(1664525) + np.uint32(1013904223)
+    return v
+
+def make_input(seed, width, height):
+    a = np.random.RandomState(seed).randint(0, 1 << 30, size=(width, height)).astype(np.uint32)
+    # Inputs needn't be writable.
+    a.setflags(write=False)
+    return a
+
+def make_output(width, height):
+    # A transposed view, so the strides differ from those of the input.
+    return np.zeros((height, width), dtype=np.uint32).T
+
+def test_zero_copy():
+    input = hl.ImageParam(hl.UInt(32), 2, 'input')
+    f = make_pipeline(input)
+
+    a = make_input(0, 64, 48)
+    input.set(a)
+
+    # The output is realized into in-place, whatever its strides.
+    for out in [np.zeros((64, 48), dtype=np.uint32),
+                make_output(64, 48),
+                np.zeros((64, 96), dtype=np.uint32)[:, ::2],
+                np.zeros((64, 48), dtype=np.uint32)[::-1, :]]:
+        f.realize(out)
+        assert np.array_equal(out, reference(a))
+
+    # Strides that aren't a multiple of the element size can't be shared.
+    b = np.ndarray((64, 48), dtype=np.uint32, buffer=np.zeros(64 * 198, dtype=np.uint8), strides=(198, 4))
+    try:
+        f.realize(b)
+    except ValueError as e:
+        assert 'multiple of the element size' in str(e)
+    else:
+        assert False, 'Did not see expected exception!'
+
+def test_compile_jit_target():
+    input = hl.ImageParam(hl.UInt(32), 2, 'input')
+    p = hl.Pipeline(make_pipeline(input))
+
+    # realize() without a target reuses the one compile_jit() was given,
+    # rather than recompiling for the environment.
+    t = hl.get_jit_target_from_environment().with_feature(hl.TargetFeature.NoBoundsQuery)
+    p.compile_jit(t)
+    assert p.default_jit_target().has_feature(hl.TargetFeature.NoBoundsQuery)
+
+    a = make_input(1, 32, 16)
+    input.set(a)
+    out = make_output(32, 16)
+    p.realize(out)
+    assert np.array_equal(out, reference(a))
+    assert p.default_jit_target().has_feature(hl.TargetFeature.NoBoundsQuery)
+
+def run_threads(f, input, inputs, outputs, num_threads, iterations):
+    def work(i):
+        # Each thread gets its own input via a ParamMap, so they can
+        # all realize the same Func at once.
+        pm = hl.ParamMap()
+        pm.set(input, inputs[i])
+        for j in range(iterations):
+            f.realize(outputs[i], param_map=pm)
+
+    threads = [threading.Thread(target=work, args=(i,)) for i in range(num_threads)]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return time.time() - start
+
+def test_threaded_throughput():
+    width, height = 256, 256
+    iterations = 20
+    num_threads = max(2, min(4, os.cpu_count() or 1))
+
+    input = hl.ImageParam(hl.UInt(32), 2, 'input')
+    f = make_pipeline(input)
+    f.compile_jit()
+
+    inputs = [make_input(i, width, height) for i in range(num_threads)]
+    outputs = [make_output(width, height) for i in range(num_threads)]
+
+    single = run_threads(f, input, inputs, outputs, 1, iterations)
+    multi = run_threads(f, input, inputs, outputs, num_threads, iterations)
+
+    for i in range(num_threads):
+        assert np.array_equal(outputs[i], reference(inputs[i]))
+
+    single_throughput = iterations / single
+    multi_throughput = num_threads * iterations / multi
+    print("1 thread: %.1f realizations/s, %d threads: %.1f realizations/s (%.2fx)" %
+          (single_throughput, num_threads, multi_throughput, multi_throughput / single_throughput))
+
+if __name__ == "__main__":
+    test_zero_copy()
+    test_compile_jit_target()
+    test_threaded_throughput()
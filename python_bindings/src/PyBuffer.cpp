@@ -3,6 +3,8 @@
 #include "PyFunc.h"
 #include "PyType.h"
 
+#include <limits>
+
 namespace Halide {
 namespace PythonBindings {
 
@@ -107,7 +109,11 @@ std::string type_to_format_descriptor(const Type &type) {
     return std::string();
 }
 
-Type format_descriptor_to_type(const std::string &fd) {
+Type format_descriptor_to_type(const std::string &format) {
+    // An explicit native byte order (which e.g. numpy uses for views of
+    // unaligned data) doesn't change the sizes of the types we support.
+    const std::string fd =
+        (format.size() > 1 && (format[0] == '@' || format[0] == '=')) ? format.substr(1) : format;
 
     #define HANDLE_BUFFER_TYPE(TYPE) \
         if (fd == py::format_descriptor<TYPE>::format()) return type_of<TYPE>();
@@ -186,31 +192,48 @@ py::object buffer_setitem_operator(Buffer<> &buf, const std::vector<int> &pos, p
     return py::object();
 }
 
+std::vector<halide_dimension_t> make_dim_vec(const py::buffer_info &info) {
+    const Type t = format_descriptor_to_type(info.format);
+    std::vector<halide_dimension_t> dims;
+    dims.reserve(info.ndim);
+    for (int i = 0; i < info.ndim; i++) {
+        // Halide strides are in elements, so we can share the data of
+        // any view whose strides (which may be negative) are a multiple
+        // of the element size.
+        const ssize_t extent = info.shape[i];
+        const ssize_t stride = info.strides[i] / t.bytes();
+        if (stride * t.bytes() != info.strides[i]) {
+            throw py::value_error("Buffer strides must be a multiple of the element size.");
+        }
+        if (extent > std::numeric_limits<int32_t>::max() ||
+            stride > std::numeric_limits<int32_t>::max() ||
+            stride < std::numeric_limits<int32_t>::min()) {
+            throw py::value_error("Buffer extents and strides must fit in 32 bits.");
+        }
+        dims.push_back({0, (int32_t) extent, (int32_t) stride});
+    }
+    return dims;
+}
+
 // Use an alias class so that if we are created via a py::buffer, we can
 // keep the py::buffer_info class alive for the life of the Buffer<>,
 // ensuring the data isn't collected out from under us.
 class PyBuffer : public Buffer<> {
     py::buffer_info info;
 
-    static std::vector<halide_dimension_t> make_dim_vec(const py::buffer_info &info) {
-        const Type t = format_descriptor_to_type(info.format);
-        std::vector<halide_dimension_t> dims;
-        dims.reserve(info.ndim);
-        for (int i = 0; i < info.ndim; i++) {
-            // TODO: check for ssize_t -> int32_t overflow
-            dims.push_back({0, (int32_t) info.shape[i], (int32_t) (info.strides[i] / t.bytes())});
+    // Ask for a writable view if we can get one, so that we can be realized
+    // into; otherwise (e.g. for an ndarray with writeable=False) settle for a
+    // read-only one, which is fine for an input.
+    static py::buffer_info request_buffer(py::buffer &buffer) {
+        try {
+            return buffer.request(/*writable*/ true);
+        } catch (py::error_already_set &) {
+            return buffer.request(/*writable*/ false);
         }
-        return dims;
     }
 
     PyBuffer(py::buffer_info &&info, const std::string &name)
-        : Buffer<>(
-            format_descriptor_to_type(info.format),
-            info.ptr,
-            (int) info.ndim,
-            make_dim_vec(info).data(),
-            name
-        ),
+        : Buffer<>(buffer_info_to_buffer(info, name)),
         info(std::move(info)) {}
 
 public:
@@ -221,13 +244,23 @@ public:
         : Buffer<>(b), info() {}
 
     PyBuffer(py::buffer buffer, const std::string &name)
-        : PyBuffer(buffer.request(/*writable*/ true), name) {}
+        : PyBuffer(request_buffer(buffer), name) {}
 
     virtual ~PyBuffer() {}
 };
 
 }  // namespace
 
+Buffer<> buffer_info_to_buffer(const py::buffer_info &info, const std::string &name) {
+    return Buffer<>(
+        format_descriptor_to_type(info.format),
+        info.ptr,
+        (int) info.ndim,
+        make_dim_vec(info).data(),
+        name
+    );
+}
+
 void define_buffer(py::module &m) {
     using BufferDimension = Halide::Runtime::Buffer<>::Dimension;
 
@@ -488,6 +521,10 @@ void define_buffer(py::module &m) {
             return o.str();
         })
     ;
+
+    // Allow an ndarray (or any other buffer-like entity) to be passed anywhere a
+    // Buffer<> is expected; the resulting Buffer<> shares its data rather than copying it.
+    py::implicitly_convertible<py::buffer, Buffer<>>();
 }
 
 }  // namespace PythonBindings
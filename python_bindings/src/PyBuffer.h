@@ -8,6 +8,11 @@ namespace PythonBindings {
 
 void define_buffer(py::module &m);
 
+// Make a Buffer<> that shares the data described by the buffer_info (which
+// must outlive it). Throws a ValueError if the layout of the data can't be
+// represented by a Buffer<>.
+Buffer<> buffer_info_to_buffer(const py::buffer_info &info, const std::string &name = "");
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
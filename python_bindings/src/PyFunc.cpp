@@ -5,6 +5,7 @@
 #include "PyExpr.h"
 #include "PyFuncRef.h"
 #include "PyLoopLevel.h"
+#include "PyPipeline.h"
 #include "PyScheduleMethods.h"
 #include "PyStage.h"
 #include "PyTuple.h"
@@ -36,16 +37,6 @@ void define_set(py::class_<Func> &func_class) {
     ;
 }
 
-py::object realization_to_object(const Realization &r) {
-    // Only one Buffer -> just return it
-    if (r.size() == 1) {
-        return py::cast(r[0]);
-    }
-
-    // Multiple -> return as Python tuple
-    return to_python_tuple(r);
-}
-
 }  // namespace
 
 void define_func(py::module &m) {
@@ -56,6 +47,11 @@ void define_func(py::module &m) {
     // TODO: ParamMap to its own file?
     auto param_map_class = py::class_<ParamMap>(m, "ParamMap")
         .def(py::init<>())
+        // Keep the buffer (which may be e.g. an ndarray we're sharing the data of)
+        // alive as long as the ParamMap.
+        .def("set", [](ParamMap &pm, const ImageParam &p, Buffer<> buf) -> void {
+            pm.set(p, buf);
+        }, py::arg("p"), py::arg("buf"), py::keep_alive<1, 3>())
     ;
 
     // Deliberately not supported, because they don't seem to make sense for Python:
@@ -83,36 +79,51 @@ void define_func(py::module &m) {
         .def(py::init([](const ImageParam &im) -> Func { return im; }))
 
         .def("realize", [](Func &f, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            f.realize(buffer, target);
+            Pipeline p = f.pipeline();
+            realize_without_gil(p, Realization(buffer), target, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+
+        // See the corresponding Pipeline::realize() overload.
+        .def("realize", [](Func &f, py::buffer dst, const Target &target, const ParamMap &param_map) -> void {
+            Pipeline p = f.pipeline();
+            py::buffer_info info = dst.request(/*writable*/ true);
+            Buffer<> buffer = buffer_info_to_buffer(info);
+            realize_without_gil(p, Realization(buffer), target, param_map);
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Func &f, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            f.realize(Realization(buffers), t);
+            Pipeline p = f.pipeline();
+            realize_without_gil(p, Realization(buffers), t, param_map);
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("realize", [](Func &f, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(sizes, target, param_map));
+            Pipeline p = f.pipeline();
+            return realize_without_gil(p, sizes, target, param_map);
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, target, param_map));
+            Pipeline p = f.pipeline();
+            return realize_without_gil(p, {x_size}, target, param_map);
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, target, param_map));
+            Pipeline p = f.pipeline();
+            return realize_without_gil(p, {x_size, y_size}, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, target, param_map));
+            Pipeline p = f.pipeline();
+            return realize_without_gil(p, {x_size, y_size, z_size}, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, w_size, target, param_map));
+            Pipeline p = f.pipeline();
+            return realize_without_gil(p, {x_size, y_size, z_size, w_size}, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("defined", &Func::defined)
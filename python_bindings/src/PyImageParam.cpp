@@ -61,7 +61,9 @@ void define_image_param(py::module &m) {
         .def(py::init<>())
         .def(py::init<Type, int>())
         .def(py::init<Type, int, std::string>(), py::arg("type"), py::arg("dimensions"), py::arg("name"))
-        .def("set", &ImageParam::set)
+        // Keep the buffer (which may be e.g. an ndarray we're sharing the data of)
+        // alive as long as the ImageParam.
+        .def("set", &ImageParam::set, py::keep_alive<1, 2>())
         .def("get", &ImageParam::get)
         .def("reset", &ImageParam::reset)
         .def("__getitem__", [](ImageParam &im, const Expr &args) -> Expr {
@@ -1,5 +1,6 @@
 #include "PyPipeline.h"
 
+#include "PyBuffer.h"
 #include "PyTuple.h"
 
 namespace Halide {
@@ -17,8 +18,39 @@ py::object realization_to_object(const Realization &r) {
     return to_python_tuple(r);
 }
 
+// Resolve an unspecified target the same way Pipeline::realize() does:
+// reuse the target the pipeline was already jit-compiled for, if any.
+Target jit_target_or_default(const Pipeline &p, const Target &target) {
+    if (target.os == Target::OSUnknown) {
+        return p.default_jit_target();
+    }
+    return target;
+}
+
 }  // namespace
 
+void realize_without_gil(Pipeline &p, Realization outputs, const Target &target, const ParamMap &param_map) {
+    const Target t = jit_target_or_default(p, target);
+    // Compiling isn't safe to do from more than one thread at once, but
+    // once the pipeline is compiled for t, realizing it doesn't modify
+    // the Pipeline (or touch any Python objects), so it's safe to run
+    // concurrently, as long as all the threads use the same target, and
+    // any inputs that differ between them are passed in the ParamMap.
+    (void) p.compile_jit(t);
+    py::gil_scoped_release release;
+    p.realize(outputs, t, param_map);
+}
+
+py::object realize_without_gil(Pipeline &p, const std::vector<int32_t> &sizes, const Target &target, const ParamMap &param_map) {
+    const Target t = jit_target_or_default(p, target);
+    (void) p.compile_jit(t);
+    Realization r = [&]() {
+        py::gil_scoped_release release;
+        return p.realize(sizes, t, param_map);
+    }();
+    return realization_to_object(r);
+}
+
 void define_pipeline(py::module &m) {
 
     // Deliberately not supported, because they don't seem to make sense for Python:
@@ -80,41 +112,50 @@ void define_pipeline(py::module &m) {
             py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata)
 
         .def("compile_jit", [](Pipeline &p, const Target &target) -> void {
-            (void) p.compile_jit();
+            (void) p.compile_jit(target);
         }, py::arg("target") = get_jit_target_from_environment())
-
+        .def("default_jit_target", &Pipeline::default_jit_target)
 
         .def("realize", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffer), target);
+            realize_without_gil(p, Realization(buffer), target, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+
+        // Any other object that supports the buffer protocol (e.g. an ndarray, of any
+        // strides) is realized into in-place. This must come before the sizes overloads,
+        // so that a 1-D array of ints isn't mistaken for a list of sizes.
+        .def("realize", [](Pipeline &p, py::buffer dst, const Target &target, const ParamMap &param_map) -> void {
+            py::buffer_info info = dst.request(/*writable*/ true);
+            Buffer<> buffer = buffer_info_to_buffer(info);
+            realize_without_gil(p, Realization(buffer), target, param_map);
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffers), t);
+            realize_without_gil(p, Realization(buffers), t, param_map);
         }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(sizes, target, param_map));
+            return realize_without_gil(p, sizes, target, param_map);
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, target, param_map));
+            return realize_without_gil(p, {x_size}, target, param_map);
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, target, param_map));
+            return realize_without_gil(p, {x_size, y_size}, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, target, param_map));
+            return realize_without_gil(p, {x_size, y_size, z_size}, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realize_without_gil(p, {x_size, y_size, z_size, w_size}, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("infer_input_bounds", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const ParamMap &param_map) -> void {
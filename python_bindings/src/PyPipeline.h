@@ -8,6 +8,13 @@ namespace PythonBindings {
 
 void define_pipeline(py::module &m);
 
+// Realize the Pipeline into the given outputs, or into new outputs of the
+// given sizes. The Pipeline is JIT-compiled (if need be) while holding the
+// GIL, and the GIL is released while the compiled pipeline runs, so that
+// other Python threads can run (or realize other outputs) meanwhile.
+void realize_without_gil(Pipeline &p, Realization outputs, const Target &target, const ParamMap &param_map);
+py::object realize_without_gil(Pipeline &p, const std::vector<int32_t> &sizes, const Target &target, const ParamMap &param_map);
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
@@ -0,0 +1,184 @@
+#include "AddBatchWrapper.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Make a call and return the result upwards immediately if it's
+// non-zero.
+Stmt make_checked_call(Expr call) {
+    internal_assert(call.type() == Int(32));
+    string result_var_name = unique_name('t');
+    Expr result_var = Variable::make(Int(32), result_var_name);
+    Stmt s = AssertStmt::make(result_var == 0, result_var);
+    s = LetStmt::make(result_var_name, call, s);
+    return s;
+}
+
+Expr buffer_field(Type t, const string &field, Expr buf) {
+    return Call::make(t, field, {buf}, Call::Extern);
+}
+
+Expr buffer_field(Type t, const string &field, Expr buf, int dim) {
+    return Call::make(t, field, {buf, dim}, Call::Extern);
+}
+
+}  // namespace
+
+void add_batch_wrapper(Module module, const LoweredFunc &fn) {
+    if (!module.target().has_feature(Target::Batch)) {
+        return;
+    }
+
+    // The batch is the outermost dimension of the first output.
+    const LoweredArgument *first_output = nullptr;
+    for (const LoweredArgument &arg : fn.args) {
+        if (arg.is_output()) {
+            first_output = &arg;
+            break;
+        }
+    }
+    internal_assert(first_output) << "Pipeline " << fn.name << " has no outputs\n";
+    Expr first_output_buf = Variable::make(type_of<struct halide_buffer_t *>(), first_output->name + ".buffer");
+    string batch_min_name = fn.name + ".batch.min";
+    string batch_extent_name = fn.name + ".batch.extent";
+    Expr batch_min = Variable::make(Int(32), batch_min_name);
+    Expr batch_extent = Variable::make(Int(32), batch_extent_name);
+    Expr batch_max = batch_min + batch_extent - 1;
+    string batch_name = unique_name('b');
+    Expr batch = Variable::make(Int(32), batch_name);
+
+    vector<LoweredArgument> args;
+    vector<Stmt> checks, bounds_checks, copies, prepare, finish;
+    vector<Expr> call_args;
+    vector<pair<string, Expr>> slices;
+    for (const LoweredArgument &arg : fn.args) {
+        if (!arg.is_buffer()) {
+            args.push_back(arg);
+            call_args.push_back(Variable::make(arg.type, arg.name));
+            continue;
+        }
+
+        const int d = arg.dimensions;
+        internal_assert(d < 255) << "Buffer " << arg.name << " has too many dimensions to batch\n";
+        args.emplace_back(arg.name, arg.kind, arg.type, d + 1);
+
+        Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), arg.name + ".buffer");
+        string error_name = (arg.is_output() ? "Output" : "Input");
+        error_name += " buffer " + arg.name;
+
+        // These mirror the checks the pipeline makes of its own
+        // arguments, which it can't make of the batched buffers.
+        checks.push_back(AssertStmt::make(reinterpret<uint64_t>(buf) != 0,
+                                          Call::make(Int(32), "halide_error_buffer_argument_is_null",
+                                                     {arg.name}, Call::Extern)));
+
+        Expr type_code = buffer_field(UInt(8), Call::buffer_get_type_code, buf);
+        Expr type_bits = buffer_field(UInt(8), Call::buffer_get_type_bits, buf);
+        Expr type_lanes = buffer_field(UInt(16), Call::buffer_get_type_lanes, buf);
+        checks.push_back(AssertStmt::make((type_code == arg.type.code()) &&
+                                          (type_bits == arg.type.bits()) &&
+                                          (type_lanes == arg.type.lanes()),
+                                          Call::make(Int(32), "halide_error_bad_type",
+                                                     {error_name,
+                                                      type_code, make_const(UInt(8), (int)arg.type.code()),
+                                                      type_bits, make_const(UInt(8), arg.type.bits()),
+                                                      type_lanes, make_const(UInt(16), arg.type.lanes())},
+                                                     Call::Extern)));
+
+        Expr dimensions = buffer_field(Int(32), Call::buffer_get_dimensions, buf);
+        checks.push_back(AssertStmt::make(dimensions == d + 1,
+                                          Call::make(Int(32), "halide_error_bad_dimensions",
+                                                     {error_name, dimensions, d + 1}, Call::Extern)));
+
+        // Every buffer must cover the batch.
+        Expr min = buffer_field(Int(32), Call::buffer_get_min, buf, d);
+        Expr extent = buffer_field(Int(32), Call::buffer_get_extent, buf, d);
+        Expr max = min + extent - 1;
+        bounds_checks.push_back(AssertStmt::make(min <= batch_min && max >= batch_max,
+                                                 Call::make(Int(32), "halide_error_access_out_of_bounds",
+                                                            {error_name, d, batch_min, batch_max, min, max},
+                                                            Call::Extern)));
+
+        // The pipeline is called on slices of the host allocations, so
+        // we can't answer bounds queries, or run on device-only outputs.
+        Expr host = buffer_field(type_of<void *>(), Call::buffer_get_host, buf);
+        bounds_checks.push_back(AssertStmt::make(reinterpret<uint64_t>(host) != 0,
+                                                 Call::make(Int(32), "halide_error_host_is_null",
+                                                            {error_name}, Call::Extern)));
+
+        // Only touch the buffers once every check has passed, so that
+        // a failed call leaves them as it found them.
+        if (arg.is_input()) {
+            copies.push_back(make_checked_call(Call::make(Int(32), "halide_copy_to_host",
+                                                          {buf}, Call::Extern)));
+        } else {
+            // The whole output is about to be overwritten on the host.
+            prepare.push_back(Evaluate::make(Call::make(Int(32), Call::buffer_set_device_dirty,
+                                                        {buf, const_false()}, Call::Extern)));
+            finish.push_back(Evaluate::make(Call::make(Int(32), Call::buffer_set_host_dirty,
+                                                       {buf, const_true()}, Call::Extern)));
+        }
+
+        // The slice at the current batch coordinate.
+        BufferBuilder builder;
+        Expr stride = buffer_field(Int(32), Call::buffer_get_stride, buf, d);
+        Expr offset = cast<int64_t>(batch - min) * stride * arg.type.bytes();
+        builder.host = reinterpret(type_of<void *>(), reinterpret<uint64_t>(host) + reinterpret<uint64_t>(offset));
+        builder.type = arg.type;
+        builder.dimensions = d;
+        for (int i = 0; i < d; i++) {
+            builder.mins.push_back(buffer_field(Int(32), Call::buffer_get_min, buf, i));
+            builder.extents.push_back(buffer_field(Int(32), Call::buffer_get_extent, buf, i));
+            builder.strides.push_back(buffer_field(Int(32), Call::buffer_get_stride, buf, i));
+        }
+        string slice_name = arg.name + ".batch_slice";
+        slices.emplace_back(slice_name, builder.build());
+        call_args.push_back(Variable::make(type_of<struct halide_buffer_t *>(), slice_name));
+    }
+
+    Call::CallType call_type = Call::Extern;
+    if (fn.name_mangling == NameMangling::CPlusPlus ||
+        (fn.name_mangling == NameMangling::Default &&
+         module.target().has_feature(Target::CPlusPlusMangling))) {
+        call_type = Call::ExternCPlusPlus;
+    }
+    Stmt loop_body = make_checked_call(Call::make(Int(32), fn.name, call_args, call_type));
+    while (!slices.empty()) {
+        loop_body = LetStmt::make(slices.back().first, slices.back().second, loop_body);
+        slices.pop_back();
+    }
+    // One parallel loop over the batch amortizes the cost of waking
+    // up the thread pool across the batch. Each call still checks its
+    // own arguments.
+    Stmt loop = For::make(batch_name, batch_min, batch_extent,
+                          ForType::Parallel, DeviceAPI::None, loop_body);
+
+    vector<Stmt> stmts = bounds_checks;
+    stmts.insert(stmts.end(), copies.begin(), copies.end());
+    stmts.insert(stmts.end(), prepare.begin(), prepare.end());
+    stmts.push_back(loop);
+    stmts.insert(stmts.end(), finish.begin(), finish.end());
+    Stmt body = Block::make(stmts);
+    body = LetStmt::make(batch_extent_name,
+                         buffer_field(Int(32), Call::buffer_get_extent, first_output_buf, first_output->dimensions),
+                         body);
+    body = LetStmt::make(batch_min_name,
+                         buffer_field(Int(32), Call::buffer_get_min, first_output_buf, first_output->dimensions),
+                         body);
+    // The batch dimension can only be read once the dimensions have been checked.
+    body = Block::make(Block::make(checks), body);
+
+    debug(2) << "Added batch wrapper for " << fn.name << ":\n" << body << "\n\n";
+    LoweredFunc wrapper(fn.name + "_batch", args, body, LinkageType::External, NameMangling::Default);
+    module.append(wrapper);
+}
+
+}  // namespace Internal
+}  // namespace Halide
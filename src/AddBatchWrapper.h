@@ -0,0 +1,27 @@
+#ifndef HALIDE_ADD_BATCH_WRAPPER_H
+#define HALIDE_ADD_BATCH_WRAPPER_H
+
+#include "Module.h"
+
+/** \file
+ *
+ * Defines a pass over a Module that adds an entry point that runs a
+ * pipeline over a batch of inputs and outputs. */
+
+namespace Halide {
+namespace Internal {
+
+/** If the Module's target has the Batch feature, add a function named
+ * fn.name + "_batch" to it, which takes the same arguments as fn, but
+ * with an extra outermost dimension on every buffer. It calls fn once
+ * per coordinate of the outermost dimension of the first output (in a
+ * parallel loop), on the slices of the buffers at that coordinate. The
+ * scalar arguments are shared by every call. Only the LLVM backends
+ * support the wrapper; the C backend raises a user error if the
+ * Module's target has the Batch feature. */
+void add_batch_wrapper(Module m, const LoweredFunc &fn);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,5 +1,6 @@
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
+#include "CodeGen_Internal.h"
 #include "IRMutator.h"
 #include "Simplify.h"
 
@@ -26,6 +27,12 @@ class BoundSmallAllocations : public IRMutator2 {
     }
 
     bool in_thread_loop = false;
+    bool in_gpu_loop = false;
+
+    // The number of bytes of stack used by the enclosing allocations
+    // that run on the same thread, and the most we may use.
+    int64_t stack_bytes = 0;
+    const int64_t stack_budget;
 
     Stmt visit(const For *op) override {
         Interval min_bounds = find_constant_bounds(op->min, scope);
@@ -36,6 +43,13 @@ class BoundSmallAllocations : public IRMutator2 {
         ScopedBinding<Interval> bind(scope, op->name, b);
         ScopedValue<bool> old_in_thread_loop(in_thread_loop, in_thread_loop ||
                                              op->for_type == ForType::GPUThread);
+        ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, in_gpu_loop ||
+                                          op->for_type == ForType::GPUBlock ||
+                                          op->for_type == ForType::GPUThread ||
+                                          op->for_type == ForType::GPULane);
+        // The body of a parallel loop may run on a worker thread,
+        // which has its own stack.
+        ScopedValue<int64_t> old_stack_bytes(stack_bytes, op->for_type == ForType::Parallel ? 0 : stack_bytes);
         return IRMutator2::visit(op);
     }
 
@@ -55,28 +69,55 @@ class BoundSmallAllocations : public IRMutator2 {
             << "Allocation " << op->name << " has a dynamic size. "
             << "Only fixed-size allocations are supported on the gpu. "
             << "Try storing into shared memory instead.";
-        // 128 bytes is a typical minimum allocation size in
-        // halide_malloc. For now we are very conservative, and only
-        // round sizes up to a constant if they're smaller than that.
-        Expr malloc_overhead = 128 / op->type.bytes();
+        // Round the sizes of allocations with a small constant bound
+        // up to that bound, so that codegen puts them on the stack
+        // rather than calling halide_malloc (e.g. for per-tile scratch
+        // buffers in a parallel loop), as long as the allocations live
+        // on the stack of this thread at the same time fit in the
+        // stack budget.
+        int64_t bytes = 0;
+        if (bound.defined()) {
+            bound = simplify(bound);
+            if (const int64_t *b = as_const_int(bound)) {
+                bytes = *b * op->type.bytes();
+            }
+        }
+        bool fits_on_stack = (bytes > 0 &&
+                              can_allocation_fit_on_stack(bytes) &&
+                              stack_bytes + bytes <= stack_budget);
         if (bound.defined() &&
             (in_thread_loop ||
              op->memory_type == MemoryType::Stack ||
              op->memory_type == MemoryType::Register ||
-             (op->memory_type == MemoryType::Auto && can_prove(bound <= malloc_overhead)))) {
+             (op->memory_type == MemoryType::Auto && fits_on_stack))) {
             user_assert(can_prove(bound <= Int(32).max()))
                 << "Allocation " << op->name << " has a size greater than 2^31: " << bound << "\n";
             bound = simplify(cast<int32_t>(bound));
+            ScopedValue<int64_t> old_stack_bytes(stack_bytes, stack_bytes + (in_thread_loop ? 0 : bytes));
             return Allocate::make(op->name, op->type, op->memory_type, {bound}, op->condition,
                                   mutate(op->body), op->new_expr, op->free_function);
+        } else if (op->memory_type == MemoryType::Auto && !in_gpu_loop &&
+                   !op->new_expr.defined() && bytes > 0 &&
+                   Allocate::constant_allocation_size(op->extents, op->name) > 0 &&
+                   can_allocation_fit_on_stack(bytes)) {
+            // This allocation has a constant size small enough that
+            // codegen would put it on the stack, but it would exceed
+            // the stack budget, so put it on the heap instead.
+            debug(2) << "Allocation " << op->name << " of " << bytes
+                     << " bytes exceeds the stack budget, placing it on the heap\n";
+            return Allocate::make(op->name, op->type, MemoryType::Heap, op->extents, op->condition,
+                                  mutate(op->body), op->new_expr, op->free_function);
         } else {
             return IRMutator2::visit(op);
         }
     }
+
+public:
+    BoundSmallAllocations(int64_t stack_budget) : stack_budget(stack_budget) {}
 };
 
 Stmt bound_small_allocations(const Stmt &s) {
-    return BoundSmallAllocations().mutate(s);
+    return BoundSmallAllocations(get_stack_budget()).mutate(s);
 }
 
 }  // namespace Internal
@@ -434,6 +434,30 @@ public:
         return *this;
     }
 
+    template<typename Fn, typename ...Args>
+    Buffer<T> &par_for_each_value(halide_do_par_for_t do_par_for, Fn &&f, Args... other_buffers) {
+        get()->par_for_each_value(do_par_for, std::forward<Fn>(f), (*std::forward<Args>(other_buffers).get())...);
+        return *this;
+    }
+
+    template<typename Fn, typename ...Args>
+    const Buffer<T> &par_for_each_value(halide_do_par_for_t do_par_for, Fn &&f, Args... other_buffers) const {
+        get()->par_for_each_value(do_par_for, std::forward<Fn>(f), (*std::forward<Args>(other_buffers).get())...);
+        return *this;
+    }
+
+    template<typename Fn>
+    Buffer<T> &par_for_each_element(halide_do_par_for_t do_par_for, Fn &&f) {
+        get()->par_for_each_element(do_par_for, std::forward<Fn>(f));
+        return *this;
+    }
+
+    template<typename Fn>
+    const Buffer<T> &par_for_each_element(halide_do_par_for_t do_par_for, Fn &&f) const {
+        get()->par_for_each_element(do_par_for, std::forward<Fn>(f));
+        return *this;
+    }
+
     template<typename FnOrValue>
     Buffer<T> &fill(FnOrValue &&f) {
         get()->fill(std::forward<FnOrValue>(f));
@@ -469,8 +493,8 @@ public:
     }
 
     template<typename T2>
-    void copy_from(const Buffer<T2> &other) {
-        contents->buf.copy_from(*other.get());
+    void copy_from(const Buffer<T2> &other, halide_do_par_for_t do_par_for = nullptr) {
+        contents->buf.copy_from(*other.get(), do_par_for);
     }
 
     template<typename ...Args>
@@ -1426,6 +1426,11 @@ void CodeGen_C::forward_declare_type_if_needed(const Type &t) {
 }
 
 void CodeGen_C::compile(const Module &input) {
+    // The batch wrapper returns errors from inside a parallel loop,
+    // which can't be emitted as an OpenMP loop.
+    user_assert(is_header() || !input.target().has_feature(Target::Batch))
+        << "The batch target feature is not supported by C backend.\n";
+
     TypeInfoGatherer type_info;
     for (const auto &f : input.functions()) {
         if (f.body.defined()) {
@@ -2467,7 +2472,7 @@ void CodeGen_C::visit(const Allocate *op) {
         alloc.type = op->type;
         allocations.push(op->name, alloc);
         heap_allocations.push(op->name);
-        stream << op_type << "*" << op_name << " = (" << print_expr(op->new_expr) << ");\n";
+        stream << op_type << "*" << op_name << " = (" << op_type << "*)(" << print_expr(op->new_expr) << ");\n";
     } else {
         constant_size = op->constant_allocation_size();
         if (constant_size > 0) {
@@ -1,3 +1,5 @@
+#include <cstdlib>
+
 #include "CodeGen_Internal.h"
 #include "CSE.h"
 #include "Debug.h"
@@ -221,6 +223,19 @@ bool can_allocation_fit_on_stack(int64_t size) {
     return (size <= 1024 * 16);
 }
 
+int64_t get_stack_budget() {
+    static int64_t budget = []() {
+        string budget_str = get_env_variable("HL_STACK_BUDGET");
+        if (budget_str.empty()) {
+            return (int64_t)128 * 1024;
+        }
+        int64_t b = std::atoll(budget_str.c_str());
+        user_assert(b >= 0) << "HL_STACK_BUDGET must be non-negative: " << budget_str << "\n";
+        return b;
+    }();
+    return budget;
+}
+
 Expr lower_euclidean_div(Expr a, Expr b) {
     internal_assert(a.type() == b.type());
     // IROperator's div_round_to_zero will replace this with a / b for
@@ -68,6 +68,14 @@ bool function_takes_user_context(const std::string &name);
  * non-positive. */
 bool can_allocation_fit_on_stack(int64_t size);
 
+/** The total size (in bytes) of the fixed-size allocations that may be
+ * live on the stack of one thread at once. Allocations beyond this
+ * budget are placed on the heap. Defaults to 128KB, and can be set
+ * with the environment variable HL_STACK_BUDGET at compile time. The
+ * stacks of the threads running the pipeline (see
+ * halide_set_thread_stack_size) must be comfortably larger than this. */
+int64_t get_stack_budget();
+
 /** Given a Halide Euclidean division/mod operation, define it in terms of
  * div_round_to_zero or mod_round_to_zero. */
 ///@{
@@ -5,6 +5,7 @@
 
 #include "Lower.h"
 
+#include "AddBatchWrapper.h"
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
@@ -35,6 +36,7 @@
 #include "LoopCarry.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "MemoryPlanning.h"
 #include "PartitionLoops.h"
 #include "Prefetch.h"
 #include "Profiling.h"
@@ -330,6 +332,19 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     s = remove_dead_allocations(s);
     s = remove_trivial_for_loops(s);
+
+    // Device buffers may have their host memory managed elsewhere, so
+    // only plan the memory of pipelines that run entirely on the host.
+    if (t.has_feature(Target::PlanMemory) &&
+        t.arch != Target::Hexagon &&
+        !t.has_gpu_feature() &&
+        !t.features_any_of({Target::OpenGL, Target::OpenGLCompute,
+                            Target::HVX_64, Target::HVX_128})) {
+        debug(1) << "Planning memory...\n";
+        s = plan_memory(s, t);
+        debug(2) << "Lowering after planning memory:\n" << s << "\n\n";
+    }
+
     s = simplify(s);
     s = loop_invariant_code_motion(s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
@@ -438,6 +453,8 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // require C++ linkage. We don't need it when jitting.
     if (!t.has_feature(Target::JIT)) {
         add_legacy_wrapper(result_module, main_func);
+        // And one that runs the pipeline over a batch, if requested.
+        add_batch_wrapper(result_module, main_func);
     }
 
     // Also append any wrappers for extern stages that expect the old buffer_t
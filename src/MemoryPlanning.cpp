@@ -0,0 +1,450 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "MemoryPlanning.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The offsets of the allocations within an arena are rounded up to
+// this many bytes, so they are as aligned as the arena itself, which
+// comes from halide_malloc.
+const int arena_alignment = 128;
+
+// If name refers to the buffer_t of an allocation, get the name of the
+// allocation.
+string strip_buffer_suffix(const string &name) {
+    if (ends_with(name, ".buffer")) {
+        return name.substr(0, name.size() - 7);
+    }
+    return name;
+}
+
+// Find the names of the allocations referred to by a statement or
+// expression. Frees don't count, because an allocation in the arena
+// has nothing to free.
+class FindUses : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        names.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        names.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        names.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        // Don't reuse the memory of an allocation while a buffer that
+        // may refer to it is still in use.
+        names.insert(strip_buffer_suffix(op->name));
+    }
+
+public:
+    set<string> names;
+};
+
+// Check if the size of an allocation can be computed before the
+// statements at its loop level run, i.e. it doesn't depend on the
+// contents or address of any allocation at that level.
+class CanComputeEarly : public IRVisitor {
+    using IRVisitor::visit;
+
+    const set<string> &allocations;
+
+    void visit(const Load *op) override {
+        result = false;
+    }
+
+    void visit(const Call *op) override {
+        // The fields of buffers are extern calls, but they can be
+        // read at any time.
+        if (op->call_type != Call::Intrinsic &&
+            op->call_type != Call::PureIntrinsic &&
+            op->call_type != Call::PureExtern &&
+            !starts_with(op->name, "_halide_buffer_get_")) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        if (allocations.count(strip_buffer_suffix(op->name))) {
+            result = false;
+        }
+    }
+
+public:
+    bool result = true;
+
+    CanComputeEarly(const set<string> &allocations) : allocations(allocations) {}
+};
+
+// An allocation that may be placed in an arena.
+struct ArenaAllocation {
+    const Allocate *op;
+    // The size of the allocation in bytes, which can be computed at
+    // the top of its loop level.
+    Expr size;
+    // The range of statements of the loop level over which the
+    // allocation is live.
+    int first_use, last_use;
+};
+
+// Number the statements of one loop level in the order they run,
+// looking through the Blocks, LetStmts, Allocates and
+// ProducerConsumers, and find the first and last statement that uses
+// each allocation. Any other statement (e.g. a For loop) counts as a
+// single statement.
+class LinearizeLevel {
+    int index = 0;
+
+    // The first and last use of each name.
+    map<string, pair<int, int>> uses;
+
+    // The LetStmts and Allocates enclosing the current statement.
+    vector<pair<string, Expr>> lets;
+    set<string> allocations;
+
+    void record_uses(const FindUses &f) {
+        for (const string &n : f.names) {
+            auto it = uses.find(n);
+            if (it == uses.end()) {
+                uses[n] = {index, index};
+            } else {
+                it->second.second = index;
+            }
+        }
+    }
+
+    template<typename T>
+    void record_uses(const T &node) {
+        FindUses f;
+        node.accept(&f);
+        record_uses(f);
+    }
+
+    bool is_candidate(const Allocate *op) {
+        if (op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            op->extents.empty() ||
+            !is_one(op->condition) ||
+            (op->memory_type != MemoryType::Auto &&
+             op->memory_type != MemoryType::Heap)) {
+            return false;
+        }
+        // Small constant-sized allocations go on the stack.
+        int32_t constant_bytes = Allocate::constant_allocation_size(op->extents, op->name);
+        if (constant_bytes > 0 &&
+            op->memory_type == MemoryType::Auto &&
+            can_allocation_fit_on_stack((int64_t)constant_bytes * op->type.bytes())) {
+            return false;
+        }
+        return true;
+    }
+
+    void visit(const Allocate *op) {
+        for (const Expr &e : op->extents) {
+            record_uses(e);
+        }
+        record_uses(op->condition);
+        index++;
+
+        if (is_candidate(op)) {
+            // Pad the allocation as codegen would, as we may read one
+            // scalar past the end of it.
+            Expr size = make_const(Int(64), op->type.bytes());
+            for (const Expr &e : op->extents) {
+                size *= cast<int64_t>(e);
+            }
+            size += op->type.bytes();
+            for (size_t i = lets.size(); i > 0; i--) {
+                size = Let::make(lets[i - 1].first, lets[i - 1].second, size);
+            }
+            size = simplify(size);
+            CanComputeEarly check(allocations);
+            size.accept(&check);
+            if (check.result) {
+                candidates.push_back({op, size, -1, -1});
+            }
+        }
+
+        allocations.insert(op->name);
+        linearize(op->body);
+        allocations.erase(op->name);
+    }
+
+    void visit(const LetStmt *op) {
+        // Making a buffer_t that refers to an allocation doesn't use
+        // it, but uses of the buffer_t do.
+        if (!ends_with(op->name, ".buffer")) {
+            record_uses(op->value);
+        }
+        index++;
+        lets.push_back({op->name, op->value});
+        linearize(op->body);
+        lets.pop_back();
+    }
+
+public:
+    vector<ArenaAllocation> candidates;
+
+    void linearize(const Stmt &s) {
+        if (const Block *op = s.as<Block>()) {
+            linearize(op->first);
+            linearize(op->rest);
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            visit(op);
+        } else if (const Allocate *op = s.as<Allocate>()) {
+            visit(op);
+        } else if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+            linearize(op->body);
+        } else {
+            record_uses(s);
+            index++;
+        }
+    }
+
+    // Fill in the live ranges of the candidates, once the whole level
+    // has been linearized.
+    void find_live_ranges() {
+        for (ArenaAllocation &c : candidates) {
+            auto it = uses.find(c.op->name);
+            if (it == uses.end()) {
+                c.first_use = c.last_use = 0;
+            } else {
+                c.first_use = it->second.first;
+                c.last_use = it->second.second;
+            }
+        }
+    }
+};
+
+// Check if a statement contains any of the allocations placed in an
+// arena.
+class ContainsPlaced : public IRVisitor {
+    using IRVisitor::visit;
+
+    const map<const Allocate *, Expr> &placement;
+
+    void visit(const Allocate *op) override {
+        if (placement.count(op)) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+
+    ContainsPlaced(const map<const Allocate *, Expr> &placement) : placement(placement) {}
+};
+
+// Point the allocations placed in an arena at their offset in it, and
+// allocate the arena around the innermost statement of the loop level
+// that contains all of them, so that it comes after any assertions
+// made at the top of the level.
+class PlaceInArena : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const map<const Allocate *, Expr> &placement;
+    std::function<Stmt(const Stmt &)> make_arena;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = placement.find(op);
+        if (it == placement.end()) {
+            return IRMutator2::visit(op);
+        }
+        // The arena is freed when its own allocation ends.
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, mutate(op->body),
+                              it->second, "halide_device_host_nop_free");
+    }
+
+    bool contains_placed(const Stmt &s) {
+        ContainsPlaced c(placement);
+        s.accept(&c);
+        return c.result;
+    }
+
+public:
+    PlaceInArena(const map<const Allocate *, Expr> &placement,
+                 std::function<Stmt(const Stmt &)> make_arena)
+        : placement(placement), make_arena(make_arena) {}
+
+    Stmt insert_arena(const Stmt &s) {
+        if (const Block *op = s.as<Block>()) {
+            if (!contains_placed(op->first)) {
+                return Block::make(op->first, insert_arena(op->rest));
+            } else if (!contains_placed(op->rest)) {
+                return Block::make(insert_arena(op->first), op->rest);
+            }
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            return LetStmt::make(op->name, op->value, insert_arena(op->body));
+        } else if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+            return ProducerConsumer::make(op->name, op->is_producer, insert_arena(op->body));
+        } else if (const Allocate *op = s.as<Allocate>()) {
+            if (!placement.count(op)) {
+                return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                      op->condition, insert_arena(op->body),
+                                      op->new_expr, op->free_function);
+            }
+        }
+        return make_arena(mutate(s));
+    }
+};
+
+class PlanMemory : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const Target &target;
+
+    Stmt visit(const For *op) override {
+        // Leave device code alone.
+        if ((op->device_api != DeviceAPI::None &&
+             op->device_api != DeviceAPI::Host) ||
+            op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            return op;
+        }
+        Stmt body = plan_level(mutate(op->body));
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        Stmt then_case = plan_level(mutate(op->then_case));
+        Stmt else_case = op->else_case;
+        if (else_case.defined()) {
+            else_case = plan_level(mutate(else_case));
+        }
+        if (then_case.same_as(op->then_case) &&
+            else_case.same_as(op->else_case)) {
+            return op;
+        }
+        return IfThenElse::make(op->condition, then_case, else_case);
+    }
+
+public:
+    PlanMemory(const Target &t) : target(t) {}
+
+    Stmt plan_level(const Stmt &s) {
+        LinearizeLevel level;
+        level.linearize(s);
+        vector<ArenaAllocation> &candidates = level.candidates;
+        if (candidates.size() < 2) {
+            return s;
+        }
+        level.find_live_ranges();
+
+        // Assign the allocations to slots of the arena in the order
+        // they become live, reusing the first slot whose allocations
+        // are all dead. This uses as few slots as possible.
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const ArenaAllocation &a, const ArenaAllocation &b) {
+                             return a.first_use < b.first_use;
+                         });
+        struct Slot {
+            Expr size;
+            int last_use;
+        };
+        vector<Slot> slots;
+        vector<int> slot_of(candidates.size());
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const ArenaAllocation &c = candidates[i];
+            size_t j = 0;
+            while (j < slots.size() && slots[j].last_use >= c.first_use) {
+                j++;
+            }
+            if (j == slots.size()) {
+                slots.push_back({c.size, c.last_use});
+            } else {
+                slots[j].size = max(slots[j].size, c.size);
+                slots[j].last_use = c.last_use;
+            }
+            slot_of[i] = (int)j;
+        }
+
+        string arena = unique_name("arena");
+        debug(3) << "Placing " << candidates.size() << " allocations in "
+                 << slots.size() << " slots of " << arena << "\n";
+
+        // The slots are laid out one after the other.
+        vector<pair<string, Expr>> offsets;
+        Expr total = make_zero(Int(64));
+        for (size_t j = 0; j < slots.size(); j++) {
+            string offset_name = arena + ".offset." + std::to_string(j);
+            offsets.push_back({offset_name, total});
+            Expr slot_size = ((slots[j].size + arena_alignment - 1) / arena_alignment) * arena_alignment;
+            total = Variable::make(Int(64), offset_name) + simplify(slot_size);
+        }
+
+        Expr base = reinterpret(UInt(64), Variable::make(Handle(), arena));
+        map<const Allocate *, Expr> placement;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            Expr offset = Variable::make(Int(64), offsets[slot_of[i]].first);
+            placement[candidates[i].op] = reinterpret(Handle(), base + cast<uint64_t>(offset));
+        }
+
+        auto make_arena = [&](const Stmt &body) {
+            string total_name = arena + ".size";
+            Expr total_var = Variable::make(Int(64), total_name);
+            // The arena is allocated in units of arena_alignment bytes,
+            // so its extents fit in 32 bits.
+            Stmt stmt = Allocate::make(arena, UInt(8), MemoryType::Heap,
+                                       {arena_alignment, cast<int32_t>(total_var / arena_alignment)},
+                                       const_true(), body);
+
+            int64_t max_size = std::min(target.maximum_buffer_size(),
+                                        (int64_t)0x7fffffff * arena_alignment);
+            Expr max_size_expr = make_const(UInt(64), max_size);
+            Expr error = Call::make(Int(32), "halide_error_buffer_allocation_too_large",
+                                    {arena, cast<uint64_t>(total_var), max_size_expr}, Call::Extern);
+            stmt = Block::make(AssertStmt::make(cast<uint64_t>(total_var) <= max_size_expr, error), stmt);
+
+            stmt = LetStmt::make(total_name, total, stmt);
+            for (size_t j = offsets.size(); j > 0; j--) {
+                stmt = LetStmt::make(offsets[j - 1].first, offsets[j - 1].second, stmt);
+            }
+            return stmt;
+        };
+        return PlaceInArena(placement, make_arena).insert_arena(s);
+    }
+};
+
+}  // namespace
+
+Stmt plan_memory(const Stmt &s, const Target &t) {
+    PlanMemory planner(t);
+    return planner.plan_level(planner.mutate(s));
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,28 @@
+#ifndef HALIDE_MEMORY_PLANNING_H
+#define HALIDE_MEMORY_PLANNING_H
+
+/** \file
+ * Defines the lowering pass that packs heap allocations with disjoint
+ * lifetimes into a shared arena.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find the heap allocations made at the same loop level (i.e. not
+ * separated by a For or IfThenElse), work out over which statements
+ * of that level each of them is live, and place the ones whose
+ * lifetimes don't overlap at the same offset of a single arena that
+ * is allocated once per execution of the level. This replaces a
+ * malloc/free pair per allocation with one per level, and reduces
+ * the peak memory of pipelines with many intermediate stages. Only
+ * host code is rewritten. */
+Stmt plan_memory(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
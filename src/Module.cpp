@@ -4,6 +4,7 @@
 #include <fstream>
 #include <future>
 
+#include "AddBatchWrapper.h"
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
 #include "Debug.h"
@@ -521,8 +522,9 @@ void compile_multitarget(const std::string &fn_name,
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
         // Some features must match across all targets.
-        static const std::array<Target::Feature, 8> must_match_features = {{
+        static const std::array<Target::Feature, 9> must_match_features = {{
             Target::ASAN,
+            Target::Batch,
             Target::CPlusPlusMangling,
             Target::JIT,
             Target::Matlab,
@@ -549,10 +551,12 @@ void compile_multitarget(const std::string &fn_name,
         std::string sub_fn_name = needs_wrapper ? (fn_name + suffix) : fn_name;
 
         // We always produce the runtime separately, so add NoRuntime explicitly.
-        // Matlab should be added to the wrapper pipeline below, instead of each sub-pipeline.
+        // Matlab and Batch should be added to the wrapper pipeline below, instead of each sub-pipeline.
         Target sub_fn_target = target.with_feature(Target::NoRuntime);
         if (needs_wrapper) {
-            sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
+            sub_fn_target = sub_fn_target
+                .without_feature(Target::Matlab)
+                .without_feature(Target::Batch);
         }
 
         Module sub_module = module_producer(sub_fn_name, sub_fn_target);
@@ -648,6 +652,8 @@ void compile_multitarget(const std::string &fn_name,
 
         // Add a wrapper to accept old buffer_ts
         add_legacy_wrapper(wrapper_module, wrapper_module.functions().back());
+        // And one that runs it over a batch, if requested
+        add_batch_wrapper(wrapper_module, wrapper_module.functions().front());
 
         Outputs wrapper_out = Outputs().object(
             temp_dir.add_temp_object_file(output_files.static_library_name, "_wrapper", base_target, /* in_front*/ true));
@@ -660,6 +666,7 @@ void compile_multitarget(const std::string &fn_name,
         header_module.append(LoweredFunc(fn_name, base_target_args, {}, LinkageType::ExternalPlusMetadata));
         // Add a wrapper to accept old buffer_ts
         add_legacy_wrapper(header_module, header_module.functions().back());
+        add_batch_wrapper(header_module, header_module.functions().front());
         Outputs header_out = Outputs().c_header(output_files.c_header_name);
         debug(1) << "compile_multitarget: c_header_name " << header_out.c_header_name << "\n";
         header_module.compile(header_out);
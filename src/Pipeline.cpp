@@ -827,6 +827,15 @@ Pipeline::make_externs_jit_module(const Target &target,
     return result;
 }
 
+Target Pipeline::default_jit_target() const {
+    // If we've already jit-compiled for a specific target, use that.
+    if (contents->jit_module.compiled()) {
+        return contents->jit_target;
+    }
+    // Otherwise get the target from the environment
+    return get_jit_target_from_environment();
+}
+
 void Pipeline::realize(RealizationArg outputs, const Target &t,
                        const ParamMap &param_map) {
     Target target = t;
@@ -854,13 +863,7 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
 
     // If target is unspecified...
     if (target.os == Target::OSUnknown) {
-        // If we've already jit-compiled for a specific target, use that.
-        if (contents->jit_module.compiled()) {
-            target = contents->jit_target;
-        } else {
-            // Otherwise get the target from the environment
-            target = get_jit_target_from_environment();
-        }
+        target = default_jit_target();
     }
 
     // We need to make a context for calling the jitted function to
@@ -254,6 +254,11 @@ public:
      */
      void *compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** The Target that realize() uses when it isn't given one: the
+     * Target the pipeline has already been jit-compiled for, if any, or
+     * else the one returned from Halide::get_jit_target_from_environment() */
+    Target default_jit_target() const;
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
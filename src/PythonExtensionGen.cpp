@@ -79,45 +79,50 @@ std::pair<string, string> print_type(const LoweredArgument* arg) {
     // Excluded by can_convert() above:
     assert(!arg->type.is_vector());
 
+    // Returns the function (emitted by PythonExtensionGen::compile()) that
+    // converts the PyObject* to the argument, if any, and the type of the
+    // argument.
     if (arg->type.is_handle()) {
         /* Handles can be any pointer. However, from Python, all you can pass to
          * a function is a PyObject*, so we can restrict to that. */
-        return std::make_pair("O", "PyObject*");
+        return std::make_pair("", "PyObject*");
     } else if (arg->is_buffer()) {
-        return std::make_pair("O", "PyObject*");
+        return std::make_pair("", "PyObject*");
     } else if (arg->type.is_float() && arg->type.bits() == 32) {
-        return std::make_pair("f", "float");
+        return std::make_pair("_convert_float", "float");
     } else if (arg->type.is_float() && arg->type.bits() == 64) {
-        return std::make_pair("d", "double");
+        return std::make_pair("_convert_double", "double");
     } else if (arg->type.bits() == 1) {
-        // "b" expects an unsigned char, so we assume that bool == uint8.
-        return std::make_pair("b", "bool");
+        return std::make_pair("_convert_bool", "bool");
     } else if (arg->type.is_int() && arg->type.bits() == 64) {
-        return std::make_pair("L", "long long");
+        return std::make_pair("_convert_long_long", "long long");
     } else if (arg->type.is_uint() && arg->type.bits() == 64) {
-        return std::make_pair("K", "unsigned long long");
+        return std::make_pair("_convert_unsigned_long_long", "unsigned long long");
     } else if (arg->type.is_int()) {
-        return std::make_pair("i", "int");
+        return std::make_pair("_convert_int", "int");
     } else if (arg->type.is_uint()) {
-        return std::make_pair("I", "unsigned int");
+        return std::make_pair("_convert_unsigned_int", "unsigned int");
     } else {
-        return std::make_pair("E", "unknown type");
+        return std::make_pair("", "unknown type");
     }
 }
 
-void PythonExtensionGen::convert_buffer(string name, const LoweredArgument* arg) {
+void PythonExtensionGen::convert_buffer(string name, const LoweredArgument* arg, int index, int buffer_index) {
     assert(arg->is_buffer());
     assert(arg->dimensions);
     dest << "    halide_buffer_t buffer_" << name << ";\n";
     dest << "    halide_dimension_t dimensions_" << name << "[" << (int)arg->dimensions << "];\n";
     dest << "    if (_convert_py_buffer_to_halide(";
-    dest << /*pyobj*/ "py_" << name << ", ";
+    dest << /*pyobj*/ "py_args[" << index << "], ";
     dest << /*dimensions*/ (int)arg->dimensions << ", ";
     dest << /*flags*/ (arg->is_output() ? "PyBUF_WRITABLE" : "0") << ", ";
+    dest << /*view*/ "&views[" << buffer_index << "], ";
     dest << /*dim*/ "dimensions_" << name << ", ";
     dest << /*out*/ "&buffer_" << name << ", ";
     dest << /*name*/ "\"" << name << "\"";
     dest << ") < 0) {\n";
+    // Release the views of the buffers converted so far.
+    dest << "        _release_py_buffers(views, " << buffer_index << ");\n";
     dest << "        return NULL;\n";
     dest << "    }\n";
 }
@@ -141,23 +146,38 @@ void PythonExtensionGen::compile(const Module &module) {
 #    define HALIDE_PYTHON_EXPORT __attribute__((visibility("default")))
 #endif
 
+/* Python 3.7 and later can pass us the arguments as a C array, rather
+ * than as a tuple and a dict. */
+#if PY_VERSION_HEX >= 0x03070000
+#    define HALIDE_PYTHON_FASTCALL 1
+#    define HALIDE_PYTHON_METHOD_FLAGS (METH_FASTCALL|METH_KEYWORDS)
+#else
+#    define HALIDE_PYTHON_FASTCALL 0
+#    define HALIDE_PYTHON_METHOD_FLAGS (METH_VARARGS|METH_KEYWORDS)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* On success, the caller must release the view with PyBuffer_Release() once
+ * it's done with the halide_buffer_t, and not before: holding the view is
+ * what stops the owner of the memory (e.g. an ndarray that gets resized)
+ * from freeing it while the pipeline runs without the GIL. */
 static __attribute__((unused)) int _convert_py_buffer_to_halide(
         PyObject* pyobj, int dimensions, int flags,
+        Py_buffer* buf,
         halide_dimension_t* dim,  // array of size `dimensions`
         halide_buffer_t* out, const char* name) {
-    Py_buffer buf;
     int ret = PyObject_GetBuffer(
-      pyobj, &buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | PyBUF_ANY_CONTIGUOUS | flags);
+      pyobj, buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | PyBUF_ANY_CONTIGUOUS | flags);
     if (ret < 0) {
       return ret;
     }
-    if (dimensions && buf.ndim != dimensions) {
+    if (dimensions && buf->ndim != dimensions) {
       PyErr_Format(PyExc_ValueError, "Invalid argument %s: Expected %d dimensions, got %d",
-                   name, dimensions, buf.ndim);
+                   name, dimensions, buf->ndim);
+      PyBuffer_Release(buf);
       return -1;
     }
     /* We'll get a buffer that's either:
@@ -169,43 +189,46 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
      * (transpose) so we can process it without having to reallocate.
      */
     int i, j, j_step;
-    if (PyBuffer_IsContiguous(&buf, 'F')) {
+    if (PyBuffer_IsContiguous(buf, 'F')) {
       j = 0;
       j_step = 1;
-    } else if (PyBuffer_IsContiguous(&buf, 'C')) {
-      j = buf.ndim - 1;
+    } else if (PyBuffer_IsContiguous(buf, 'C')) {
+      j = buf->ndim - 1;
       j_step = -1;
     } else {
       /* Python checks all dimensions and strides, so this typically indicates
        * a bug in the array's buffer protocol. */
       PyErr_Format(PyExc_ValueError, "Invalid buffer: neither C nor Fortran contiguous");
+      PyBuffer_Release(buf);
       return -1;
     }
-    for (i = 0; i < buf.ndim; ++i, j += j_step) {
+    for (i = 0; i < buf->ndim; ++i, j += j_step) {
         dim[i].min = 0;
-        dim[i].stride = (int)(buf.strides[j] / buf.itemsize); // strides is in bytes
-        dim[i].extent = (int)buf.shape[j];
+        dim[i].stride = (int)(buf->strides[j] / buf->itemsize); // strides is in bytes
+        dim[i].extent = (int)buf->shape[j];
         dim[i].flags = 0;
-        if (buf.suboffsets && buf.suboffsets[i] >= 0) {
+        if (buf->suboffsets && buf->suboffsets[i] >= 0) {
             // Halide doesn't support arrays of pointers. But we should never see this
             // anyway, since we specified PyBUF_STRIDED.
             PyErr_Format(PyExc_ValueError, "Invalid buffer: suboffsets not supported");
+            PyBuffer_Release(buf);
             return -1;
         }
     }
-    if (dim[buf.ndim - 1].extent * dim[buf.ndim - 1].stride * buf.itemsize != buf.len) {
+    if (dim[buf->ndim - 1].extent * dim[buf->ndim - 1].stride * buf->itemsize != buf->len) {
         PyErr_Format(PyExc_ValueError, "Invalid buffer: length %ld, but computed length %ld",
-                     buf.len, buf.shape[0] * buf.strides[0]);
+                     buf->len, buf->shape[0] * buf->strides[0]);
+        PyBuffer_Release(buf);
         return -1;
     }
     memset(out, 0, sizeof(*out));
-    if (!buf.format) {
+    if (!buf->format) {
         out->type.code = halide_type_uint;
         out->type.bits = 8;
     } else {
         /* Convert struct type code. See
          * https://docs.python.org/2/library/struct.html#module-struct */
-        char* p = buf.format;
+        char* p = buf->format;
         while (strchr("@<>!=", *p)) {
             p++;  // ignore little/bit endian (and alignment)
         }
@@ -221,19 +244,180 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
         }
         const char* type_codes = "bB?hHiIlLqQfd";  // integers and floats
         if (strchr(type_codes, *p)) {
-            out->type.bits = buf.itemsize * 8;
+            out->type.bits = buf->itemsize * 8;
         } else {
             // We don't handle 's' and 'p' (char[]) and 'P' (void*)
-            PyErr_Format(PyExc_ValueError, "Invalid data type for %s: %s", name, buf.format);
+            PyErr_Format(PyExc_ValueError, "Invalid data type for %s: %s", name, buf->format);
+            PyBuffer_Release(buf);
             return -1;
         }
     }
     out->type.lanes = 1;
-    out->dimensions = buf.ndim;
+    out->dimensions = buf->ndim;
     out->dim = dim;
-    out->host = (uint8_t*)buf.buf;
+    out->host = (uint8_t*)buf->buf;
+    return 0;
+}
+
+static __attribute__((unused)) void _release_py_buffers(Py_buffer* views, int count) {
+    int i;
+    for (i = count - 1; i >= 0; i--) {
+        PyBuffer_Release(&views[i]);
+    }
+}
+
+/* Conversions of the scalar arguments. These accept the same values as
+ * the corresponding PyArg_ParseTuple() format codes. */
+static __attribute__((unused)) int _convert_long(PyObject* pyobj, long min, long max, long* out) {
+    if (PyFloat_Check(pyobj)) {
+        PyErr_SetString(PyExc_TypeError, "integer argument expected, got float");
+        return -1;
+    }
+    long value = PyLong_AsLong(pyobj);
+    if (value == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (value < min || value > max) {
+        PyErr_Format(PyExc_OverflowError, "integer %ld is out of range [%ld, %ld]", value, min, max);
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_bool(PyObject* pyobj, bool* out) {  // "b"
+    long value;
+    if (_convert_long(pyobj, 0, UCHAR_MAX, &value) < 0) {
+        return -1;
+    }
+    *out = value != 0;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_int(PyObject* pyobj, int* out) {  // "i"
+    long value;
+    if (_convert_long(pyobj, INT_MIN, INT_MAX, &value) < 0) {
+        return -1;
+    }
+    *out = (int)value;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_unsigned_int(PyObject* pyobj, unsigned int* out) {  // "I"
+    if (PyFloat_Check(pyobj)) {
+        PyErr_SetString(PyExc_TypeError, "integer argument expected, got float");
+        return -1;
+    }
+    unsigned long value = PyLong_AsUnsignedLongMask(pyobj);
+    if (value == (unsigned long)-1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = (unsigned int)value;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_long_long(PyObject* pyobj, long long* out) {  // "L"
+    if (PyFloat_Check(pyobj)) {
+        PyErr_SetString(PyExc_TypeError, "integer argument expected, got float");
+        return -1;
+    }
+    long long value = PyLong_AsLongLong(pyobj);
+    if (value == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_unsigned_long_long(PyObject* pyobj, unsigned long long* out) {  // "K"
+    if (PyFloat_Check(pyobj)) {
+        PyErr_SetString(PyExc_TypeError, "integer argument expected, got float");
+        return -1;
+    }
+    unsigned long long value = PyLong_AsUnsignedLongLongMask(pyobj);
+    if (value == (unsigned long long)-1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_float(PyObject* pyobj, float* out) {  // "f"
+    double value = PyFloat_AsDouble(pyobj);
+    if (value == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = (float)value;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_double(PyObject* pyobj, double* out) {  // "d"
+    double value = PyFloat_AsDouble(pyobj);
+    if (value == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+#if HALIDE_PYTHON_FASTCALL
+/* Gather the positional and keyword arguments of a METH_FASTCALL call
+ * into `out`, in the order of the parameters in `kwlist`. The parameter
+ * names are interned on the first call and kept in `kwlist_cache`, so
+ * matching a keyword argument is usually just a pointer comparison. */
+static __attribute__((unused)) int _collect_fastcall_args(
+        PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames,
+        const char* const* kwlist, PyObject** kwlist_cache, Py_ssize_t n,
+        PyObject** out, const char* fname) {
+    Py_ssize_t i, j;
+    const Py_ssize_t nkw = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    if (nargs > n) {
+        PyErr_Format(PyExc_TypeError, "%s() takes at most %zd arguments (%zd given)",
+                     fname, n, nargs + nkw);
+        return -1;
+    }
+    if (!kwlist_cache[0]) {
+        // Fill in the first entry last, so we retry if we fail partway.
+        for (i = n - 1; i >= 0; i--) {
+            kwlist_cache[i] = PyUnicode_InternFromString(kwlist[i]);
+            if (!kwlist_cache[i]) {
+                return -1;
+            }
+        }
+    }
+    for (i = 0; i < n; i++) {
+        out[i] = i < nargs ? args[i] : NULL;
+    }
+    for (j = 0; j < nkw; j++) {
+        PyObject* key = PyTuple_GET_ITEM(kwnames, j);
+        for (i = 0; i < n && key != kwlist_cache[i]; i++) {
+        }
+        if (i == n) {
+            // Not interned; fall back to comparing the strings.
+            for (i = 0; i < n && PyUnicode_Compare(key, kwlist_cache[i]) != 0; i++) {
+            }
+        }
+        if (i == n) {
+            PyErr_Format(PyExc_TypeError, "'%U' is an invalid keyword argument for %s()", key, fname);
+            return -1;
+        }
+        if (out[i]) {
+            PyErr_Format(PyExc_TypeError, "Argument given by name ('%s') and position (%zd)",
+                         kwlist[i], i + 1);
+            return -1;
+        }
+        out[i] = args[nargs + j];
+    }
+    for (i = 0; i < n; i++) {
+        if (!out[i]) {
+            PyErr_Format(PyExc_TypeError, "Required argument '%s' (pos %zd) not found",
+                         kwlist[i], i + 1);
+            return -1;
+        }
+    }
     return 0;
 }
+#endif
 
 )INLINE_CODE";
 
@@ -251,7 +435,7 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
         if (!has_legacy_buffers(f)) {
             const string basename = remove_namespaces(f.name);
             dest << "    {\"" << basename << "\", (PyCFunction)_f_" << basename
-                 << ", METH_VARARGS|METH_KEYWORDS, NULL},\n";
+                 << ", HALIDE_PYTHON_METHOD_FLAGS, NULL},\n";
         }
     }
     dest << "    {0, 0, 0, NULL},  // sentinel\n";
@@ -289,10 +473,53 @@ void PythonExtensionGen::compile(const LoweredFunc &f) {
     const std::vector<LoweredArgument> &args = f.args;
     const string basename = remove_namespaces(f.name);
     std::vector<string> arg_names(args.size());
+    for (size_t i = 0; i < args.size(); i++) {
+        arg_names[i] = sanitize_name(args[i].name);
+    }
+
+    // The entry points only gather the arguments into an array; the
+    // conversions and the call happen in _call_<basename>.
     dest << "// " << f.name << "\n";
+    dest << "static PyObject* _call_" << basename << "(PyObject* const* py_args) {\n";
+    compile_call(f, arg_names);
+    dest << "}\n\n";
+
+    dest << "static const char* _kwlist_" << basename << "[] = {";
+    for (size_t i = 0; i < args.size(); i++) {
+        dest << "\"" << arg_names[i] << "\", ";
+    }
+    dest << "NULL};\n\n";
+
+    dest << "#if HALIDE_PYTHON_FASTCALL\n";
+    dest << "static PyObject* _f_" << basename
+         << "(PyObject* module, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {\n";
+    dest << "    static PyObject* kwlist_cache[" << args.size() << "];\n";
+    dest << "    PyObject* py_args[" << args.size() << "];\n";
+    dest << "    if (_collect_fastcall_args(args, nargs, kwnames, _kwlist_" << basename
+         << ", kwlist_cache, " << args.size() << ", py_args, \"" << basename << "\") < 0) {\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    dest << "    return _call_" << basename << "(py_args);\n";
+    dest << "}\n";
+    dest << "#else\n";
     dest << "static PyObject* _f_" << basename << "(PyObject* module, PyObject* args, PyObject* kwargs) {\n";
+    dest << "    PyObject* py_args[" << args.size() << "];\n";
+    dest << "    if (!PyArg_ParseTupleAndKeywords(args, kwargs, \"" << string(args.size(), 'O')
+         << "\", (char**)_kwlist_" << basename;
+    for (size_t i = 0; i < args.size(); i++) {
+        dest << ", &py_args[" << i << "]";
+    }
+    dest << ")) {\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    dest << "    return _call_" << basename << "(py_args);\n";
+    dest << "}\n";
+    dest << "#endif\n";
+}
+
+void PythonExtensionGen::compile_call(const LoweredFunc &f, const std::vector<string> &arg_names) {
+    const std::vector<LoweredArgument> &args = f.args;
     for (size_t i = 0; i < args.size(); i++) {
-        arg_names[i] = sanitize_name(args[i].name);
         if (!can_convert(&args[i])) {
             /* Some arguments can't be converted to Python yet. In those
              * cases, just add a dummy function that always throws an
@@ -301,38 +528,42 @@ void PythonExtensionGen::compile(const LoweredFunc &f) {
             dest << "    PyErr_Format(PyExc_NotImplementedError, "
                  << "\"Can't convert argument " << args[i].name << " from Python\");\n";
             dest << "    return NULL;\n";
-            dest << "}";
             return;
         }
     }
-    dest << "    static const char* kwlist[] = {";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << "\"" << arg_names[i] << "\", ";
-    }
-    dest << "NULL};\n";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << "    " << print_type(&args[i]).second << " py_" << arg_names[i] << ";\n";
-    }
-    dest << "    if (!PyArg_ParseTupleAndKeywords(args, kwargs, \"";
+    bool has_user_context = false;
+    int buffer_count = 0;
     for (size_t i = 0; i < args.size(); i++) {
-        dest << print_type(&args[i]).first;
+        const string converter = print_type(&args[i]).first;
+        if (args[i].is_buffer()) {
+            buffer_count++;
+        } else if (converter.empty()) {
+            // A PyObject* passed as the user context.
+            has_user_context = true;
+            dest << "    PyObject* py_" << arg_names[i] << " = py_args[" << i << "];\n";
+        } else {
+            dest << "    " << print_type(&args[i]).second << " py_" << arg_names[i] << ";\n";
+            dest << "    if (" << converter << "(py_args[" << i << "], &py_" << arg_names[i] << ") < 0) {\n";
+            dest << "        return NULL;\n";
+            dest << "    }\n";
+        }
     }
-    dest << "\", (char**)kwlist";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << ", ";
-        dest << "&py_" << arg_names[i];
+    if (buffer_count > 0) {
+        dest << "    Py_buffer views[" << buffer_count << "];\n";
     }
-    dest << ")) {\n";
-    dest << "        return NULL;\n";
-    dest << "    }\n";
-    for (size_t i = 0; i < args.size(); i++) {
+    for (size_t i = 0, b = 0; i < args.size(); i++) {
         if (args[i].is_buffer()) {
-            convert_buffer(arg_names[i], &args[i]);
-        } else {
-            // Python already converted this.
+            convert_buffer(arg_names[i], &args[i], (int)i, (int)b++);
         }
     }
-    dest << "    int result = " << f.name << "(";
+    dest << "    int result;\n";
+    // The pipeline doesn't touch any Python objects, so let other threads
+    // run while it does, unless it's been given a user context: that's a
+    // PyObject* that handlers overridden in the runtime may use.
+    if (!has_user_context) {
+        dest << "    Py_BEGIN_ALLOW_THREADS\n";
+    }
+    dest << "    result = " << f.name << "(";
     for (size_t i = 0; i < args.size(); i++) {
         if (i > 0) {
             dest << ", ";
@@ -343,9 +574,14 @@ void PythonExtensionGen::compile(const LoweredFunc &f) {
             dest << "py_" << arg_names[i];
         }
     }
-    dest << ");";
-    dest << R"INLINE_CODE(
-    if (result != 0) {
+    dest << ");\n";
+    if (!has_user_context) {
+        dest << "    Py_END_ALLOW_THREADS\n";
+    }
+    if (buffer_count > 0) {
+        dest << "    _release_py_buffers(views, " << buffer_count << ");\n";
+    }
+    dest << R"INLINE_CODE(    if (result != 0) {
         /* In the optimal case, we'd be generating an exception declared
          * in python_bindings/src, but since we're self-contained,
          * we don't have access to that API. */
@@ -355,7 +591,6 @@ void PythonExtensionGen::compile(const LoweredFunc &f) {
     Py_INCREF(Py_True);
     return Py_True;
 )INLINE_CODE";
-    dest << "}\n";
 }
 
 }
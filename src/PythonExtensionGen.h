@@ -19,7 +19,8 @@ public:
     void compile(const Module &module);
     void compile(const LoweredFunc &f);
 private:
-    void convert_buffer(std::string name, const LoweredArgument* arg);
+    void compile_call(const LoweredFunc &f, const std::vector<std::string> &arg_names);
+    void convert_buffer(std::string name, const LoweredArgument* arg, int index, int buffer_index);
     std::ostream &dest;
     std::string header_name;
     Target target;
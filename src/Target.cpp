@@ -270,6 +270,8 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"tsan", Target::TSAN},
     {"asan", Target::ASAN},
     {"check_unsafe_promises", Target::CheckUnsafePromises},
+    {"plan_memory", Target::PlanMemory},
+    {"batch", Target::Batch},
     // NOTE: When adding features to this map, be sure to update
     // PyEnums.cpp and halide.cmake as well.
 };
@@ -1161,6 +1161,133 @@ public:
         return *this;
     }
 
+private:
+    /** Helpers for copy_from. */
+    // @{
+    struct copy_task_dim {
+        int extent;
+        int64_t dst_stride, src_stride;  // In bytes.
+    };
+
+    // Copies below this size are always done on the calling thread,
+    // and larger copies are split into tasks of roughly this size.
+    static constexpr int64_t parallel_copy_task_bytes = 256 * 1024;
+
+    struct copy_closure {
+        const copy_task_dim *t;
+        int dims;
+        int64_t row_bytes;
+        uint8_t *dst;
+        const uint8_t *src;
+    };
+
+    // Copy the dense rows described by t[0] (which is not iterated
+    // over) for all sites in dimensions 1 through d.
+    static void copy_rows(int d, const copy_task_dim *t, int64_t row_bytes,
+                          uint8_t *dst, const uint8_t *src) {
+        if (d == 0) {
+            memcpy(dst, src, row_bytes);
+        } else {
+            for (int i = t[d].extent; i != 0; i--) {
+                copy_rows(d - 1, t, row_bytes, dst, src);
+                dst += t[d].dst_stride;
+                src += t[d].src_stride;
+            }
+        }
+    }
+
+    static int copy_task(void *user_context, int idx, uint8_t *closure) {
+        const copy_closure *c = (const copy_closure *)closure;
+        if (c->dims == 1) {
+            // A single dense run. Each task does one chunk of it.
+            const int64_t chunk = parallel_copy_task_bytes;
+            int64_t begin = (int64_t)idx * chunk;
+            int64_t size = std::min(chunk, c->row_bytes - begin);
+            memcpy(c->dst + begin, c->src + begin, size);
+        } else {
+            // Each task does one slice of the outermost dimension.
+            const copy_task_dim &outer = c->t[c->dims - 1];
+            copy_rows(c->dims - 2, c->t, c->row_bytes,
+                      c->dst + idx * outer.dst_stride,
+                      c->src + idx * outer.src_stride);
+        }
+        return 0;
+    }
+
+    /** Try to do the copy as a series of memcpy calls over maximally
+     * large dense rows. Returns false if the innermost dimension is
+     * not dense in both buffers, in which case the caller must fall
+     * back to an element-wise copy. The two buffers must already have
+     * been cropped to the same shape. */
+    static bool copy_with_memcpy(const Buffer<T, D> &dst, const Buffer<const T, D> &src,
+                                 halide_do_par_for_t do_par_for) {
+        const int elem_size = dst.type().bytes();
+        copy_task_dim *t =
+            (copy_task_dim *)HALIDE_ALLOCA((dst.dimensions() + 1) * sizeof(copy_task_dim));
+
+        // Gather the dimensions with non-trivial extent, ordered by
+        // the stride of the destination.
+        int d = 0;
+        for (int i = 0; i < dst.dimensions(); i++) {
+            if (dst.dim(i).extent() == 1) continue;
+            t[d].extent = dst.dim(i).extent();
+            t[d].dst_stride = (int64_t)dst.dim(i).stride() * elem_size;
+            t[d].src_stride = (int64_t)src.dim(i).stride() * elem_size;
+            for (int j = d; j > 0 && t[j].dst_stride < t[j-1].dst_stride; j--) {
+                std::swap(t[j], t[j-1]);
+            }
+            d++;
+        }
+
+        if (d == 0) {
+            // A single element.
+            t[0].extent = 1;
+            t[0].dst_stride = t[0].src_stride = elem_size;
+            d = 1;
+        }
+
+        if (t[0].dst_stride != elem_size || t[0].src_stride != elem_size) {
+            return false;
+        }
+
+        // Fuse dimensions that are contiguous in both buffers into
+        // the rows.
+        int64_t row_bytes = (int64_t)t[0].extent * elem_size;
+        while (d > 1 &&
+               t[1].dst_stride == row_bytes &&
+               t[1].src_stride == row_bytes) {
+            row_bytes *= t[1].extent;
+            for (int j = 1; j < d - 1; j++) {
+                t[j] = t[j+1];
+            }
+            d--;
+        }
+
+        uint8_t *dst_ptr = (uint8_t *)dst.begin();
+        const uint8_t *src_ptr = (const uint8_t *)src.begin();
+        int64_t total_bytes = row_bytes;
+        for (int i = 1; i < d; i++) {
+            total_bytes *= t[i].extent;
+        }
+
+        int tasks = 1;
+        if (do_par_for && total_bytes >= 2 * parallel_copy_task_bytes) {
+            tasks = (d == 1) ?
+                (int)((row_bytes + parallel_copy_task_bytes - 1) / parallel_copy_task_bytes) :
+                t[d - 1].extent;
+        }
+
+        if (tasks > 1) {
+            copy_closure c = {t, d, row_bytes, dst_ptr, src_ptr};
+            do_par_for(nullptr, copy_task, 0, tasks, (uint8_t *)&c);
+        } else {
+            copy_rows(d - 1, t, row_bytes, dst_ptr, src_ptr);
+        }
+        return true;
+    }
+    // @}
+
+public:
     /** Fill a Buffer with the values at the same coordinates in
      * another Buffer. Restricts itself to coordinates contained
      * within the intersection of the two buffers. If the two Buffers
@@ -1169,9 +1296,16 @@ public:
      * sprite onto a framebuffer, you'll want to translate the sprite
      * to the correct location first like so: \code
      * framebuffer.copy_from(sprite.translated({x, y})); \endcode
+     *
+     * Dimensions that are dense in both buffers are fused, so that
+     * copies between buffers with the same memory layout reduce to a
+     * few large memcpy calls. If a do_par_for is supplied (e.g. the
+     * Halide runtime's halide_do_par_for), the copy is split into
+     * tasks and run through it. It is not called by default, so
+     * that this class does not depend on the Halide runtime.
     */
     template<typename T2, int D2>
-    void copy_from(const Buffer<T2, D2> &other) {
+    void copy_from(const Buffer<T2, D2> &other, halide_do_par_for_t do_par_for = nullptr) {
         static_assert(!std::is_const<T>::value, "Cannot call copy_from() on a Buffer<const T>");
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!other.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
@@ -1193,6 +1327,16 @@ public:
             src.crop(i, min_coord, max_coord - min_coord + 1);
         }
 
+        if (copy_with_memcpy(dst, src, do_par_for)) {
+            set_host_dirty();
+            return;
+        }
+
+        // Small element-wise copies aren't worth splitting into tasks.
+        if ((int64_t)dst.number_of_elements() * type().bytes() < 2 * parallel_copy_task_bytes) {
+            do_par_for = nullptr;
+        }
+
         // If T is void, we need to do runtime dispatch to an
         // appropriately-typed lambda. We're copying, so we only care
         // about the element size.
@@ -1200,22 +1344,22 @@ public:
             using MemType = uint8_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            typed_dst.par_for_each_value(do_par_for, [&](MemType &dst, MemType src) {dst = src;}, typed_src);
         } else if (type().bytes() == 2) {
             using MemType = uint16_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            typed_dst.par_for_each_value(do_par_for, [&](MemType &dst, MemType src) {dst = src;}, typed_src);
         } else if (type().bytes() == 4) {
             using MemType = uint32_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            typed_dst.par_for_each_value(do_par_for, [&](MemType &dst, MemType src) {dst = src;}, typed_src);
         } else if (type().bytes() == 8) {
             using MemType = uint64_t;
             auto &typed_dst = (Buffer<MemType, D> &)dst;
             auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            typed_dst.par_for_each_value(do_par_for, [&](MemType &dst, MemType src) {dst = src;}, typed_src);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
@@ -1882,6 +2026,16 @@ private:
 
     static void advance_ptrs(const int *) {}
 
+    // Same as the above, but with 64-bit offsets, which may be larger
+    // than any one stride.
+    template<typename Ptr, typename ...Ptrs>
+    static void advance_ptrs(const int64_t *offset, Ptr *ptr, Ptrs... ptrs) {
+        (*ptr) += *offset;
+        advance_ptrs(offset + 1, ptrs...);
+    }
+
+    static void advance_ptrs(const int64_t *) {}
+
     // Same as the above, but just increments the pointers.
     template<typename Ptr, typename ...Ptrs>
     static void increment_ptrs(Ptr *ptr, Ptrs... ptrs) {
@@ -1945,7 +2099,7 @@ private:
     }
 
     template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
-    void for_each_value_impl(Fn &&f, Args&&... other_buffers) const {
+    void for_each_value_impl(halide_do_par_for_t do_par_for, Fn &&f, Args&&... other_buffers) const {
         for_each_value_task_dim<N> *t =
             (for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<N>));
         for (int i = 0; i <= dimensions(); i++) {
@@ -1990,12 +2144,74 @@ private:
             }
         }
 
-        if (innermost_strides_are_one) {
-            for_each_value_helper<true>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+        if (do_par_for == nullptr) {
+            if (innermost_strides_are_one) {
+                for_each_value_helper<true>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            } else {
+                for_each_value_helper<false>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            }
         } else {
-            for_each_value_helper<false>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            if (innermost_strides_are_one) {
+                for_each_value_parallel<true>(do_par_for, f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            } else {
+                for_each_value_parallel<false>(do_par_for, f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            }
         }
     }
+
+    // When the outermost dimension to be split into tasks is also the
+    // innermost dimension, each task gets at least this many elements.
+    static constexpr int min_elements_per_parallel_task = 4096;
+
+    // Calls the callable pointed to by closure with the task index.
+    template<typename Body>
+    static int parallel_task(void *user_context, int idx, uint8_t *closure) {
+        (*(Body *)closure)(idx);
+        return 0;
+    }
+
+    // Advance a bunch of pointers by a per-pointer offset, and then
+    // run the loop nest for for_each_value from there.
+    template<bool innermost_strides_are_one, typename Fn, typename... Ptrs>
+    static void for_each_value_helper_at(Fn &&f, int d, const for_each_value_task_dim<sizeof...(Ptrs)> *t,
+                                         const int64_t *offset, Ptrs... ptrs) {
+        advance_ptrs(offset, (&ptrs)...);
+        for_each_value_helper<innermost_strides_are_one>(f, d, t, ptrs...);
+    }
+
+    // Split the outermost non-trivial dimension of the loop nest for
+    // for_each_value into tasks, and run them using do_par_for.
+    template<bool innermost_strides_are_one, typename Fn, typename... Ptrs>
+    static void for_each_value_parallel(halide_do_par_for_t do_par_for, Fn &&f, int d,
+                                        const for_each_value_task_dim<sizeof...(Ptrs)> *t, Ptrs... ptrs) {
+        const int N = sizeof...(Ptrs);
+        while (d > 0 && t[d].extent == 1) {
+            d--;
+        }
+        const int extent = d >= 0 ? t[d].extent : 1;
+        const int chunk = d == 0 ? min_elements_per_parallel_task : 1;
+        const int tasks = (extent + chunk - 1) / chunk;
+        if (tasks < 2) {
+            for_each_value_helper<innermost_strides_are_one>(f, d, t, ptrs...);
+            return;
+        }
+
+        auto body = [&](int idx) {
+            for_each_value_task_dim<N> *task_t =
+                (for_each_value_task_dim<N> *)HALIDE_ALLOCA((d + 1) * sizeof(for_each_value_task_dim<N>));
+            for (int i = 0; i <= d; i++) {
+                task_t[i] = t[i];
+            }
+            int begin = idx * chunk;
+            task_t[d].extent = std::min(chunk, extent - begin);
+            int64_t offset[N];
+            for (int j = 0; j < N; j++) {
+                offset[j] = (int64_t)begin * t[d].stride[j];
+            }
+            for_each_value_helper_at<innermost_strides_are_one>(f, d, task_t, offset, ptrs...);
+        };
+        do_par_for(nullptr, parallel_task<decltype(body)>, 0, tasks, (uint8_t *)&body);
+    }
     // @}
 
 public:
@@ -2017,14 +2233,37 @@ public:
     template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
     HALIDE_ALWAYS_INLINE
     const Buffer<T, D> &for_each_value(Fn &&f, Args&&... other_buffers) const {
-        for_each_value_impl(f, std::forward<Args>(other_buffers)...);
+        for_each_value_impl(nullptr, f, std::forward<Args>(other_buffers)...);
         return *this;
     }
 
     template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
     HALIDE_ALWAYS_INLINE
     Buffer<T, D> &for_each_value(Fn &&f, Args&&... other_buffers) {
-        for_each_value_impl(f, std::forward<Args>(other_buffers)...);
+        for_each_value_impl(nullptr, f, std::forward<Args>(other_buffers)...);
+        return *this;
+    }
+    // @}
+
+    /** A version of for_each_value that splits the outermost
+     * non-trivial dimension of the traversal into tasks and runs them
+     * using the given do_par_for (e.g. the Halide runtime's
+     * halide_do_par_for, or a custom thread pool with the same
+     * signature). The callable may be called concurrently from
+     * several threads, so it must be thread-safe. If do_par_for is
+     * null this is the same as for_each_value. */
+    // @{
+    template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
+    HALIDE_ALWAYS_INLINE
+    const Buffer<T, D> &par_for_each_value(halide_do_par_for_t do_par_for, Fn &&f, Args&&... other_buffers) const {
+        for_each_value_impl(do_par_for, f, std::forward<Args>(other_buffers)...);
+        return *this;
+    }
+
+    template<typename Fn, typename ...Args, int N = sizeof...(Args) + 1>
+    HALIDE_ALWAYS_INLINE
+    Buffer<T, D> &par_for_each_value(halide_do_par_for_t do_par_for, Fn &&f, Args&&... other_buffers) {
+        for_each_value_impl(do_par_for, f, std::forward<Args>(other_buffers)...);
         return *this;
     }
     // @}
@@ -2152,15 +2391,55 @@ private:
         for_each_element_variadic(0, args - 1, t, std::forward<Fn>(f));
     }
 
+    /** The number of dimensions for_each_element loops over for a
+     * given callable. All of them if it takes a position array,
+     * otherwise the number of ints it takes. */
+    template<typename Fn,
+             typename = decltype(std::declval<Fn>()((const int *)nullptr))>
+    static int for_each_element_loop_dims(int, int dims, Fn &&) {
+        return dims;
+    }
+
+    template<typename Fn>
+    static int for_each_element_loop_dims(double, int dims, Fn &&f) {
+        return num_args(0, std::forward<Fn>(f));
+    }
+
     template<typename Fn>
-    void for_each_element_impl(Fn &&f) const {
+    void for_each_element_impl(halide_do_par_for_t do_par_for, Fn &&f) const {
         for_each_element_task_dim *t =
             (for_each_element_task_dim *)HALIDE_ALLOCA(dimensions() * sizeof(for_each_element_task_dim));
         for (int i = 0; i < dimensions(); i++) {
             t[i].min = dim(i).min();
             t[i].max = dim(i).max();
         }
-        for_each_element(0, dimensions(), t, std::forward<Fn>(f));
+
+        // Find the outermost dimension with more than one site that
+        // the callable iterates over.
+        int d = do_par_for ? std::min(dimensions(), for_each_element_loop_dims(0, dimensions(), f)) - 1 : -1;
+        while (d > 0 && t[d].min == t[d].max) {
+            d--;
+        }
+        const int extent = d >= 0 ? t[d].max - t[d].min + 1 : 1;
+        const int chunk = d == 0 ? min_elements_per_parallel_task : 1;
+        const int tasks = (extent + chunk - 1) / chunk;
+        if (tasks < 2) {
+            for_each_element(0, dimensions(), t, std::forward<Fn>(f));
+            return;
+        }
+
+        const int dims = dimensions();
+        auto body = [&](int idx) {
+            for_each_element_task_dim *task_t =
+                (for_each_element_task_dim *)HALIDE_ALLOCA(dims * sizeof(for_each_element_task_dim));
+            for (int i = 0; i < dims; i++) {
+                task_t[i] = t[i];
+            }
+            task_t[d].min = t[d].min + idx * chunk;
+            task_t[d].max = std::min(task_t[d].min + chunk - 1, t[d].max);
+            for_each_element(0, dims, task_t, f);
+        };
+        do_par_for(nullptr, parallel_task<decltype(body)>, 0, tasks, (uint8_t *)&body);
     }
 
 public:
@@ -2224,14 +2503,35 @@ public:
     template<typename Fn>
     HALIDE_ALWAYS_INLINE
     const Buffer<T, D> &for_each_element(Fn &&f) const {
-        for_each_element_impl(f);
+        for_each_element_impl(nullptr, f);
         return *this;
     }
 
     template<typename Fn>
     HALIDE_ALWAYS_INLINE
     Buffer<T, D> &for_each_element(Fn &&f) {
-        for_each_element_impl(f);
+        for_each_element_impl(nullptr, f);
+        return *this;
+    }
+    // @}
+
+    /** A version of for_each_element that splits the outermost
+     * dimension iterated over into tasks and runs them using the
+     * given do_par_for. As with par_for_each_value, the callable must
+     * be safe to call concurrently, and a null do_par_for runs
+     * serially. */
+    // @{
+    template<typename Fn>
+    HALIDE_ALWAYS_INLINE
+    const Buffer<T, D> &par_for_each_element(halide_do_par_for_t do_par_for, Fn &&f) const {
+        for_each_element_impl(do_par_for, f);
+        return *this;
+    }
+
+    template<typename Fn>
+    HALIDE_ALWAYS_INLINE
+    Buffer<T, D> &par_for_each_element(halide_do_par_for_t do_par_for, Fn &&f) {
+        for_each_element_impl(do_par_for, f);
         return *this;
     }
     // @}
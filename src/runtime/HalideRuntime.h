@@ -159,6 +159,17 @@ extern struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closur
 /** Join a thread. */
 extern void halide_join_thread(struct halide_thread *);
 
+/** Set the stack size (in bytes) of the threads spawned by
+ * halide_spawn_thread from now on, including the workers of Halide's
+ * thread pool. Returns the old size. Zero means the system default,
+ * which is used unless the environment variable HL_THREAD_STACK_SIZE
+ * is set. The thread pool creates its workers the first time it is
+ * used, so call this before running any parallel pipelines, or call
+ * halide_shutdown_thread_pool() first. Pipelines compiled with a large
+ * stack budget (HL_STACK_BUDGET) may need larger stacks than the
+ * system default on some platforms. */
+extern size_t halide_set_thread_stack_size(size_t size);
+
 /** Set the number of threads used by Halide's thread pool. Returns
  * the old number.
  *
@@ -1138,7 +1149,9 @@ typedef enum halide_target_feature_t {
     halide_target_feature_asan = 53, ///< Enable hooks for ASAN support.
     halide_target_feature_d3d12compute = 54, ///< Enable Direct3D 12 Compute runtime.
     halide_target_feature_check_unsafe_promises = 55, ///< Insert assertions for promises.
-    halide_target_feature_end = 56 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
+    halide_target_feature_plan_memory = 56, ///< Place heap allocations made at the same loop level in a single arena, reusing the memory of allocations with disjoint lifetimes. Host code only.
+    halide_target_feature_batch = 57, ///< Also generate a <name>_batch entry point, taking every buffer with an extra outermost batch dimension, that runs the pipeline on each batch element in parallel. Not supported by the C backend.
+    halide_target_feature_end = 58 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
 /** This function is called internally by Halide in some situations to determine
@@ -35,6 +35,10 @@ WEAK halide_thread *halide_spawn_thread(void (*f)(void *), void *closure) {
     return NULL;
 }
 
+WEAK size_t halide_set_thread_stack_size(size_t size) {
+    return 0;
+}
+
 WEAK void halide_mutex_lock(halide_mutex *mutex) {
 }
 
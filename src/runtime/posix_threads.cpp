@@ -17,9 +17,16 @@ struct pthread_cond_t {
     uint64_t _private[8];
 };
 
+struct pthread_attr_t {
+    uint64_t _private[8];
+};
+
 typedef long pthread_t;
 extern int pthread_create(pthread_t *, const void * attr,
                           void *(*start_routine)(void *), void * arg);
+extern int pthread_attr_init(pthread_attr_t *attr);
+extern int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize);
+extern int pthread_attr_destroy(pthread_attr_t *attr);
 extern int pthread_join(pthread_t thread, void **retval);
 extern int pthread_cond_init(pthread_cond_t *cond, const void *attr);
 extern int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
@@ -45,6 +52,21 @@ WEAK void *spawn_thread_helper(void *arg) {
     return NULL;
 }
 
+// The stack size of spawned threads, or zero for the system default.
+WEAK size_t thread_stack_size = 0;
+WEAK bool thread_stack_size_initialized = false;
+
+WEAK size_t get_thread_stack_size() {
+    if (!thread_stack_size_initialized) {
+        char *stack_size_str = getenv("HL_THREAD_STACK_SIZE");
+        if (stack_size_str) {
+            thread_stack_size = atoi(stack_size_str);
+        }
+        thread_stack_size_initialized = true;
+    }
+    return thread_stack_size;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -54,10 +76,25 @@ WEAK struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closure)
     t->f = f;
     t->closure = closure;
     t->handle = 0;
-    pthread_create(&t->handle, NULL, spawn_thread_helper, t);
+    size_t stack_size = get_thread_stack_size();
+    if (stack_size) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, stack_size);
+        pthread_create(&t->handle, &attr, spawn_thread_helper, t);
+        pthread_attr_destroy(&attr);
+    } else {
+        pthread_create(&t->handle, NULL, spawn_thread_helper, t);
+    }
     return (halide_thread *)t;
 }
 
+WEAK size_t halide_set_thread_stack_size(size_t size) {
+    size_t old = get_thread_stack_size();
+    thread_stack_size = size;
+    return old;
+}
+
 WEAK void halide_join_thread(struct halide_thread *thread_arg) {
     spawned_thread *t = (spawned_thread *)thread_arg;
     void *ret = NULL;
@@ -21,6 +21,9 @@ void spawn_thread_helper(void *arg) {
     spawned_thread *t = (spawned_thread *)arg;
     t->f(t->closure);
 }
+
+// The stack size of spawned threads, or zero for the default.
+size_t thread_stack_size = 0;
 }
 
 extern "C" {
@@ -38,17 +41,24 @@ WEAK struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closure)
     spawned_thread *t = (spawned_thread *)malloc(sizeof(spawned_thread));
     t->f = f;
     t->closure = closure;
-    t->stack = memalign(128, STACK_SIZE);
+    size_t stack_size = thread_stack_size ? thread_stack_size : STACK_SIZE;
+    t->stack = memalign(128, stack_size);
     memset(&t->handle, 0, sizeof(t->handle));
     qurt_thread_attr_t thread_attr;
     qurt_thread_attr_init(&thread_attr);
     qurt_thread_attr_set_stack_addr(&thread_attr, t->stack);
-    qurt_thread_attr_set_stack_size(&thread_attr, STACK_SIZE);
+    qurt_thread_attr_set_stack_size(&thread_attr, stack_size);
     qurt_thread_attr_set_priority(&thread_attr, 255);
     qurt_thread_create(&t->handle.val, &thread_attr, &spawn_thread_helper, t);
     return (halide_thread *)t;
 }
 
+WEAK size_t halide_set_thread_stack_size(size_t size) {
+    size_t old = thread_stack_size;
+    thread_stack_size = size;
+    return old;
+}
+
 WEAK void halide_join_thread(struct halide_thread *thread_arg) {
     spawned_thread *t = (spawned_thread *)thread_arg;
     int ret = 0;
@@ -45,6 +45,21 @@ WEAK void *spawn_thread_helper(void *arg) {
     return NULL;
 }
 
+// The stack size of spawned threads, or zero for the system default.
+WEAK size_t thread_stack_size = 0;
+WEAK bool thread_stack_size_initialized = false;
+
+WEAK size_t get_thread_stack_size() {
+    if (!thread_stack_size_initialized) {
+        char *stack_size_str = getenv("HL_THREAD_STACK_SIZE");
+        if (stack_size_str) {
+            thread_stack_size = atoi(stack_size_str);
+        }
+        thread_stack_size_initialized = true;
+    }
+    return thread_stack_size;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -63,10 +78,19 @@ WEAK halide_thread *halide_spawn_thread(void(*f)(void *), void *closure) {
     spawned_thread *t = (spawned_thread *)malloc(sizeof(spawned_thread));
     t->f = f;
     t->closure = closure;
-    t->handle = CreateThread(NULL, 0, spawn_thread_helper, t, 0, NULL);
+    // Set the reserved (rather than committed) size of the stack.
+    const int32_t stack_size_param_is_a_reservation = 0x00010000;
+    t->handle = CreateThread(NULL, get_thread_stack_size(), spawn_thread_helper, t,
+                             stack_size_param_is_a_reservation, NULL);
     return (halide_thread *)t;
 }
 
+WEAK size_t halide_set_thread_stack_size(size_t size) {
+    size_t old = get_thread_stack_size();
+    thread_stack_size = size;
+    return old;
+}
+
 WEAK void halide_join_thread(halide_thread *thread_arg) {
     spawned_thread *thread = (spawned_thread *)thread_arg;
     WaitForSingleObject(thread->handle, -1);
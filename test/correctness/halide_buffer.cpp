@@ -74,6 +74,18 @@ void test_copy(Buffer<float> a, Buffer<float> b) {
     check_equal(a_window, b_window);
 }
 
+// A stand-in for halide_do_par_for that runs the tasks serially, so
+// that this test does not need to link a Halide runtime.
+int num_tasks_run = 0;
+int serial_do_par_for(void *user_context, halide_task_t task, int min, int size, uint8_t *closure) {
+    for (int i = min; i < min + size; i++) {
+        num_tasks_run++;
+        int result = task(user_context, i, closure);
+        if (result) return result;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     {
         // Check copying a buffer
@@ -114,6 +126,43 @@ int main(int argc, char **argv) {
         test_copy(a, b);
     }
 
+    {
+        // Check copies between buffers with dense and non-dense
+        // layouts, both serially and split into tasks.
+        Buffer<uint16_t> a(1000, 300, 3), b(1000, 300, 3);
+        b.fill([&](int x, int y, int c) {
+            return (uint16_t)(x + 3 * y + 5 * c);
+        });
+
+        // Same layout: a single dense run.
+        a.fill(0);
+        a.copy_from(b);
+        check_equal(a, b);
+
+        num_tasks_run = 0;
+        a.fill(0);
+        a.copy_from(b, serial_do_par_for);
+        check_equal(a, b);
+        assert(num_tasks_run > 1);
+
+        // Dense rows, but not a single dense run.
+        Buffer<uint16_t> a_window = a.cropped(0, 100, 800);
+        num_tasks_run = 0;
+        a.fill(0);
+        a_window.copy_from(b, serial_do_par_for);
+        check_equal(a_window, b.cropped(0, 100, 800));
+        assert(num_tasks_run == 3);
+
+        // Different layouts: falls back to an element-wise copy.
+        Buffer<uint16_t> c = Buffer<uint16_t>::make_interleaved(1000, 300, 3);
+        c.copy_from(b, serial_do_par_for);
+        check_equal(c, b);
+
+        // A single element.
+        Buffer<uint16_t> d = b.sliced(2, 1).sliced(1, 7).sliced(0, 9).copy();
+        assert(d.dimensions() == 0 && d() == b(9, 7, 1));
+    }
+
     {
         // Check make a Buffer from a Buffer of a different type
         Buffer<float, 2> a(100, 80);
@@ -336,6 +385,53 @@ int main(int argc, char **argv) {
         // c.for_each_value([&](int c_value, int a_value, int &b_value) { }, a_const, b_const);
     }
 
+    {
+        // Check the parallel variants of for_each_value and
+        // for_each_element visit every site exactly once.
+        Buffer<int> a(100, 20, 3);
+        Buffer<int> b = Buffer<int>::make_interleaved(100, 20, 3);
+        a.fill(0);
+        b.fill(1);
+
+        num_tasks_run = 0;
+        a.par_for_each_value(serial_do_par_for, [&](int &a_value, int b_value) {
+            a_value += b_value;
+        }, b);
+        assert(num_tasks_run == 3);
+        assert(a.all_equal(1));
+
+        // A 1D buffer is split into chunks of its only dimension.
+        Buffer<int> c(100000);
+        c.fill(0);
+        num_tasks_run = 0;
+        c.par_for_each_value(serial_do_par_for, [&](int &c_value) { c_value++; });
+        assert(num_tasks_run > 1);
+        assert(c.all_equal(1));
+
+        num_tasks_run = 0;
+        a.par_for_each_element(serial_do_par_for, [&](const int *pos) {
+            a(pos) += pos[0] + pos[1] + pos[2];
+        });
+        assert(num_tasks_run == 3);
+
+        // With fewer args than dimensions, only the dimensions
+        // iterated over are split.
+        num_tasks_run = 0;
+        a.par_for_each_element(serial_do_par_for, [&](int x, int y) {
+            a(x, y, 0) += 1;
+        });
+        assert(num_tasks_run == 20);
+
+        a.for_each_element([&](int x, int y, int c) {
+            int correct = 1 + x + y + c + (c == 0 ? 1 : 0);
+            if (a(x, y, c) != correct) {
+                printf("a(%d, %d, %d) = %d instead of %d\n",
+                       x, y, c, a(x, y, c), correct);
+                abort();
+            }
+        });
+    }
+
     {
         // Check initializing const buffers via return ref from fill(), etc
         const int W = 5, H = 4;
@@ -15,6 +15,19 @@ void test_round_trip(Buffer<T> buf, std::string format) {
     // Reload it
     Buffer<T> reloaded = Tools::load_image(filename);
 
+    // Reload it again without copying the payload, where the format allows it.
+    {
+        Tools::MappedFile file;
+        Buffer<T> mapped;
+        Tools::load_mapped<Buffer<T>, Tools::Internal::CheckFail>(filename, &file, &mapped);
+        mapped.for_each_element([&](const int *pos) {
+            if (mapped(pos) != reloaded(pos)) {
+                printf("test_round_trip: load_mapped disagrees with load_image for %s\n", format.c_str());
+                abort();
+            }
+        });
+    }
+
     // Ensure that reloaded has the same origin as buf
     for (int d = 0; d < buf.dimensions(); ++d) {
         reloaded.translate(d, buf.dim(d).min() - reloaded.dim(d).min());
@@ -179,7 +192,7 @@ void do_test() {
     luma_buf.copy_from(color_buf);
     luma_buf.slice(2);
 
-    std::vector<std::string> formats = {"ppm","pgm","tmp","mat"};
+    std::vector<std::string> formats = {"ppm","pgm","tmp","mat","npy"};
 #ifndef HALIDE_NO_JPEG
     formats.push_back("jpg");
 #endif
@@ -206,6 +219,18 @@ void do_test() {
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x4\n";
             test_round_trip(funky_buf, format);
 
+            // Check that writing through a mapping matches save_image.
+            std::string mapped_filename = Internal::get_test_tmp_dir() + "test_mapped." + format;
+            Tools::save_mapped<Buffer<T>, Tools::Internal::CheckFail>(cb4, mapped_filename);
+            Buffer<T> reloaded = Tools::load_image(mapped_filename);
+            reloaded.translate({cb4.dim(0).min(), cb4.dim(1).min(), 0, 0});
+            cb4.for_each_element([&](const int *pos) {
+                if (cb4(pos) != reloaded(pos)) {
+                    printf("save_mapped did not round-trip\n");
+                    abort();
+                }
+            });
+
             continue;
         }
         if (format != "pgm") {
@@ -219,6 +244,40 @@ void do_test() {
             test_round_trip(luma_buf, format);
         }
     }
+
+    // Write a .npy file one tile at a time, and read part of it back the same way.
+    {
+        std::cout << "Testing .npy regions for " << halide_type_of<T>() << "x3\n";
+        std::string filename = Internal::get_test_tmp_dir() + "test_region.npy";
+        // (Halide::Buffer copies share their shape, so make a new one.)
+        Buffer<T> src(Runtime::Buffer<T>(*color_buf.get()));
+        src.set_min(0, 0, 0);
+        Tools::create_npy<Tools::Internal::CheckFail>(filename, halide_type_of<T>(), {src.width(), src.height(), src.channels()});
+        const int tile_w = src.width() / 2 + 3, tile_h = src.height() / 3 + 1;
+        for (int ty = 0; ty < src.height(); ty += tile_h) {
+            for (int tx = 0; tx < src.width(); tx += tile_w) {
+                Buffer<T> tile(src.get()->cropped(0, tx, std::min(tile_w, src.width() - tx))
+                                          .cropped(1, ty, std::min(tile_h, src.height() - ty)));
+                Tools::save_npy_region<Buffer<T>, Tools::Internal::CheckFail>(tile, filename);
+            }
+        }
+        Buffer<T> region = Buffer<T>::make_interleaved(100, 50, 3);
+        region.set_min(17, 33, 0);
+        Tools::load_npy_region<Buffer<T>, Tools::Internal::CheckFail>(filename, &region);
+        region.for_each_element([&](int x, int y, int c) {
+            if (region(x, y, c) != src(x, y, c)) {
+                printf(".npy region mismatch at %d %d %d\n", x, y, c);
+                abort();
+            }
+        });
+        Buffer<T> whole = Tools::load_image(filename);
+        whole.for_each_element([&](int x, int y, int c) {
+            if (whole(x, y, c) != src(x, y, c)) {
+                printf(".npy written in tiles mismatch at %d %d %d\n", x, y, c);
+                abort();
+            }
+        });
+    }
 }
 
 int main(int argc, char **argv) {
@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <map>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Track the number of heap allocations and the peak heap usage.
+int mallocs = 0;
+size_t current_size = 0, peak_size = 0;
+std::map<void *, size_t> sizes;
+
+void *my_malloc(void *, size_t sz) {
+    mallocs++;
+    void *ptr = malloc(sz);
+    sizes[ptr] = sz;
+    current_size += sz;
+    peak_size = std::max(peak_size, current_size);
+    return ptr;
+}
+
+void my_free(void *, void *ptr) {
+    current_size -= sizes[ptr];
+    sizes.erase(ptr);
+    free(ptr);
+}
+
+int main(int argc, char **argv) {
+    const int W = 100000;
+    const int stages = 6;
+
+    // A chain of stages computed at root. Each of them is only used
+    // by the next one, so only two of them are live at a time.
+    Var x;
+    std::vector<Func> f(stages);
+    f[0](x) = x;
+    for (int i = 1; i < stages; i++) {
+        f[i](x) = f[i - 1](x - 1) + f[i - 1](x + 1);
+        f[i - 1].compute_root().vectorize(x, 8);
+    }
+    Func out;
+    out(x) = f[stages - 1](x);
+    out.set_custom_allocator(my_malloc, my_free);
+
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature() || t.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        printf("Skipping test for device target\n");
+        return 0;
+    }
+
+    mallocs = 0;
+    peak_size = 0;
+    Buffer<int> expected = out.realize(W, t.without_feature(Target::PlanMemory));
+    printf("Without plan_memory: %d mallocs, %d bytes\n", mallocs, (int)peak_size);
+    if (mallocs != stages - 1) {
+        printf("Expected %d mallocs instead of %d\n", stages - 1, mallocs);
+        return -1;
+    }
+
+    mallocs = 0;
+    peak_size = 0;
+    Buffer<int> planned = out.realize(W, t.with_feature(Target::PlanMemory));
+    printf("With plan_memory: %d mallocs, %d bytes\n", mallocs, (int)peak_size);
+
+    // All of the stages should be placed in one arena...
+    if (mallocs != 1) {
+        printf("Expected 1 malloc instead of %d\n", mallocs);
+        return -1;
+    }
+    // ...with room for two of them.
+    if (peak_size > 3 * W * sizeof(int)) {
+        printf("Arena of %d bytes is too large\n", (int)peak_size);
+        return -1;
+    }
+
+    for (int i = 0; i < W; i++) {
+        if (planned(i) != expected(i)) {
+            printf("planned(%d) = %d instead of %d\n", i, planned(i), expected(i));
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
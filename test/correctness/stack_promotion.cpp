@@ -0,0 +1,57 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::atomic<int> mallocs;
+
+void *my_malloc(void *, size_t sz) {
+    mallocs++;
+    return malloc(sz);
+}
+
+void my_free(void *, void *ptr) {
+    free(ptr);
+}
+
+int main(int argc, char **argv) {
+    Var x, y, xo, yo, xi, yi;
+
+    // A scratch buffer computed per tile of a parallel loop. The tiles
+    // at the edges are smaller, so the buffer doesn't have a constant
+    // size, but it is bounded by a few KB, so it should go on the
+    // stack rather than calling malloc for each tile.
+    Func f, g;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    g.tile(x, y, xo, yo, xi, yi, 32, 8, TailStrategy::GuardWithIf).parallel(yo);
+    f.compute_at(g, xo);
+    g.set_custom_allocator(my_malloc, my_free);
+
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature() || t.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        printf("Skipping test for device target\n");
+        return 0;
+    }
+
+    mallocs = 0;
+    Buffer<int> out = g.realize(100, 100);
+    if (mallocs != 0) {
+        printf("Expected no mallocs, got %d\n", (int)mallocs);
+        return -1;
+    }
+
+    for (int j = 0; j < out.height(); j++) {
+        for (int i = 0; i < out.width(); i++) {
+            int correct = 2 * (i + j) + 1;
+            if (out(i, j) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
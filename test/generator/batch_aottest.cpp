@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "batch.h"
+
+using namespace Halide::Runtime;
+
+const int W = 32, H = 24, N = 8;
+
+static bool called_error = false;
+static char error_message[1024];
+
+void my_halide_error(void *user_context, const char *msg) {
+    called_error = true;
+    strncpy(error_message, msg, sizeof(error_message) - 1);
+}
+
+int main(int argc, char **argv) {
+    halide_set_error_handler(&my_halide_error);
+
+    Buffer<uint8_t> input(W, H + 1, N);
+    input.for_each_element([&](int x, int y, int n) {
+        input(x, y, n) = (uint8_t)(x * 3 + y * 5 + n * 7);
+    });
+
+    // Run the batch over the last three slices only, into an output
+    // whose batch dimension has a nonzero min.
+    Buffer<float> output(W, H, N - 3);
+    output.set_min(0, 0, 3);
+
+    int result = batch_batch(input, 0.5f, output);
+    if (result != 0) {
+        fprintf(stderr, "batch_batch failed: %d\n", result);
+        return -1;
+    }
+
+    // Each slice must match a call to the unbatched pipeline.
+    for (int n = 3; n < N; n++) {
+        Buffer<uint8_t> in_slice = input.sliced(2, n);
+        Buffer<float> expected(W, H);
+        result = batch(in_slice, 0.5f, expected);
+        if (result != 0) {
+            fprintf(stderr, "batch failed: %d\n", result);
+            return -1;
+        }
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                if (output(x, y, n) != expected(x, y)) {
+                    fprintf(stderr, "output(%d, %d, %d) = %f instead of %f\n",
+                            x, y, n, output(x, y, n), expected(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Buffers that don't cover the batch are rejected.
+    Buffer<uint8_t> short_input = input.cropped(2, 0, 4);
+    result = batch_batch(short_input, 0.5f, output);
+    if (result != halide_error_code_access_out_of_bounds || !called_error) {
+        fprintf(stderr, "Expected an out-of-bounds error, got %d\n", result);
+        return -1;
+    }
+    called_error = false;
+
+    // As are buffers without a batch dimension.
+    Buffer<float> flat_output(W, H);
+    result = batch_batch(input, 0.5f, flat_output);
+    if (result != halide_error_code_bad_dimensions || !called_error) {
+        fprintf(stderr, "Expected a bad dimensions error, got %d\n", result);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "Halide.h"
+
+namespace {
+
+class Batch : public Halide::Generator<Batch> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Input<float> scale{"scale"};
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func blur;
+        blur(x, y) = (input(x, y) + input(x, y + 1)) * scale;
+
+        output(x, y) = blur(x, y) + input(x, y);
+
+        // Batching has a parallel loop of its own, so the pipeline itself
+        // should be serial, but vectorized.
+        output.vectorize(x, natural_vector_size<float>());
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Batch, batch)
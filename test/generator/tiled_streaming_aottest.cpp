@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "halide_streaming.h"
+
+#include "tiled_streaming.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+const int W = 300, H = 200;
+
+int test(const Buffer<uint16_t> &input, const Buffer<uint16_t> &expected,
+         const std::vector<int> &tile_extents, bool prefetch) {
+    Buffer<uint16_t> output(W, H);
+    output.fill(0);
+
+    // Check that no read asks for more than a tile plus its apron.
+    TileSource source = buffer_tile_source(input);
+    auto read = source.read;
+    int reads = 0;
+    source.read = [&](Buffer<> &tile) {
+        reads++;
+        for (int d = 0; d < 2; d++) {
+            int max_extent = (d < (int) tile_extents.size() && tile_extents[d] > 0 ? tile_extents[d] : input.dim(d).extent()) + 2;
+            if (tile.dim(d).extent() > max_extent) {
+                printf("Read of extent %d in dimension %d is larger than expected\n", tile.dim(d).extent(), d);
+                return false;
+            }
+        }
+        return read(tile);
+    };
+
+    int result = stream_tiles([](const std::vector<halide_buffer_t *> &inputs, halide_buffer_t *out) {
+        return tiled_streaming(inputs[0], out);
+    }, {source}, buffer_tile_sink(output), tile_extents, prefetch);
+    if (result != 0) {
+        printf("stream_tiles failed: %d\n", result);
+        return -1;
+    }
+
+    int expected_reads = 1;
+    for (int d = 0; d < 2; d++) {
+        int extent = d < (int) tile_extents.size() && tile_extents[d] > 0 ? tile_extents[d] : input.dim(d).extent();
+        expected_reads *= (input.dim(d).extent() + extent - 1) / extent;
+    }
+    if (reads != expected_reads) {
+        printf("Expected %d reads, got %d\n", expected_reads, reads);
+        return -1;
+    }
+
+    int errors = 0;
+    output.for_each_element([&](int x, int y) {
+        if (output(x, y) != expected(x, y) && errors++ < 10) {
+            printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), expected(x, y));
+        }
+    });
+    return errors ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    Buffer<uint16_t> input(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint16_t)((x * 37 + y * 101) ^ (x * y));
+    });
+
+    Buffer<uint16_t> expected(W, H);
+    if (tiled_streaming(input, expected) != 0) {
+        printf("tiled_streaming failed\n");
+        return -1;
+    }
+
+    for (bool prefetch : {false, true}) {
+        if (test(input, expected, {64, 48}, prefetch) != 0 ||
+            test(input, expected, {128}, prefetch) != 0 ||
+            test(input, expected, {W, 1}, prefetch) != 0) {
+            return -1;
+        }
+    }
+
+    // A pipeline that needs more of the input than there is should fail
+    // cleanly, before it is run.
+    Buffer<uint16_t> output(W, H);
+    int result = stream_tiles([](const std::vector<halide_buffer_t *> &inputs, halide_buffer_t *out) {
+        if (inputs[0]->host == nullptr) {
+            for (int d = 0; d < 2; d++) {
+                inputs[0]->dim[d].min = out->dim[d].min - 10;
+                inputs[0]->dim[d].extent = out->dim[d].extent + 20;
+            }
+            return 0;
+        }
+        printf("Pipeline should not have been run\n");
+        exit(-1);
+    }, {buffer_tile_source(input)}, buffer_tile_sink(output), {64, 64});
+    if (result != halide_error_code_access_out_of_bounds) {
+        printf("Expected stream_tiles to fail with an out-of-bounds error, got %d\n", result);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "Halide.h"
+
+namespace {
+
+// A 3x3 box filter, used to test streaming over tiles with
+// halide_streaming.h. Accesses are clamped to the bounds of the input
+// buffer, so a bounds query made with the full input shape asks for
+// exactly the part of the input a tile needs.
+class TiledStreaming : public Halide::Generator<TiledStreaming> {
+public:
+    Input<Buffer<uint16_t>> input{ "input", 2 };
+    Output<Buffer<uint16_t>> output{ "output", 2 };
+
+    void generate() {
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+
+        Func blur_x;
+        blur_x(x, y) = cast<uint32_t>(clamped(x - 1, y)) + clamped(x, y) + clamped(x + 1, y);
+        output(x, y) = cast<uint16_t>((blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 9);
+
+        blur_x.compute_at(output, y).vectorize(x, natural_vector_size<uint32_t>());
+        output.vectorize(x, natural_vector_size<uint16_t>());
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(TiledStreaming, tiled_streaming)
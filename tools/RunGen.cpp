@@ -3,15 +3,21 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 extern "C" int halide_rungen_redirect_argv(void **args);
@@ -615,9 +621,15 @@ Buffer<> adjust_buffer_dims(const std::string &title, const std::string &name, c
 // fit the metadata's requirements as needed.
 Buffer<> load_input_from_file(const std::string &pathname,
                               const halide_filter_argument_t &metadata) {
+    // Inputs in uncompressed formats are mapped rather than read, so
+    // that large inputs aren't copied. The mappings must outlive the
+    // Buffers, so keep them around until exit.
+    static std::vector<std::unique_ptr<Halide::Tools::MappedFile>> mapped_inputs;
+    mapped_inputs.emplace_back(new Halide::Tools::MappedFile);
+
     Buffer<> b = Buffer<>(metadata.type, 0);
     info() << "Loading input " << metadata.name << " from " << pathname << " ...";
-    if (!Halide::Tools::load<Buffer<>, IOCheckFail>(pathname, &b)) {
+    if (!Halide::Tools::load_mapped<Buffer<>, IOCheckFail>(pathname, mapped_inputs.back().get(), &b)) {
         fail() << "Unable to load input: " << pathname;
     }
     if (b.dimensions() != metadata.dimensions) {
@@ -632,6 +644,12 @@ Buffer<> load_input_from_file(const std::string &pathname,
     return b;
 }
 
+Buffer<> allocate_zero_buffer(const halide_type_t &type, const Shape &shape) {
+    Buffer<> b = allocate_buffer(type, shape);
+    memset(b.data(), 0, b.size_in_bytes());
+    return b;
+}
+
 Buffer<> load_input(const std::string &pathname,
                     const halide_filter_argument_t &metadata) {
     std::vector<std::string> v = split_string(pathname, ":");
@@ -641,10 +659,7 @@ Buffer<> load_input(const std::string &pathname,
 
     // Assume it's a special std::string of the form key:values
     if (v[0] == "zero") {
-        auto shape = parse_extents(v[1]);
-        Buffer<> b = allocate_buffer(metadata.type, shape);
-        memset(b.data(), 0, b.size_in_bytes());
-        return b;
+        return allocate_zero_buffer(metadata.type, parse_extents(v[1]));
     }
 
     // TODO: add random options.
@@ -730,6 +745,288 @@ uint64_t calc_pixels_out(const std::map<std::string, ArgData> &args) {
     return pixels_out;
 }
 
+// Run a bounds query for the given default output shape, then allocate
+// the output buffers, and reshape the input buffers as necessary, to
+// match its results.
+void prepare_buffers(const Shape &default_output_shape, std::map<std::string, ArgData> *args) {
+    std::vector<Shape> constrained_shapes = run_bounds_query(*args, default_output_shape);
+
+    for (auto &arg_pair : *args) {
+        auto &arg_name = arg_pair.first;
+        auto &arg = arg_pair.second;
+        const Shape &constrained_shape = constrained_shapes[arg.index];
+        switch (arg.metadata->kind) {
+            case halide_argument_kind_input_buffer: {
+                info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
+                bool updated = adapt_input_buffer_layout(constrained_shape, &arg.buffer_value);
+                info() << "Input " << arg_name << ": BoundsQuery result is " << constrained_shape;
+                if (updated) {
+                    info() << "Input " << arg_name << ": Updated Shape is " << get_shape(arg.buffer_value);
+                }
+                break;
+            }
+            case halide_argument_kind_output_buffer: {
+                arg.buffer_value = allocate_buffer(arg.metadata->type, make_legal_output_buffer_shape(constrained_shape));
+                info() << "Output " << arg_name << ": BoundsQuery result is " << constrained_shape;
+                info() << "Output " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
+                break;
+            }
+        }
+    }
+}
+
+std::vector<void*> make_filter_argv(std::map<std::string, ArgData> &args) {
+    std::vector<void*> filter_argv(args.size(), nullptr);
+    for (auto &arg_pair : args) {
+        auto &arg = arg_pair.second;
+        switch (arg.metadata->kind) {
+            case halide_argument_kind_input_scalar:
+                filter_argv[arg.index] = &arg.scalar_value;
+                break;
+            case halide_argument_kind_input_buffer:
+            case halide_argument_kind_output_buffer:
+                filter_argv[arg.index] = arg.buffer_value.raw_buffer();
+                break;
+        }
+    }
+    return filter_argv;
+}
+
+// Scale the first two dimensions of a shape (which are generally the
+// spatial ones), keeping every extent at least one.
+Shape scale_shape(Shape shape, double scale) {
+    for (size_t i = 0; i < shape.size() && i < 2; i++) {
+        shape[i].extent = std::max(1, (int) (shape[i].extent * scale + 0.5));
+        shape[i].stride = 0;
+    }
+    return shape;
+}
+
+std::string extents_to_string(const Shape &shape) {
+    std::ostringstream o;
+    for (size_t i = 0; i < shape.size(); i++) {
+        o << (i > 0 ? "x" : "") << shape[i].extent;
+    }
+    return o.str();
+}
+
+// One point of a --benchmark_sweep_scales / --benchmark_sweep_threads sweep.
+struct SweepPoint {
+    double scale;
+    int threads;
+    // The extents of the first output.
+    std::string extents;
+    uint64_t pixels_out;
+    // Seconds per call.
+    double time;
+    double pixels_per_sec;
+    // The speedup over the fewest threads swept at the same scale, divided
+    // by the increase in threads; 1 is perfect scaling.
+    double efficiency;
+};
+
+// Benchmark the filter at every combination of the given scales (applied
+// to the first two dimensions of the default output shape and of every
+// input) and thread counts. 'timer' returns the time for one call of the
+// function passed to it.
+std::vector<SweepPoint> run_sweep(const std::map<std::string, ArgData> &base_args,
+                                  const Shape &default_output_shape,
+                                  const std::vector<double> &scales,
+                                  const std::vector<int> &threads,
+                                  const std::function<double(const std::function<void()> &)> &timer) {
+    std::vector<SweepPoint> points;
+    for (double scale : scales) {
+        std::map<std::string, ArgData> args = base_args;
+        if (scale != 1.0) {
+            for (auto &arg_pair : args) {
+                auto &arg = arg_pair.second;
+                if (arg.metadata->kind != halide_argument_kind_input_buffer) {
+                    continue;
+                }
+                std::vector<std::string> v = split_string(arg.raw_string, ":");
+                if (v.size() != 2 || v[0] != "zero") {
+                    fail() << "--benchmark_sweep_scales requires every input to be of the form zero:[...], "
+                           << "but " << arg_pair.first << " is " << arg.raw_string;
+                }
+                arg.buffer_value = allocate_zero_buffer(arg.metadata->type, scale_shape(parse_extents(v[1]), scale));
+            }
+        }
+        prepare_buffers(scale_shape(default_output_shape, scale), &args);
+        std::vector<void*> filter_argv = make_filter_argv(args);
+
+        std::string extents;
+        for (auto &arg_pair : args) {
+            if (arg_pair.second.metadata->kind == halide_argument_kind_output_buffer) {
+                extents = extents_to_string(get_shape(arg_pair.second.buffer_value));
+                break;
+            }
+        }
+        const uint64_t pixels_out = calc_pixels_out(args);
+
+        const size_t first = points.size();
+        for (int t : threads) {
+            // Zero means the default (e.g. from HL_NUM_THREADS); setting it
+            // twice returns the number of threads it resolved to the
+            // first time, so that efficiencies can be computed.
+            halide_set_num_threads(t);
+            t = halide_set_num_threads(t);
+            info() << "Benchmarking filter at scale " << scale << " with " << t << " threads...";
+            double time = timer([&filter_argv, &args]() {
+                (void) halide_rungen_redirect_argv(&filter_argv[0]);
+                for (auto &arg_pair : args) {
+                    auto &arg = arg_pair.second;
+                    if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+                        arg.buffer_value.device_sync();
+                    }
+                }
+            });
+            SweepPoint p;
+            p.scale = scale;
+            p.threads = t;
+            p.extents = extents;
+            p.pixels_out = pixels_out;
+            p.time = time;
+            p.pixels_per_sec = pixels_out / time;
+            p.efficiency = 1.0;
+            points.push_back(p);
+        }
+        const SweepPoint *reference = &points[first];
+        for (size_t i = first; i < points.size(); i++) {
+            if (points[i].threads < reference->threads) {
+                reference = &points[i];
+            }
+        }
+        for (size_t i = first; i < points.size(); i++) {
+            points[i].efficiency = (reference->time * reference->threads) / (points[i].time * points[i].threads);
+        }
+    }
+    halide_set_num_threads(0);
+    return points;
+}
+
+// Write a sweep as CSV, or as JSON if the filename ends in .json.
+bool save_sweep(const std::string &filename, const std::string &name, const std::vector<SweepPoint> &points) {
+    std::ofstream f(filename);
+    if (!f) {
+        return false;
+    }
+    f << std::setprecision(9);
+    const bool json = filename.size() >= 5 && filename.substr(filename.size() - 5) == ".json";
+    if (json) {
+        f << "{\"name\": \"" << name << "\", \"points\": [\n";
+        for (size_t i = 0; i < points.size(); i++) {
+            const SweepPoint &p = points[i];
+            f << "  {\"scale\": " << p.scale
+              << ", \"threads\": " << p.threads
+              << ", \"extents\": \"" << p.extents << "\""
+              << ", \"pixels\": " << p.pixels_out
+              << ", \"time\": " << p.time
+              << ", \"pixels_per_sec\": " << p.pixels_per_sec
+              << ", \"parallel_efficiency\": " << p.efficiency
+              << "}" << (i + 1 < points.size() ? "," : "") << "\n";
+        }
+        f << "]}\n";
+    } else {
+        f << "name,scale,threads,extents,pixels,time,pixels_per_sec,parallel_efficiency\n";
+        for (const SweepPoint &p : points) {
+            f << name << "," << p.scale << "," << p.threads << "," << p.extents << ","
+              << p.pixels_out << "," << p.time << "," << p.pixels_per_sec << "," << p.efficiency << "\n";
+        }
+    }
+    return (bool) f;
+}
+
+// A do_par_for that runs every task on the calling thread. With
+// --benchmark_threads_per_instance=1, this keeps concurrent instances
+// from contending for the shared thread pool.
+int rungen_serial_do_par_for(void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+    for (int x = min; x < min + size; x++) {
+        int result = halide_do_task(user_context, f, x, closure);
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+struct ThroughputResult {
+    // Total number of calls made, across all instances.
+    uint64_t calls{0};
+    // Wall-clock time from when all instances started to when the
+    // last one finished (seconds).
+    double wall_time{0};
+    // Latency of every call (seconds), sorted.
+    std::vector<double> latencies;
+
+    double percentile(double p) const {
+        if (latencies.empty()) {
+            return 0;
+        }
+        size_t i = std::min(latencies.size() - 1, (size_t) (p * latencies.size()));
+        return latencies[i];
+    }
+};
+
+// Make each of the given calls repeatedly, each on its own thread, until
+// every thread has made at least min_iters calls and min_time seconds
+// have elapsed (or it has made max_iters calls). Each call is made once
+// before timing starts, to warm up.
+ThroughputResult run_throughput_benchmark(const std::vector<std::function<void()>> &calls,
+                                          double min_time, uint64_t min_iters, uint64_t max_iters) {
+    using BenchmarkClock = Halide::Tools::SteadyClock<>::type;
+
+    const size_t n = calls.size();
+    std::vector<std::vector<double>> latencies(n);
+    std::vector<BenchmarkClock::time_point> end_times(n);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    BenchmarkClock::time_point start;
+
+    auto worker = [&](size_t i) {
+        calls[i]();
+        ready++;
+        while (!go) {
+            std::this_thread::yield();
+        }
+        uint64_t iters = 0;
+        while (true) {
+            auto t0 = BenchmarkClock::now();
+            calls[i]();
+            auto t1 = BenchmarkClock::now();
+            latencies[i].push_back(std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count());
+            iters++;
+            double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(t1 - start).count();
+            if ((elapsed >= min_time && iters >= min_iters) || iters >= max_iters) {
+                end_times[i] = t1;
+                break;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n; i++) {
+        threads.emplace_back(worker, i);
+    }
+    while (ready < n) {
+        std::this_thread::yield();
+    }
+    start = BenchmarkClock::now();
+    go = true;
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    ThroughputResult result;
+    auto end = *std::max_element(end_times.begin(), end_times.end());
+    result.wall_time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    for (auto &l : latencies) {
+        result.latencies.insert(result.latencies.end(), l.begin(), l.end());
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    result.calls = result.latencies.size();
+    return result;
+}
+
 void usage(const char *argv0) {
 const std::string usage = R"USAGE(
 Usage: $NAME$ argument=value [argument=value... ] [flags]
@@ -808,6 +1105,58 @@ Flags:
         Override the default maximum number of benchmarking iterations; ignored
         if --benchmarks is not also specified.
 
+    --benchmark_stats:
+        Instead of reporting only the best-case time, time each iteration
+        separately (after detecting warm-up) and report the median, p90 and
+        p99 times, a 95% confidence interval for the median, and the number
+        of outliers. Ignored if --benchmarks is not also specified.
+
+    --benchmark_flush_cache=BYTES:
+        With --benchmark_stats, touch a buffer of this size before every
+        iteration, to measure cold-cache performance.
+
+    --benchmark_pin_cpu=NUM:
+        With --benchmark_stats, pin the calling thread to the given CPU
+        (Linux only).
+
+    --benchmark_json=FILE:
+        With --benchmark_stats, also append the results to FILE as a JSON
+        object (one per line), for regression tracking.
+
+    --benchmark_sweep_scales=MIN:MAX[:FACTOR]:
+        Instead of benchmarking once, benchmark at a geometric range of
+        sizes: the first two extents of the output and of every input are
+        multiplied by MIN, MIN * FACTOR, ... up to MAX (FACTOR defaults to
+        2). Every input must be of the form zero:[...]. Reports time,
+        mpix/sec and parallel efficiency at each size, to help find sizes at
+        which performance falls off. Outputs, if given, are saved from one
+        more run at the unscaled size. Ignored if --benchmarks is not also
+        specified. Can't be combined with --track_memory.
+
+    --benchmark_sweep_threads=NUM,NUM,...:
+        Benchmark with each of the given numbers of threads (as if by
+        HL_NUM_THREADS), at each size of --benchmark_sweep_scales if given.
+        Parallel efficiency is measured relative to the fewest threads.
+
+    --benchmark_sweep_output=FILE:
+        Also write the results of a sweep to FILE, as JSON if FILE ends in
+        .json and as CSV otherwise.
+
+    --benchmark_instances=NUM [default = 0]:
+        Instead of timing one call at a time, measure throughput by running
+        NUM independent calls of the filter concurrently, each on its own
+        caller thread with its own copies of the input and output buffers,
+        until --benchmark_min_time has elapsed. Reports calls/sec, mpix/sec,
+        and latency percentiles rather than the best-case time. Ignored if
+        --benchmarks is not also specified.
+
+    --benchmark_threads_per_instance=NUM [default = 0]:
+        With --benchmark_instances, the number of threads each call may use
+        for its parallel loops. 1 runs each call entirely on its caller
+        thread. Larger values size Halide's (shared) thread pool to
+        instances * NUM threads, so this is the average, not a hard limit,
+        per call. 0 leaves the thread pool at its default size.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -909,6 +1258,14 @@ int main(int argc, char **argv) {
     double benchmark_min_time = BenchmarkConfig().min_time;
     uint64_t benchmark_min_iters = BenchmarkConfig().min_iters;
     uint64_t benchmark_max_iters = BenchmarkConfig().max_iters;
+    bool benchmark_stats = false;
+    Halide::Tools::BenchmarkStatsConfig stats_config;
+    std::string benchmark_json;
+    std::vector<double> sweep_scales;
+    std::vector<int> sweep_threads;
+    std::string sweep_output;
+    int benchmark_instances = 0;
+    int benchmark_threads_per_instance = 0;
     for (int i = 1; i < argc; ++i) {
         if (argv[i][0] == '-') {
             const char *p = argv[i] + 1; // skip -
@@ -966,6 +1323,55 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_max_iters)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "benchmark_stats") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &benchmark_stats)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_flush_cache") {
+                uint64_t bytes;
+                if (!parse_scalar(flag_value, &bytes)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                stats_config.flush_cache_bytes = (size_t) bytes;
+            } else if (flag_name == "benchmark_pin_cpu") {
+                if (!parse_scalar(flag_value, &stats_config.pin_to_cpu)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_json") {
+                benchmark_json = flag_value;
+            } else if (flag_name == "benchmark_sweep_scales") {
+                std::vector<std::string> range = split_string(flag_value, ":");
+                double lo, hi, factor = 2.0;
+                if (range.size() < 2 || range.size() > 3 ||
+                    !parse_scalar(range[0], &lo) || !parse_scalar(range[1], &hi) ||
+                    (range.size() == 3 && !parse_scalar(range[2], &factor)) ||
+                    lo <= 0 || hi < lo || factor <= 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                for (double scale = lo; scale <= hi * (1 + 1e-9); scale *= factor) {
+                    sweep_scales.push_back(scale);
+                }
+            } else if (flag_name == "benchmark_sweep_threads") {
+                for (const std::string &t : split_string(flag_value, ",")) {
+                    int threads;
+                    if (!parse_scalar(t, &threads) || threads < 1) {
+                        fail() << "Invalid value for flag: " << flag_name;
+                    }
+                    sweep_threads.push_back(threads);
+                }
+            } else if (flag_name == "benchmark_sweep_output") {
+                sweep_output = flag_value;
+            } else if (flag_name == "benchmark_instances") {
+                if (!parse_scalar(flag_value, &benchmark_instances) || benchmark_instances < 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_threads_per_instance") {
+                if (!parse_scalar(flag_value, &benchmark_threads_per_instance) || benchmark_threads_per_instance < 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "output_extents") {
                 default_output_shape = parse_extents(flag_value);
             } else {
@@ -1012,6 +1418,12 @@ int main(int argc, char **argv) {
         warn() << "Using --track_memory with --benchmarks will produce inaccurate benchmark results.";
     }
 
+    // A sweep allocates its own buffers at every scale, which would all
+    // count towards the high-water mark.
+    if (benchmark && track_memory && (!sweep_scales.empty() || !sweep_threads.empty())) {
+        fail() << "--track_memory can't be used with --benchmark_sweep_scales or --benchmark_sweep_threads.";
+    }
+
     // Check to be sure that all required arguments are specified.
     if (found.size() != args.size() || !unknown_args.empty()) {
         std::ostringstream o;
@@ -1065,30 +1477,7 @@ int main(int argc, char **argv) {
 
     // Run a bounds query: we need to figure out how to allocate the output buffers,
     // and the input buffers might need reshaping to satisfy constraints (e.g. a chunky/interleaved layout).
-    std::vector<Shape> constrained_shapes = run_bounds_query(args, default_output_shape);
-
-    for (auto &arg_pair : args) {
-        auto &arg_name = arg_pair.first;
-        auto &arg = arg_pair.second;
-        const Shape &constrained_shape = constrained_shapes[arg.index];
-        switch (arg.metadata->kind) {
-            case halide_argument_kind_input_buffer: {
-                info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
-                bool updated = adapt_input_buffer_layout(constrained_shape, &arg.buffer_value);
-                info() << "Input " << arg_name << ": BoundsQuery result is " << constrained_shape;
-                if (updated) {
-                    info() << "Input " << arg_name << ": Updated Shape is " << get_shape(arg.buffer_value);
-                }
-                break;
-            }
-            case halide_argument_kind_output_buffer: {
-                arg.buffer_value = allocate_buffer(arg.metadata->type, make_legal_output_buffer_shape(constrained_shape));
-                info() << "Output " << arg_name << ": BoundsQuery result is " << constrained_shape;
-                info() << "Output " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
-                break;
-            }
-        }
-    }
+    prepare_buffers(default_output_shape, &args);
 
     uint64_t pixels_out = calc_pixels_out(args);
     double megapixels = (double) pixels_out / (1024.0 * 1024.0);
@@ -1100,21 +1489,101 @@ int main(int argc, char **argv) {
     }
 
     {
-        std::vector<void*> filter_argv(args.size(), nullptr);
-        for (auto &arg_pair : args) {
-            auto &arg = arg_pair.second;
-            switch (arg.metadata->kind) {
-                case halide_argument_kind_input_scalar:
-                    filter_argv[arg.index] = &arg.scalar_value;
-                    break;
-                case halide_argument_kind_input_buffer:
-                case halide_argument_kind_output_buffer:
-                    filter_argv[arg.index] = arg.buffer_value.raw_buffer();
-                    break;
+        std::vector<void*> filter_argv = make_filter_argv(args);
+
+        if (benchmark && (!sweep_scales.empty() || !sweep_threads.empty())) {
+            if (sweep_scales.empty()) {
+                sweep_scales.push_back(1.0);
             }
-        }
+            if (sweep_threads.empty()) {
+                sweep_threads.push_back(0);
+            }
+            std::function<double(const std::function<void()> &)> timer;
+            if (benchmark_stats) {
+                stats_config.min_time = benchmark_min_time;
+                stats_config.max_time = std::max(benchmark_min_time * 4, stats_config.max_time);
+                timer = [&stats_config](const std::function<void()> &op) {
+                    return Halide::Tools::benchmark_stats(op, stats_config).median;
+                };
+            } else {
+                BenchmarkConfig config;
+                config.min_time = benchmark_min_time;
+                config.max_time = benchmark_min_time * 4;
+                config.min_iters = benchmark_min_iters;
+                config.max_iters = benchmark_max_iters;
+                timer = [config](const std::function<void()> &op) {
+                    return Halide::Tools::benchmark(op, config).wall_time;
+                };
+            }
+
+            std::vector<SweepPoint> points = run_sweep(args, default_output_shape, sweep_scales, sweep_threads, timer);
+
+            std::cout << "Scaling sweep for " << md->name << " ("
+                      << (benchmark_stats ? "median" : "best case") << " times):\n";
+            std::cout << std::setw(8) << "scale" << std::setw(9) << "threads" << std::setw(18) << "extents"
+                      << std::setw(14) << "sec/iter" << std::setw(12) << "mpix/sec" << std::setw(12) << "efficiency" << "\n";
+            for (const SweepPoint &p : points) {
+                std::cout << std::setw(8) << p.scale << std::setw(9) << p.threads << std::setw(18) << p.extents
+                          << std::setw(14) << p.time << std::setw(12) << (p.pixels_per_sec / (1024.0 * 1024.0))
+                          << std::setw(12) << p.efficiency << "\n";
+            }
+            if (!sweep_output.empty() && !save_sweep(sweep_output, md->name, points)) {
+                fail() << "Unable to write " << sweep_output;
+            }
+
+            // The sweep ran on copies of the buffers, so run once more on
+            // the real ones to produce the outputs.
+            info() << "Running filter...";
+            // Ignore result since our halide_error() should catch everything.
+            (void) halide_rungen_redirect_argv(&filter_argv[0]);
+        } else if (benchmark && benchmark_instances > 0) {
+            // Each instance gets its own copy of every buffer; the first
+            // uses the real ones, so that outputs can still be saved.
+            std::vector<std::vector<Buffer<>>> instance_buffers(benchmark_instances);
+            std::vector<std::vector<void*>> instance_argv(benchmark_instances, filter_argv);
+            std::vector<std::function<void()>> calls;
+            for (int i = 0; i < benchmark_instances; i++) {
+                // Reserve up front; raw_buffer() points into the Buffer.
+                instance_buffers[i].reserve(args.size());
+                for (auto &arg_pair : args) {
+                    auto &arg = arg_pair.second;
+                    if (arg.metadata->kind == halide_argument_kind_input_scalar) {
+                        continue;
+                    }
+                    instance_buffers[i].push_back(i == 0 ? arg.buffer_value : arg.buffer_value.copy());
+                    instance_argv[i][arg.index] = instance_buffers[i].back().raw_buffer();
+                }
+                calls.push_back([&instance_argv, &instance_buffers, i]() {
+                    (void) halide_rungen_redirect_argv(&instance_argv[i][0]);
+                    for (auto &b : instance_buffers[i]) {
+                        b.device_sync();
+                    }
+                });
+            }
+
+            if (benchmark_threads_per_instance == 1) {
+                halide_set_custom_do_par_for(rungen_serial_do_par_for);
+            } else if (benchmark_threads_per_instance > 1) {
+                halide_set_num_threads(benchmark_instances * benchmark_threads_per_instance);
+            }
+
+            info() << "Benchmarking throughput of " << benchmark_instances << " instances of filter...";
+
+            ThroughputResult result = run_throughput_benchmark(calls, benchmark_min_time,
+                                                               benchmark_min_iters, benchmark_max_iters);
 
-        if (benchmark) {
+            std::cout << "Throughput benchmark for " << md->name << " with " << benchmark_instances << " instances";
+            if (benchmark_threads_per_instance > 0) {
+                std::cout << " of " << benchmark_threads_per_instance << " threads each";
+            }
+            std::cout << " produces " << (result.calls / result.wall_time) << " calls/sec (over "
+                << result.calls << " calls in " << result.wall_time << " sec).\n";
+            std::cout << "Output throughput is " << (megapixels * result.calls / result.wall_time) << " mpix/sec.\n";
+            std::cout << "Latency is " << result.percentile(0.5) << " sec (p50), "
+                << result.percentile(0.99) << " sec (p99), "
+                << result.percentile(0.999) << " sec (p999), "
+                << result.latencies.back() << " sec (max).\n";
+        } else if (benchmark) {
             const auto benchmark_inner = [&filter_argv, &args]() {
                 // Ignore result since our halide_error() should catch everything.
                 (void) halide_rungen_redirect_argv(&filter_argv[0]);
@@ -1129,21 +1598,44 @@ int main(int argc, char **argv) {
                 }
             };
 
-            info() << "Benchmarking filter...";
-
-            BenchmarkConfig config;
-            config.min_time = benchmark_min_time;
-            config.max_time = benchmark_min_time * 4;
-            config.min_iters = benchmark_min_iters;
-            config.max_iters = benchmark_max_iters;
-            auto result = Halide::Tools::benchmark(benchmark_inner, config);
-
-            std::cout << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
-                << result.samples << " samples, "
-                << result.iterations << " iterations, "
-                << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n";
-            std::cout << "Best output throughput is " << (megapixels / result.wall_time) << " mpix/sec.\n";
-
+            if (benchmark_stats) {
+                info() << "Benchmarking filter...";
+
+                stats_config.min_time = benchmark_min_time;
+                stats_config.max_time = std::max(benchmark_min_time * 4, stats_config.max_time);
+                auto stats = Halide::Tools::benchmark_stats(benchmark_inner, stats_config);
+
+                std::cout << "Benchmark for " << md->name << " produces median of " << stats.median << " sec/iter "
+                    << "(95% CI " << stats.median_ci_low << " - " << stats.median_ci_high << "), "
+                    << "p90 " << stats.percentile(0.9) << ", p99 " << stats.percentile(0.99)
+                    << " (over " << stats.samples.size() << " samples, "
+                    << stats.iterations << " iterations, "
+                    << stats.outliers << " outliers).\n";
+                std::cout << "Median output throughput is " << (megapixels / stats.median) << " mpix/sec.\n";
+                if (!stats.cpu_governor.empty() && stats.cpu_governor != "performance") {
+                    warn() << "CPU frequency governor is \"" << stats.cpu_governor
+                           << "\"; results may be affected by frequency scaling.";
+                }
+                if (!benchmark_json.empty() &&
+                    !Halide::Tools::append_benchmark_json(benchmark_json, md->name, stats)) {
+                    fail() << "Unable to write " << benchmark_json;
+                }
+            } else {
+                info() << "Benchmarking filter...";
+
+                BenchmarkConfig config;
+                config.min_time = benchmark_min_time;
+                config.max_time = benchmark_min_time * 4;
+                config.min_iters = benchmark_min_iters;
+                config.max_iters = benchmark_max_iters;
+                auto result = Halide::Tools::benchmark(benchmark_inner, config);
+
+                std::cout << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
+                    << result.samples << " samples, "
+                    << result.iterations << " iterations, "
+                    << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n";
+                std::cout << "Best output throughput is " << (megapixels / result.wall_time) << " mpix/sec.\n";
+            }
         } else {
             info() << "Running filter...";
             // Ignore result since our halide_error() should catch everything.
@@ -4,8 +4,17 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <fstream>
 #include <functional>
 #include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 namespace Halide {
 namespace Tools {
@@ -117,66 +126,397 @@ struct BenchmarkResult {
     operator double() const { return wall_time; }
 };
 
-inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig& config = {}) {
-    BenchmarkResult result{0, 0, 0};
-
-    const double min_time = std::max(10 * 1e-6, config.min_time);
-    const double max_time = std::max(config.min_time, config.max_time);
-
-    const uint64_t min_iters = std::min(std::max((uint64_t)1, config.min_iters),
-                                                                            kBenchmarkMaxIterations);
-    const uint64_t max_iters = std::min(
-            std::max(config.min_iters, config.max_iters), kBenchmarkMaxIterations);
-    const double accuracy = 1.0 + std::min(std::max(0.001, config.accuracy), 0.1);
-
-    // We will do (at least) kMinSamples samples; we will do additional
-    // samples until the best the kMinSamples'th results are within the
-    // accuracy tolerance (or we run out of iterations).
-    constexpr int kMinSamples = 3;
-    double times[kMinSamples + 1] = {0};
-
-    double total_time = 0;
-    uint64_t iters_per_sample = min_iters;
-    while (result.iterations < max_iters) {
-        result.samples = 0;
-        result.iterations = 0;
-        total_time = 0;
-        for (int i = 0; i < kMinSamples; i++) {
-            times[i] = benchmark(1, iters_per_sample, op);
-            result.samples++;
-            result.iterations += iters_per_sample;
-            total_time += times[i] * iters_per_sample;
-        }
-        std::sort(times, times + kMinSamples);
-        if (times[0] * iters_per_sample * kMinSamples >= min_time) {
+// (Defined below, in terms of benchmark_stats().)
+inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig& config = {});
+
+// benchmark() above reports only the best time seen, which is a good
+// estimate of what the code can do, but hides variance and tail
+// latency. benchmark_stats() below (on which benchmark() is built)
+// instead keeps every sample and reports the distribution: median and
+// percentiles, a confidence interval for the median, and the number of
+// outliers. It can also
+// detect when the code has warmed up, flush caches between iterations
+// to measure cold-cache performance, and pin the calling thread to a
+// CPU.
+
+struct BenchmarkStatsConfig {
+    // Take samples for at least this long (seconds), not counting warm-up...
+    double min_time{0.5};
+
+    // ...and for no longer than this.
+    double max_time{5.0};
+
+    // Take at least this many samples...
+    uint64_t min_samples{10};
+
+    // ...and no more than this many.
+    uint64_t max_samples{10000};
+
+    // Time at least this many iterations together in each sample...
+    uint64_t min_iters_per_sample{1};
+
+    // ...and stop once this many iterations have been timed in total.
+    uint64_t max_iters{kBenchmarkMaxIterations};
+
+    // Once min_time and min_samples are met, stop when the confidence
+    // interval for the median is narrower than this fraction of the
+    // median, e.g. 0.01 for +/- 1%.
+    double target_relative_ci{0.01};
+
+    // The confidence level for the confidence interval, e.g. 0.95.
+    double confidence{0.95};
+
+    // If nonzero, stop instead when the third-fastest sample is within
+    // this fraction of the fastest. (This is the criterion benchmark()
+    // uses, as it reports only the fastest.)
+    double target_best_spread{0};
+
+    // Before taking samples, run the operation in windows of a few
+    // iterations until the median of a window is within this fraction
+    // of that of the previous window, or until max_warmup_time (seconds)
+    // has elapsed. This waits out cold caches, lazy initialization, and
+    // CPU frequency ramp-up. Set max_warmup_time to zero to skip it, in
+    // which case the one iteration used to size the samples is kept.
+    double warmup_tolerance{0.05};
+    double max_warmup_time{1.0};
+
+    // Time enough iterations together in each sample that a sample takes
+    // at least this long (seconds), to stay well clear of the timer's
+    // resolution. Ignored if flush_cache_bytes is nonzero.
+    double min_sample_time{1e-4};
+
+    // If nonzero, touch a buffer of this many bytes (which should be
+    // larger than the last-level cache) before every iteration, outside
+    // of the timed region, to measure cold-cache performance. Each
+    // sample is then a single iteration.
+    size_t flush_cache_bytes{0};
+
+    // If non-negative, pin the calling thread to this CPU while
+    // benchmarking. (Currently only supported on Linux. Note that this
+    // does not affect the threads of the Halide thread pool.)
+    int pin_to_cpu{-1};
+};
+
+struct BenchmarkStats {
+    // The time per iteration of each sample (seconds), sorted.
+    std::vector<double> samples;
+
+    // Total number of iterations timed, and how many iterations were
+    // run to warm up before that.
+    uint64_t iterations{0};
+    uint64_t warmup_iterations{0};
+
+    double min{0}, max{0}, mean{0}, stddev{0}, median{0};
+
+    // The confidence interval for the median, at config.confidence.
+    double median_ci_low{0}, median_ci_high{0};
+    double confidence{0};
+
+    // The number of samples above the upper Tukey fence
+    // (Q3 + 1.5 * IQR); these are usually due to interference
+    // from elsewhere in the system.
+    uint64_t outliers{0};
+
+    // Whether the calling thread was pinned as requested.
+    bool pinned{false};
+
+    // The CPU frequency governor in use when the benchmark ran, if it is
+    // known (e.g. "performance" or "powersave"). Results taken with a
+    // governor other than "performance" are prone to frequency scaling
+    // noise.
+    std::string cpu_governor;
+
+    // The time (seconds) below which the given fraction of samples fall,
+    // e.g. percentile(0.99).
+    double percentile(double p) const {
+        if (samples.empty()) {
+            return 0;
+        }
+        double pos = std::min(std::max(p, 0.0), 1.0) * (samples.size() - 1);
+        size_t i = (size_t) pos;
+        if (i + 1 >= samples.size()) {
+            return samples.back();
+        }
+        return samples[i] + (pos - i) * (samples[i + 1] - samples[i]);
+    }
+
+    // Render the summary statistics (not the individual samples) as a
+    // JSON object, for regression tracking.
+    std::string to_json(const std::string &name = "") const {
+        std::ostringstream o;
+        o.precision(9);
+        o << "{";
+        if (!name.empty()) {
+            o << "\"name\": \"" << name << "\", ";
+        }
+        o << "\"samples\": " << samples.size()
+          << ", \"iterations\": " << iterations
+          << ", \"warmup_iterations\": " << warmup_iterations
+          << ", \"min\": " << min
+          << ", \"max\": " << max
+          << ", \"mean\": " << mean
+          << ", \"stddev\": " << stddev
+          << ", \"median\": " << median
+          << ", \"p90\": " << percentile(0.9)
+          << ", \"p99\": " << percentile(0.99)
+          << ", \"p999\": " << percentile(0.999)
+          << ", \"median_ci_low\": " << median_ci_low
+          << ", \"median_ci_high\": " << median_ci_high
+          << ", \"confidence\": " << confidence
+          << ", \"outliers\": " << outliers
+          << ", \"pinned\": " << (pinned ? "true" : "false")
+          << ", \"cpu_governor\": \"" << cpu_governor << "\"}";
+        return o.str();
+    }
+};
+
+}  // namespace Tools
+
+// (Not Tools::Internal, which would make Internal:: ambiguous in code that
+// uses both the Halide and Halide::Tools namespaces.)
+namespace Internal {
+namespace Benchmark {
+
+inline double seconds_since(Tools::SteadyClock<>::type::time_point start) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(Tools::SteadyClock<>::type::now() - start).count();
+}
+
+// The z such that a standard normal variable lies within [-z, z] with
+// the given probability.
+inline double normal_two_sided_z(double confidence) {
+    double lo = 0, hi = 10;
+    for (int i = 0; i < 60; i++) {
+        double mid = (lo + hi) / 2;
+        if (std::erf(mid / std::sqrt(2.0)) < confidence) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+// A distribution-free confidence interval for the median of the sorted
+// samples, using the normal approximation to the binomial distribution
+// of the rank of the median.
+inline void median_confidence_interval(const std::vector<double> &sorted, double confidence,
+                                       double *low, double *high) {
+    const double n = (double) sorted.size();
+    const double half_width = normal_two_sided_z(confidence) * std::sqrt(n) / 2;
+    int64_t lo = (int64_t) std::floor(n / 2 - half_width);
+    int64_t hi = (int64_t) std::ceil(n / 2 + half_width);
+    *low = sorted[(size_t) std::max<int64_t>(lo, 0)];
+    *high = sorted[(size_t) std::min<int64_t>(hi, (int64_t) sorted.size() - 1)];
+}
+
+inline bool pin_thread_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+inline std::string read_cpu_governor(int cpu) {
+#ifdef __linux__
+    std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(std::max(cpu, 0)) + "/cpufreq/scaling_governor");
+    std::string governor;
+    if (f >> governor) {
+        return governor;
+    }
+#endif
+    return "";
+}
+
+// Touch every cache line of a buffer of the given size, to evict
+// whatever the benchmarked operation left in the caches.
+inline void flush_cache(std::vector<uint8_t> *buf) {
+    volatile uint8_t sink = 0;
+    for (size_t i = 0; i < buf->size(); i += 64) {
+        (*buf)[i]++;
+        sink = sink + (*buf)[i];
+    }
+    (void) sink;
+}
+
+}  // namespace Benchmark
+}  // namespace Internal
+
+namespace Tools {
+
+inline BenchmarkStats benchmark_stats(std::function<void()> op, const BenchmarkStatsConfig &config = {}) {
+    using BenchmarkClock = SteadyClock<>::type;
+    BenchmarkStats stats;
+    stats.confidence = config.confidence;
+
+#ifdef __linux__
+    cpu_set_t old_affinity;
+    bool restore_affinity = false;
+    if (config.pin_to_cpu >= 0 && sched_getaffinity(0, sizeof(old_affinity), &old_affinity) == 0) {
+        restore_affinity = stats.pinned = ::Halide::Internal::Benchmark::pin_thread_to_cpu(config.pin_to_cpu);
+    }
+#endif
+    stats.cpu_governor = ::Halide::Internal::Benchmark::read_cpu_governor(config.pin_to_cpu);
+
+    std::vector<uint8_t> flush_buf(config.flush_cache_bytes);
+    const bool cold = config.flush_cache_bytes > 0;
+
+    // Time 'iters' iterations, and return the time per iteration.
+    auto time_iters = [&](uint64_t iters) {
+        if (cold) {
+            ::Halide::Internal::Benchmark::flush_cache(&flush_buf);
+        }
+        auto start = BenchmarkClock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            op();
+        }
+        return ::Halide::Internal::Benchmark::seconds_since(start) / iters;
+    };
+
+    // Warm up. The first iteration also estimates the time per iteration.
+    constexpr int kWarmupWindow = 5;
+    const bool warm_up = config.max_warmup_time > 0;
+    auto warmup_start = BenchmarkClock::now();
+    double last_median = time_iters(1);
+    stats.warmup_iterations = 1;
+    while (warm_up && ::Halide::Internal::Benchmark::seconds_since(warmup_start) < config.max_warmup_time) {
+        double window[kWarmupWindow];
+        for (int i = 0; i < kWarmupWindow; i++) {
+            window[i] = time_iters(1);
+        }
+        stats.warmup_iterations += kWarmupWindow;
+        std::sort(window, window + kWarmupWindow);
+        double median = window[kWarmupWindow / 2];
+        bool settled = std::abs(median - last_median) <= config.warmup_tolerance * last_median;
+        last_median = median;
+        if (settled) {
             break;
         }
-        // Use an estimate based on initial times to converge faster.
-        double next_iters = std::max(min_time / std::max(times[0] * kMinSamples, 1e-9),
-                                                                 iters_per_sample * 2.0);
-        iters_per_sample = (uint64_t)(next_iters + 0.5);
     }
 
-    // - Keep taking samples until we are accurate enough (even if we run over min_time).
-    // - If we are already accurate enough but have time remaining, keep taking samples.
-    // - No matter what, don't go over max_iters or max_time; this is important, in case
-    // we happen to get faster results for the first samples, then happen to transition
-    // to throttled-down CPU state.
-    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
-                 total_time < max_time &&
-                 result.iterations < max_iters) {
-        times[kMinSamples] = benchmark(1, iters_per_sample, op);
-        result.samples++;
-        result.iterations += iters_per_sample;
-        total_time += times[kMinSamples] * iters_per_sample;
-        std::sort(times, times + kMinSamples + 1);
+    // Choose how many iterations to time together.
+    uint64_t iters_per_sample = 1;
+    if (!cold) {
+        iters_per_sample = std::max<uint64_t>(config.min_iters_per_sample, 1);
+        if (last_median * iters_per_sample < config.min_sample_time) {
+            iters_per_sample = (uint64_t) std::ceil(config.min_sample_time / std::max(last_median, 1e-9));
+        }
+    }
+
+    // Sample until we are confident enough in the median, or out of time.
+    const uint64_t min_samples = std::max<uint64_t>(config.min_samples, 1);
+    const uint64_t max_samples = std::max(config.max_samples, min_samples);
+    std::vector<double> sorted;
+    auto start = BenchmarkClock::now();
+    if (!warm_up) {
+        // Without a warm-up, the first iteration counts towards max_time
+        // and max_iters, and is the first sample if it can be.
+        start = warmup_start;
+        stats.warmup_iterations = 0;
+        stats.iterations = 1;
+        if (iters_per_sample == 1) {
+            stats.samples.push_back(last_median);
+        }
+    }
+    uint64_t next_check = min_samples;
+    while (stats.samples.size() < max_samples && stats.iterations < config.max_iters) {
+        stats.samples.push_back(time_iters(iters_per_sample));
+        stats.iterations += iters_per_sample;
+        if (stats.samples.size() < next_check) {
+            continue;
+        }
+        // Checking is O(n log n), so do it at geometrically spaced points.
+        next_check = stats.samples.size() + std::max<uint64_t>(1, stats.samples.size() / 8);
+        double elapsed = ::Halide::Internal::Benchmark::seconds_since(start);
+        if (elapsed >= config.max_time) {
+            break;
+        }
+        if (elapsed < config.min_time) {
+            continue;
+        }
+        sorted = stats.samples;
+        std::sort(sorted.begin(), sorted.end());
+        if (config.target_best_spread > 0) {
+            if (sorted.size() >= 3 && sorted[2] <= sorted[0] * (1 + config.target_best_spread)) {
+                break;
+            }
+            continue;
+        }
+        double low, high;
+        ::Halide::Internal::Benchmark::median_confidence_interval(sorted, config.confidence, &low, &high);
+        double median = sorted[sorted.size() / 2];
+        if (high - low <= 2 * config.target_relative_ci * median) {
+            break;
+        }
+    }
+
+#ifdef __linux__
+    if (restore_affinity) {
+        sched_setaffinity(0, sizeof(old_affinity), &old_affinity);
     }
-    result.wall_time = times[0];
-    result.accuracy = (times[kMinSamples - 1] / times[0]) - 1.0;
+#endif
 
+    // Summarize.
+    std::sort(stats.samples.begin(), stats.samples.end());
+    const size_t n = stats.samples.size();
+    stats.min = stats.samples.front();
+    stats.max = stats.samples.back();
+    stats.median = stats.percentile(0.5);
+    double sum = 0, sum_sq = 0;
+    for (double t : stats.samples) {
+        sum += t;
+        sum_sq += t * t;
+    }
+    stats.mean = sum / n;
+    stats.stddev = n > 1 ? std::sqrt(std::max(0.0, (sum_sq - sum * sum / n) / (n - 1))) : 0;
+    ::Halide::Internal::Benchmark::median_confidence_interval(stats.samples, config.confidence,
+                                         &stats.median_ci_low, &stats.median_ci_high);
+    const double q1 = stats.percentile(0.25), q3 = stats.percentile(0.75);
+    const double fence = q3 + 1.5 * (q3 - q1);
+    stats.outliers = (uint64_t) (stats.samples.end() -
+                                 std::upper_bound(stats.samples.begin(), stats.samples.end(), fence));
+    return stats;
+}
+
+inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig& config) {
+    BenchmarkStatsConfig stats_config;
+    stats_config.min_time = std::max(10 * 1e-6, config.min_time);
+    stats_config.max_time = std::max(config.min_time, config.max_time);
+    // benchmark() has never warmed up (beyond discarding all but the
+    // fastest samples), and its callers budget for max_time and max_iters.
+    stats_config.max_warmup_time = 0;
+    stats_config.min_samples = 3;
+    stats_config.min_iters_per_sample = std::min(std::max((uint64_t)1, config.min_iters),
+                                                 kBenchmarkMaxIterations);
+    stats_config.max_iters = std::min(std::max(config.min_iters, config.max_iters),
+                                      kBenchmarkMaxIterations);
+    // Stop on the spread of the fastest samples, as benchmark() always
+    // has, rather than on the confidence interval of the median.
+    stats_config.target_best_spread = std::min(std::max(0.001, config.accuracy), 0.1);
+
+    BenchmarkStats stats = benchmark_stats(op, stats_config);
+
+    BenchmarkResult result;
+    result.wall_time = stats.min;
+    result.samples = stats.samples.size();
+    result.iterations = stats.iterations;
+    result.accuracy = stats.samples[std::min<size_t>(2, stats.samples.size() - 1)] / stats.min - 1.0;
     return result;
 }
 
+// Append a named result to a file of newline-separated JSON objects
+// (one per benchmark), e.g. for comparison against a baseline. Returns
+// false if the file could not be written.
+inline bool append_benchmark_json(const std::string &filename, const std::string &name,
+                                  const BenchmarkStats &stats) {
+    std::ofstream f(filename, std::ios::app);
+    f << stats.to_json(name) << "\n";
+    return (bool) f;
+}
+
 }   // namespace Tools
 }   // mamespace Halide
 
@@ -8,6 +8,7 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
 #include <set>
@@ -15,6 +16,13 @@
 #include <vector>
 #include <cctype>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifndef HALIDE_NO_PNG
 #include "png.h"
 #endif
@@ -52,6 +60,82 @@ struct FormatInfo {
     }
 };
 
+// A memory mapping of a file, used by load_mapped() and save_mapped()
+// to read and write image payloads in place rather than through a
+// separate copy. Images that alias a MappedFile must not outlive it.
+// On platforms without mmap, mapping always fails, and load_mapped()
+// and save_mapped() fall back to ordinary reads and writes.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    // Map an existing file for reading. The pages are mapped
+    // copy-on-write: images aliasing them may be modified, but the
+    // modifications never reach the file.
+    bool map_for_reading(const std::string &filename) {
+        unmap();
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            map(fd, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE);
+        }
+        close(fd);
+#endif
+        return data != nullptr;
+    }
+
+    // Create (or truncate) a file of the given size and map it for
+    // writing. Writes through the mapping go to the file.
+    bool map_for_writing(const std::string &filename, size_t size) {
+        unmap();
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            return false;
+        }
+        if (size > 0 && ftruncate(fd, (off_t) size) == 0) {
+            map(fd, size, PROT_READ | PROT_WRITE, MAP_SHARED);
+        }
+        close(fd);
+#endif
+        return data != nullptr;
+    }
+
+    void unmap() {
+#ifndef _WIN32
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    uint8_t *data = nullptr;
+    size_t size = 0;
+
+private:
+#ifndef _WIN32
+    void map(int fd, size_t s, int prot, int flags) {
+        void *p = mmap(nullptr, s, prot, flags, fd, 0);
+        if (p != MAP_FAILED) {
+            data = (uint8_t *) p;
+            size = s;
+        }
+    }
+#endif
+};
+
 namespace Internal {
 
 typedef bool (*CheckFunc)(bool condition, const char* msg);
@@ -233,31 +317,36 @@ inline std::string get_lowercase_extension(const std::string &path) {
     return to_lowercase(path.substr(last_dot + 1));
 }
 
-template<typename ElemType>
-ElemType read_big_endian(const uint8_t *src);
-
-template<>
-inline uint8_t read_big_endian(const uint8_t *src) {
-    return *src;
+inline bool host_is_little_endian() {
+    const uint16_t one = 1;
+    return *((const uint8_t *) &one) == 1;
 }
 
-template<>
-inline uint16_t read_big_endian(const uint8_t *src) {
-    return (((uint16_t) src[0]) << 8) | ((uint16_t) src[1]);
+// Swap the bytes of each of a run of 16-bit samples, in place.
+inline void swap_bytes_16(uint8_t *data, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        const uint8_t lo = data[2 * i];
+        data[2 * i] = data[2 * i + 1];
+        data[2 * i + 1] = lo;
+    }
 }
 
-template<typename ElemType>
-void write_big_endian(const ElemType &src, uint8_t *dst);
-
-template<>
-inline void write_big_endian(const uint8_t &src, uint8_t *dst) {
-    *dst = src;
+// fseek()/ftell() take a long, which is only 32 bits on some platforms
+// (e.g. Windows); use the 64-bit variants so large files work everywhere.
+inline int seek_file(FILE *f, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t) offset, SEEK_SET);
+#endif
 }
 
-template<>
-inline void write_big_endian(const uint16_t &src, uint8_t *dst) {
-    dst[0] = src >> 8;
-    dst[1] = src & 0xff;
+inline int64_t tell_file(FILE *f) {
+#ifdef _WIN32
+    return _ftelli64(f);
+#else
+    return (int64_t) ftello(f);
+#endif
 }
 
 struct FileOpener {
@@ -324,51 +413,106 @@ struct FileOpener {
     FILE * const f;
 };
 
-// Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
-// Multibyte elements are assumed to be big-endian.
+// The memory layout of one row of an image with dimensions (x, y) or
+// (x, y, c).
+template<typename ElemType>
+struct ImageRow {
+    // The sample at the min x and c coordinates of the row.
+    ElemType *data;
+    int width, channels;
+    int x_stride, c_stride;
+};
+
 template<typename ElemType, typename ImageType>
-void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
-    auto im_typed = im->template as<ElemType>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c+cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
+ImageRow<ElemType> image_row(const ImageType &im, int y) {
+    ImageRow<ElemType> r;
+    // data() is the address of the min coordinates. (begin() is the lowest
+    // address, which differs when a stride is negative.)
+    r.data = (ElemType *) im.data() + (int64_t) (y - im.dim(1).min()) * im.dim(1).stride();
+    r.width = im.dim(0).extent();
+    r.x_stride = im.dim(0).stride();
+    r.channels = im.dimensions() > 2 ? im.dim(2).extent() : 1;
+    r.c_stride = im.dimensions() > 2 ? im.dim(2).stride() : 0;
+    return r;
+}
+
+// Copy a row of interleaved samples into an image row, one channel at
+// a time. The number of channels is a template parameter (zero means
+// it is only known at runtime), so that the strided loads compile to
+// vector shuffles.
+template<typename ElemType, int kChannels>
+void deinterleave_row(const ElemType *src, const ImageRow<ElemType> &dst) {
+    const int channels = kChannels ? kChannels : dst.channels;
+    for (int c = 0; c < channels; c++) {
+        ElemType *d = dst.data + c * dst.c_stride;
+        const ElemType *s = src + c;
+        if (dst.x_stride == 1) {
+            for (int x = 0; x < dst.width; x++) {
+                d[x] = s[x * channels];
+            }
+        } else {
+            for (int x = 0; x < dst.width; x++) {
+                d[x * dst.x_stride] = s[x * channels];
             }
-        }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
         }
     }
 }
 
-// Copy a row from an image into a byte buffer.
-// Multibyte elements are written in big-endian layout.
-template<typename ElemType, typename ImageType>
-void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
-    auto im_typed = im.template as<ElemType>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
+// The inverse of deinterleave_row.
+template<typename ElemType, int kChannels>
+void interleave_row(const ImageRow<ElemType> &src, ElemType *dst) {
+    const int channels = kChannels ? kChannels : src.channels;
+    for (int c = 0; c < channels; c++) {
+        const ElemType *s = src.data + c * src.c_stride;
+        ElemType *d = dst + c;
+        if (src.x_stride == 1) {
+            for (int x = 0; x < src.width; x++) {
+                d[x * channels] = s[x];
+            }
+        } else {
+            for (int x = 0; x < src.width; x++) {
+                d[x * channels] = s[x * src.x_stride];
             }
         }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
-        }
+    }
+}
+
+// Copy a row of interleaved ElemTypes in native byte order from a byte
+// buffer into a specific image row.
+template<typename ElemType, typename ImageType>
+void read_interleaved_row(const uint8_t *src, int y, ImageType *im) {
+    const ImageRow<ElemType> dst = image_row<ElemType>(*im, y);
+    const ElemType *typed_src = (const ElemType *) src;
+    if (dst.x_stride == dst.channels && (dst.channels == 1 || dst.c_stride == 1)) {
+        // The image is interleaved too.
+        memcpy(dst.data, src, (size_t) dst.width * dst.channels * sizeof(ElemType));
+        return;
+    }
+    switch (dst.channels) {
+    case 1: deinterleave_row<ElemType, 1>(typed_src, dst); break;
+    case 2: deinterleave_row<ElemType, 2>(typed_src, dst); break;
+    case 3: deinterleave_row<ElemType, 3>(typed_src, dst); break;
+    case 4: deinterleave_row<ElemType, 4>(typed_src, dst); break;
+    default: deinterleave_row<ElemType, 0>(typed_src, dst); break;
+    }
+}
+
+// Copy a row from an image into a byte buffer, interleaving the
+// channels, in native byte order.
+template<typename ElemType, typename ImageType>
+void write_interleaved_row(const ImageType &im, int y, uint8_t *dst) {
+    const ImageRow<ElemType> src = image_row<ElemType>(im, y);
+    ElemType *typed_dst = (ElemType *) dst;
+    if (src.x_stride == src.channels && (src.channels == 1 || src.c_stride == 1)) {
+        memcpy(dst, src.data, (size_t) src.width * src.channels * sizeof(ElemType));
+        return;
+    }
+    switch (src.channels) {
+    case 1: interleave_row<ElemType, 1>(src, typed_dst); break;
+    case 2: interleave_row<ElemType, 2>(src, typed_dst); break;
+    case 3: interleave_row<ElemType, 3>(src, typed_dst); break;
+    case 4: interleave_row<ElemType, 4>(src, typed_dst); break;
+    default: interleave_row<ElemType, 0>(src, typed_dst); break;
     }
 }
 
@@ -424,11 +568,17 @@ bool load_png(const std::string &filename, ImageType *im) {
 
     *im = ImageType(im_type, im_dimensions);
 
+    // PNG stores 16-bit samples big-endian. Have libpng swap them as
+    // it decodes, rather than doing it per-sample ourselves.
+    if (bit_depth == 16 && Internal::host_is_little_endian()) {
+        png_set_swap(png_ptr);
+    }
+
     png_read_update_info(png_ptr, info_ptr);
 
     auto copy_to_image = bit_depth == 8 ?
-        Internal::read_big_endian_row<uint8_t, ImageType> :
-        Internal::read_big_endian_row<uint16_t, ImageType>;
+        Internal::read_interleaved_row<uint8_t, ImageType> :
+        Internal::read_interleaved_row<uint16_t, ImageType>;
 
     std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
     const int ymin = im->dim(1).min();
@@ -509,9 +659,13 @@ bool save_png(ImageType &im, const std::string &filename) {
 
     png_write_info(png_ptr, info_ptr);
 
+    if (bit_depth == 16 && Internal::host_is_little_endian()) {
+        png_set_swap(png_ptr);
+    }
+
     auto copy_from_image = bit_depth == 8 ?
-        Internal::write_big_endian_row<uint8_t, ImageType> :
-        Internal::write_big_endian_row<uint16_t, ImageType>;
+        Internal::write_interleaved_row<uint8_t, ImageType> :
+        Internal::write_interleaved_row<uint16_t, ImageType>;
 
     std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
     const int ymin = im.dim(1).min();
@@ -583,8 +737,11 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
     *im = ImageType(im_type, im_dimensions);
 
     auto copy_to_image = bit_depth == 8 ?
-        Internal::read_big_endian_row<uint8_t, ImageType> :
-        Internal::read_big_endian_row<uint16_t, ImageType>;
+        Internal::read_interleaved_row<uint8_t, ImageType> :
+        Internal::read_interleaved_row<uint16_t, ImageType>;
+
+    // 16-bit samples are stored big-endian.
+    const bool swap = bit_depth == 16 && host_is_little_endian();
 
     std::vector<uint8_t> row(width * channels * (bit_depth / 8));
     const int ymin = im->dim(1).min();
@@ -593,6 +750,9 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
         if (!check(f.read_vector(&row), "Could not read data")) {
             return false;
         }
+        if (swap) {
+            swap_bytes_16(row.data(), width * channels);
+        }
         copy_to_image(row.data(), y, im);
     }
 
@@ -622,14 +782,19 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
     fprintf(f.f, "%s\n%d %d\n%d\n", hdr_fmt, width, height, (1<<bit_depth)-1);
 
     auto copy_from_image = bit_depth == 8 ?
-        Internal::write_big_endian_row<uint8_t, ImageType> :
-        Internal::write_big_endian_row<uint16_t, ImageType>;
+        Internal::write_interleaved_row<uint8_t, ImageType> :
+        Internal::write_interleaved_row<uint16_t, ImageType>;
+
+    const bool swap = bit_depth == 16 && host_is_little_endian();
 
     std::vector<uint8_t> row(width * channels * (bit_depth / 8));
     const int ymin = im.dim(1).min();
     const int ymax = im.dim(1).max();
     for (int y = ymin; y <= ymax; ++y) {
         copy_from_image(im, y, row.data());
+        if (swap) {
+            swap_bytes_16(row.data(), width * channels);
+        }
         if (!check(f.write_vector(row), "Could not write data")) {
             return false;
         }
@@ -706,7 +871,7 @@ bool load_jpg(const std::string &filename, ImageType *im) {
     }
     *im = ImageType(im_type, im_dimensions);
 
-    auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
+    auto copy_to_image = Internal::read_interleaved_row<uint8_t, ImageType>;
 
     std::vector<uint8_t> row(width * channels);
     const int ymin = im->dim(1).min();
@@ -765,7 +930,7 @@ bool save_jpg(ImageType &im, const std::string &filename) {
     jpeg_set_quality(&cinfo, quality, TRUE);
     jpeg_start_compress(&cinfo, TRUE);
 
-    auto copy_from_image = Internal::write_big_endian_row<uint8_t, ImageType>;
+    auto copy_from_image = Internal::write_interleaved_row<uint8_t, ImageType>;
 
     std::vector<uint8_t> row(width * channels);
     const int ymin = im.dim(1).min();
@@ -802,12 +967,18 @@ inline const halide_type_t *tmp_code_to_halide_type() {
     return tmp_code_to_halide_type_;
 }
 
+// Given something like ImageType<Foo>, produce typedef ImageType<Bar>
+template<typename ImageType, typename ElemType>
+struct ImageTypeWithElemType {
+    using type = decltype(std::declval<ImageType>().template as<ElemType>());
+};
+
 // return true iff the buffer storage has no padding between
 // any elements, and is in strictly planar order.
 template<typename ImageType>
 bool buffer_is_compact_planar(ImageType &im) {
     const halide_type_t im_type = im.type();
-    const size_t elem_size = (im_type.bits / 8);
+    const size_t elem_size = im_type.bytes();
     if (((uint8_t*)im.begin() + (im.number_of_elements() * elem_size)) != (uint8_t*) im.end()) {
         return false;
     }
@@ -825,12 +996,8 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
-// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_tmp(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
+template<CheckFunc check>
+bool read_tmp_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
     if (!check(f.f != nullptr, "File could not be opened for reading")) {
         return false;
     }
@@ -845,8 +1012,22 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = { header[0], header[1], header[2], header[3] };
+    *type = tmp_code_to_halide_type()[header[4]];
+    *extents = { header[0], header[1], header[2], header[3] };
+    return true;
+}
+
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_tmp(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
+        return false;
+    }
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -883,15 +1064,32 @@ template<typename ImageType, CheckFunc check = CheckReturn>
 bool write_planar_payload(ImageType &im, FileOpener &f) {
     if (im.dimensions() == 0 || buffer_is_compact_planar(im)) {
         // Contiguous buffer! Write it all in one swell foop.
-        if (!check(f.write_bytes(im.begin(), im.size_in_bytes()), "Count not write .tmp payload")) {
+        if (!check(f.write_bytes(im.begin(), im.size_in_bytes()), "Could not write image payload")) {
             return false;
         }
     } else {
-        // We have to do this the hard way.
-        int d = im.dimensions() - 1;
-        for (int i = im.dim(d).min(); i <= im.dim(d).max(); i++) {
-            ImageType slice = im.sliced(d, i);
-            if (!write_planar_payload(slice, f)) {
+        // Gather one slice of the outermost dimension at a time into a
+        // dense scratch buffer and write that. (Recursing down to the
+        // elements of e.g. an interleaved image would mean one write per
+        // sample.)
+        using DynamicImageType = typename ImageTypeWithElemType<ImageType, void>::type;
+        const int d = im.dimensions() - 1;
+        const int slice_dims = std::max(d, 1);
+        std::vector<int> extents(slice_dims), mins(slice_dims);
+        for (int i = 0; i < slice_dims; i++) {
+            extents[i] = im.dim(i).extent();
+            mins[i] = im.dim(i).min();
+        }
+        DynamicImageType scratch(im.type(), extents);
+        scratch.translate(mins);
+        const int slices = d > 0 ? im.dim(d).extent() : 1;
+        for (int i = 0; i < slices; i++) {
+            if (d > 0) {
+                scratch.copy_from(im.sliced(d, im.dim(d).min() + i));
+            } else {
+                scratch.copy_from(im);
+            }
+            if (!check(f.write_bytes(scratch.begin(), scratch.size_in_bytes()), "Could not write image payload")) {
                 return false;
             }
         }
@@ -899,17 +1097,15 @@ bool write_planar_payload(ImageType &im, FileOpener &f) {
     return true;
 }
 
-// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_tmp(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    im.copy_to_host();
-
-    int32_t header[5] = { 1, 1, 1, 1, -1 };
-    for (int i = 0; i < im.dimensions(); ++i) {
-        header[i] = im.dim(i).extent();
+template<typename ImageType, CheckFunc check>
+bool make_tmp_header(const ImageType &im, int32_t (&header)[5]) {
+    if (!check(im.dimensions() <= 4, "Too many dimensions for .tmp file")) {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i) {
+        header[i] = i < im.dimensions() ? im.dim(i).extent() : 1;
     }
+    header[4] = -1;
     auto *table = tmp_code_to_halide_type();
     for (int i = 0; i < kNumTmpCodes; i++) {
         if (im.type() == table[i]) {
@@ -917,7 +1113,18 @@ bool save_tmp(ImageType &im, const std::string &filename) {
             break;
         }
     }
-    if (!check(header[4] >= 0, "Unsupported type for .tmp file")) {
+    return check(header[4] >= 0, "Unsupported type for .tmp file");
+}
+
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_tmp(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    int32_t header[5];
+    if (!make_tmp_header<ImageType, check>(im, header)) {
         return false;
     }
 
@@ -973,11 +1180,8 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
+template<CheckFunc check>
+bool read_mat_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
     if (!check(f.f != nullptr, "File could not be opened for reading")) {
         return false;
     }
@@ -1014,8 +1218,8 @@ bool load_mat(const std::string &filename, ImageType *im) {
         return false;
     }
     int dims = shape_header[1]/4;
-    std::vector<int> extents(dims);
-    if (!check(f.read_vector(&extents), "Could not read .mat header\n")) {
+    extents->resize(dims);
+    if (!check(f.read_vector(extents), "Could not read .mat header\n")) {
         return false;
     }
     if (dims & 1) {
@@ -1049,38 +1253,53 @@ bool load_mat(const std::string &filename, ImageType *im) {
     if (!check(f.read_array(payload_header), "Could not read .mat header\n")) {
         return false;
     }
-    halide_type_t type;
     switch (payload_header[0]) {
     case miINT8:
-        type = halide_type_of<int8_t>();
+        *type = halide_type_of<int8_t>();
         break;
     case miINT16:
-        type = halide_type_of<int16_t>();
+        *type = halide_type_of<int16_t>();
         break;
     case miINT32:
-        type = halide_type_of<int32_t>();
+        *type = halide_type_of<int32_t>();
         break;
     case miINT64:
-        type = halide_type_of<int64_t>();
+        *type = halide_type_of<int64_t>();
         break;
     case miUINT8:
-        type = halide_type_of<uint8_t>();
+        *type = halide_type_of<uint8_t>();
         break;
     case miUINT16:
-        type = halide_type_of<uint16_t>();
+        *type = halide_type_of<uint16_t>();
         break;
     case miUINT32:
-        type = halide_type_of<uint32_t>();
+        *type = halide_type_of<uint32_t>();
         break;
     case miUINT64:
-        type = halide_type_of<uint64_t>();
+        *type = halide_type_of<uint64_t>();
         break;
     case miSINGLE:
-        type = halide_type_of<float>();
+        *type = halide_type_of<float>();
         break;
     case miDOUBLE:
-        type = halide_type_of<double>();
+        *type = halide_type_of<double>();
         break;
+    default:
+        return check(false, "Could not parse this .mat file: unsupported payload type\n");
+    }
+
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    halide_type_t type;
+    std::vector<int> extents;
+    if (!read_mat_header<check>(f, &type, &extents)) {
+        return false;
     }
 
     *im = ImageType(type, extents);
@@ -1306,6 +1525,286 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// ".npy" is the NumPy array format documented here:
+// https://docs.scipy.org/doc/numpy/neps/npy-format.html
+//
+// Halide's dimension order is the reverse of NumPy's: dimension 0 of
+// the image is the last (fastest-varying) axis of a C-order array. So
+// a NumPy array of shape (height, width, channels) loads as an
+// interleaved image with extents (channels, width, height), and a
+// planar Halide image of extents (width, height, channels) saves as an
+// array of shape (channels, height, width). Fortran-order arrays load
+// with their axes in the same order as the image.
+
+constexpr int kNumNpyTypes = 12;
+
+// The type codes NumPy uses for each Halide type, without the
+// byte-order character.
+inline const std::pair<const char *, halide_type_t> *npy_dtypes() {
+    static const std::pair<const char *, halide_type_t> npy_dtypes_[kNumNpyTypes] = {
+      { "b1", halide_type_t(halide_type_uint, 1) },
+      { "i1", halide_type_t(halide_type_int, 8) },
+      { "i2", halide_type_t(halide_type_int, 16) },
+      { "i4", halide_type_t(halide_type_int, 32) },
+      { "i8", halide_type_t(halide_type_int, 64) },
+      { "u1", halide_type_t(halide_type_uint, 8) },
+      { "u2", halide_type_t(halide_type_uint, 16) },
+      { "u4", halide_type_t(halide_type_uint, 32) },
+      { "u8", halide_type_t(halide_type_uint, 64) },
+      { "f2", halide_type_t(halide_type_float, 16) },
+      { "f4", halide_type_t(halide_type_float, 32) },
+      { "f8", halide_type_t(halide_type_float, 64) },
+    };
+    return npy_dtypes_;
+}
+
+// Everything we need from a .npy header.
+struct NpyHeader {
+    halide_type_t type;
+    // In Halide's dimension order (see above).
+    std::vector<int> extents;
+    // The offset of the payload from the start of the file.
+    size_t data_offset;
+};
+
+// Find the value for the given key in the Python dict literal that
+// makes up a .npy header, e.g. "'<f4'" for "descr".
+inline std::string npy_header_value(const std::string &dict, const std::string &key) {
+    size_t pos = dict.find("'" + key + "'");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos = dict.find(':', pos);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos = dict.find_first_not_of(" ", pos + 1);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    size_t end;
+    if (dict[pos] == '(') {
+        end = dict.find(')', pos);
+        return end == std::string::npos ? "" : dict.substr(pos, end - pos + 1);
+    } else if (dict[pos] == '\'') {
+        end = dict.find('\'', pos + 1);
+        return end == std::string::npos ? "" : dict.substr(pos, end - pos + 1);
+    } else {
+        end = dict.find_first_of(",}", pos);
+        return end == std::string::npos ? "" : dict.substr(pos, end - pos);
+    }
+}
+
+template<CheckFunc check>
+bool read_npy_header(FileOpener &f, NpyHeader *header) {
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    uint8_t magic[8];
+    if (!check(f.read_array(magic), "Could not read .npy header")) {
+        return false;
+    }
+    if (!check(memcmp(magic, "\x93NUMPY", 6) == 0, "File is not recognized as a .npy file")) {
+        return false;
+    }
+    const int major_version = magic[6];
+    if (!check(major_version >= 1 && major_version <= 3, "Unsupported .npy version")) {
+        return false;
+    }
+
+    uint32_t dict_len;
+    size_t len_size;
+    if (major_version == 1) {
+        uint8_t len[2];
+        if (!check(f.read_array(len), "Could not read .npy header")) {
+            return false;
+        }
+        dict_len = len[0] | (len[1] << 8);
+        len_size = 2;
+    } else {
+        uint8_t len[4];
+        if (!check(f.read_array(len), "Could not read .npy header")) {
+            return false;
+        }
+        dict_len = len[0] | (len[1] << 8) | (len[2] << 16) | ((uint32_t) len[3] << 24);
+        len_size = 4;
+    }
+
+    std::string dict(dict_len, ' ');
+    if (!check(f.read_bytes(&dict[0], dict_len), "Could not read .npy header")) {
+        return false;
+    }
+    header->data_offset = sizeof(magic) + len_size + dict_len;
+
+    // The dtype: a byte-order character followed by a type code.
+    std::string descr = npy_header_value(dict, "descr");
+    if (!check(descr.size() == 5, "Unsupported dtype in .npy file")) {
+        return false;
+    }
+    const char byte_order = descr[1];
+    const bool native = byte_order == '|' || byte_order == '=' ||
+        (byte_order == '<') == host_is_little_endian();
+    if (!check(native, "Can't load .npy files with non-native byte order")) {
+        return false;
+    }
+    const std::string code = descr.substr(2, 2);
+    const auto *dtypes = npy_dtypes();
+    int i = 0;
+    while (i < kNumNpyTypes && code != dtypes[i].first) {
+        i++;
+    }
+    if (!check(i < kNumNpyTypes, "Unsupported dtype in .npy file")) {
+        return false;
+    }
+    header->type = dtypes[i].second;
+
+    const std::string fortran_order = npy_header_value(dict, "fortran_order");
+    if (!check(fortran_order == "True" || fortran_order == "False", "Could not parse .npy header")) {
+        return false;
+    }
+
+    // The shape is a Python tuple, e.g. "(480, 640, 3)", "(10,)" or "()".
+    const std::string shape = npy_header_value(dict, "shape");
+    if (!check(shape.size() >= 2, "Could not parse .npy header")) {
+        return false;
+    }
+    header->extents.clear();
+    const char *p = shape.c_str() + 1;
+    while (true) {
+        char *end;
+        long long extent = strtoll(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        if (!check(extent >= 0 && extent <= 0x7fffffff, "Array in .npy file is too large")) {
+            return false;
+        }
+        header->extents.push_back((int) extent);
+        p = end;
+        while (*p == ',' || *p == ' ' || *p == 'L') {
+            p++;
+        }
+    }
+    if (fortran_order == "False") {
+        std::reverse(header->extents.begin(), header->extents.end());
+    }
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    NpyHeader header;
+    if (!read_npy_header<check>(f, &header)) {
+        return false;
+    }
+
+    *im = ImageType(header.type, header.extents);
+
+    // This should never fail unless the default Buffer<> constructor behavior changes.
+    if (!check(buffer_is_compact_planar(*im), "load_npy() requires compact planar images")) {
+        return false;
+    }
+
+    if (!check(f.read_bytes(im->begin(), im->size_in_bytes()), "Could not read .npy payload")) {
+        return false;
+    }
+
+    im->set_host_dirty();
+    return true;
+}
+
+inline const std::set<FormatInfo> &query_npy() {
+    // Any number of dimensions is allowed. Our support arbitrarily stops at 16.
+    static std::set<FormatInfo> info = []() {
+        std::set<FormatInfo> s;
+        for (int i = 0; i < 16; i++) {
+            for (int j = 0; j < kNumNpyTypes; j++) {
+                s.insert({ npy_dtypes()[j].second, i });
+            }
+        }
+        return s;
+    }();
+    return info;
+}
+
+// Make the header for a C-order array of the given type and shape (in
+// Halide's dimension order), padded to a multiple of 64 bytes as the
+// format recommends.
+template<CheckFunc check>
+bool make_npy_header(halide_type_t type, const std::vector<int> &extents, std::string *header) {
+    const auto *dtypes = npy_dtypes();
+    int i = 0;
+    while (i < kNumNpyTypes && !(type == dtypes[i].second)) {
+        i++;
+    }
+    if (!check(i < kNumNpyTypes, "Unsupported type for .npy file")) {
+        return false;
+    }
+    const char byte_order = type.bytes() == 1 ? '|' : (host_is_little_endian() ? '<' : '>');
+
+    const int dims = (int) extents.size();
+    std::string dict = std::string("{'descr': '") + byte_order + dtypes[i].first +
+        "', 'fortran_order': False, 'shape': (";
+    for (int d = dims - 1; d >= 0; d--) {
+        dict += std::to_string(extents[d]);
+        if (d > 0 || dims == 1) {
+            dict += ",";
+        }
+        if (d > 0) {
+            dict += " ";
+        }
+    }
+    dict += "), }";
+
+    // Magic, version, 2-byte length, dict, padding, and a newline.
+    const size_t unpadded = 10 + dict.size() + 1;
+    dict += std::string((64 - unpadded % 64) % 64, ' ') + "\n";
+    if (!check(dict.size() < 65536, "Too many dimensions for .npy file")) {
+        return false;
+    }
+
+    *header = std::string("\x93NUMPY\x01\x00", 8);
+    *header += (char) (dict.size() & 0xff);
+    *header += (char) (dict.size() >> 8);
+    *header += dict;
+    return true;
+}
+
+template<typename ImageType, CheckFunc check>
+bool make_npy_header(const ImageType &im, std::string *header) {
+    std::vector<int> extents(im.dimensions());
+    for (int d = 0; d < im.dimensions(); d++) {
+        extents[d] = im.dim(d).extent();
+    }
+    return make_npy_header<check>(im.type(), extents, header);
+}
+
+// "im" is not const-ref because copy_to_host() is not const.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_npy(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    std::string header;
+    if (!make_npy_header<ImageType, check>(im, &header)) {
+        return false;
+    }
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!check(f.write_bytes(header.data(), header.size()), "Could not write .npy header")) {
+        return false;
+    }
+
+    return write_planar_payload<ImageType, check>(im, f);
+}
 
 template<typename ImageType, Internal::CheckFunc check>
 struct ImageIO {
@@ -1329,7 +1828,8 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
 #endif
         {"ppm", {load_ppm<ImageType, check>, save_ppm<ImageType, check>, query_ppm}},
         {"tmp", {load_tmp<ImageType, check>, save_tmp<ImageType, check>, query_tmp}},
-        {"mat", {load_mat<ImageType, check>, save_mat<ImageType, check>, query_mat}}
+        {"mat", {load_mat<ImageType, check>, save_mat<ImageType, check>, query_mat}},
+        {"npy", {load_npy<ImageType, check>, save_npy<ImageType, check>, query_npy}}
     };
     std::string ext = Internal::get_lowercase_extension(filename);
     auto it = m.find(ext);
@@ -1346,12 +1846,6 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
     return check(false, err.c_str());
 }
 
-// Given something like ImageType<Foo>, produce typedef ImageType<Bar>
-template<typename ImageType, typename ElemType>
-struct ImageTypeWithElemType {
-    using type = decltype(std::declval<ImageType>().template as<ElemType>());
-};
-
 // Must be constexpr to allow use in case clauses.
 inline constexpr int halide_type_code(halide_type_code_t code, int bits) {
     return (((int) code) << 8) | bits;
@@ -1385,6 +1879,70 @@ FormatInfo best_save_format(const ImageType &im, const std::set<FormatInfo> &inf
     return best;
 }
 
+// Make a dense planar shape with the given extents (and mins, if given).
+inline std::vector<halide_dimension_t> make_planar_shape(const std::vector<int> &extents,
+                                                         const std::vector<int> &mins = {}) {
+    std::vector<halide_dimension_t> shape(extents.size());
+    int stride = 1;
+    for (size_t i = 0; i < extents.size(); i++) {
+        shape[i] = halide_dimension_t(i < mins.size() ? mins[i] : 0, extents[i], stride);
+        stride *= extents[i];
+    }
+    return shape;
+}
+
+// Read the header of an image file whose payload is stored
+// uncompressed and in native byte order, and return the type and
+// shape of the payload, and its offset in bytes from the start of the
+// file. Returns false for formats (or particular files) whose payload
+// cannot be used in place.
+inline bool read_mappable_header(const std::string &filename, halide_type_t *type,
+                                 std::vector<halide_dimension_t> *shape, size_t *offset) {
+    const std::string ext = get_lowercase_extension(filename);
+    FileOpener f(filename, "rb");
+    std::vector<int> extents;
+    if (ext == "tmp") {
+        if (!read_tmp_header<CheckReturn>(f, type, &extents)) {
+            return false;
+        }
+        *shape = make_planar_shape(extents);
+    } else if (ext == "mat") {
+        if (!read_mat_header<CheckReturn>(f, type, &extents)) {
+            return false;
+        }
+        *shape = make_planar_shape(extents);
+    } else if (ext == "npy") {
+        NpyHeader header;
+        if (!read_npy_header<CheckReturn>(f, &header)) {
+            return false;
+        }
+        *type = header.type;
+        *shape = make_planar_shape(header.extents);
+    } else if (ext == "pgm" || ext == "ppm") {
+        // Only 8-bit files: 16-bit files are stored big-endian.
+        const int channels = ext == "ppm" ? 3 : 1;
+        int width, height, bit_depth;
+        if (!read_pnm_header<CheckReturn>(f, channels == 3 ? "P6" : "P5", &width, &height, &bit_depth) ||
+            bit_depth != 8) {
+            return false;
+        }
+        *type = halide_type_t(halide_type_uint, 8);
+        *shape = { halide_dimension_t(0, width, channels),
+                   halide_dimension_t(0, height, width * channels) };
+        if (channels > 1) {
+            shape->push_back(halide_dimension_t(0, channels, 1));
+        }
+    } else {
+        return false;
+    }
+    int64_t pos = tell_file(f.f);
+    if (pos < 0) {
+        return false;
+    }
+    *offset = (size_t) pos;
+    return true;
+}
+
 }  // namespace Internal
 
 struct ImageTypeConversion {
@@ -1623,6 +2181,237 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// Load the Image from the given file without copying its payload, by
+// memory-mapping the file and returning an Image that aliases the
+// mapped pages. This works for formats that store their payload
+// uncompressed and in native byte order (.tmp, .mat, .npy, and 8-bit
+// .pgm and .ppm); for anything else, or if the file can't be mapped, this
+// falls back to load() and leaves the MappedFile unmapped. The pages
+// are mapped copy-on-write, so writing to the Image does not modify the
+// file. The Image must not outlive the MappedFile.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, MappedFile *file, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    halide_type_t type;
+    std::vector<halide_dimension_t> shape;
+    size_t offset = 0;
+    if (Internal::read_mappable_header(filename, &type, &shape, &offset) &&
+        file->map_for_reading(filename)) {
+        size_t payload_bytes = type.bytes();
+        for (const auto &d : shape) {
+            payload_bytes *= d.extent;
+        }
+        // The mapping is page-aligned, so this ensures each element is
+        // naturally aligned.
+        const bool aligned = (offset % type.bytes()) == 0;
+        if (aligned && offset + payload_bytes <= file->size) {
+            if (ImageType::has_static_halide_type) {
+                const halide_type_t expected_type = ImageType::static_halide_type();
+                if (!check(type == expected_type, "Image loaded did not match the expected type")) {
+                    file->unmap();
+                    return false;
+                }
+            }
+            DynamicImageType im_d(type, file->data + offset, (int) shape.size(), shape.data());
+            *im = im_d.template as<typename ImageType::ElemType>();
+            im->set_host_dirty();
+            return true;
+        }
+        file->unmap();
+    }
+    return load<ImageType, check>(filename, im);
+}
+
+// Save the Image by memory-mapping the output file and copying the
+// payload directly into the mapped pages, rather than through stdio.
+// This works for .tmp and .npy files; other formats fall back to save().
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_mapped(ImageType &im, const std::string &filename) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    const std::string ext = Internal::get_lowercase_extension(filename);
+    if (ext != "tmp" && ext != "npy") {
+        return save<ImageType, check>(im, filename);
+    }
+
+    im.copy_to_host();
+
+    std::string header;
+    if (ext == "tmp") {
+        int32_t tmp_header[5];
+        if (!Internal::make_tmp_header<ImageType, check>(im, tmp_header)) {
+            return false;
+        }
+        header.assign((const char *) tmp_header, sizeof(tmp_header));
+    } else {
+        if (!Internal::make_npy_header<ImageType, check>(im, &header)) {
+            return false;
+        }
+    }
+
+    std::vector<int> extents(im.dimensions()), mins(im.dimensions());
+    for (int i = 0; i < im.dimensions(); i++) {
+        extents[i] = im.dim(i).extent();
+        mins[i] = im.dim(i).min();
+    }
+    const size_t payload_bytes = im.number_of_elements() * im.type().bytes();
+
+    MappedFile file;
+    if (!file.map_for_writing(filename, header.size() + payload_bytes)) {
+        return save<ImageType, check>(im, filename);
+    }
+    memcpy(file.data, header.data(), header.size());
+
+    std::vector<halide_dimension_t> shape = Internal::make_planar_shape(extents, mins);
+    DynamicImageType payload(im.type(), file.data + header.size(), (int) shape.size(), shape.data());
+    payload.copy_from(im.template as<void>());
+    return true;
+}
+
+namespace Internal {
+
+// Read (or write) the region of the array in an existing .npy file that
+// is covered by the image, touching only that part of the file. Each row
+// of the region along dimension 0 is contiguous in the file.
+template<typename ImageType, CheckFunc check>
+bool transfer_npy_region(const std::string &filename, ImageType *im, bool writing) {
+    FileOpener f(filename, writing ? "r+b" : "rb");
+    NpyHeader header;
+    if (!read_npy_header<check>(f, &header)) {
+        return false;
+    }
+    if (!check(im->type() == header.type, "Image type does not match .npy file")) {
+        return false;
+    }
+    if (!check(im->dimensions() == (int) header.extents.size(), "Image dimensions do not match .npy file")) {
+        return false;
+    }
+    for (int i = 0; i < im->dimensions(); i++) {
+        if (!check(im->dim(i).min() >= 0 && im->dim(i).max() < header.extents[i],
+                   "Region is outside of the array in .npy file")) {
+            return false;
+        }
+    }
+
+    const int elem_size = im->type().bytes();
+    const int row_elems = im->dimensions() > 0 ? im->dim(0).extent() : 1;
+    const bool row_is_dense = im->dimensions() == 0 || im->dim(0).stride() == 1;
+    const int64_t stride_bytes = im->dimensions() > 0 ? (int64_t) im->dim(0).stride() * elem_size : 0;
+    std::vector<uint8_t> scratch(row_is_dense ? 0 : (size_t) row_elems * elem_size);
+
+    std::vector<int> pos(im->dimensions());
+    for (int i = 0; i < im->dimensions(); i++) {
+        pos[i] = im->dim(i).min();
+    }
+    while (true) {
+        // Find the row in the file and in the image.
+        int64_t file_offset = 0, file_stride = 1, im_offset = 0;
+        for (int i = 0; i < im->dimensions(); i++) {
+            file_offset += pos[i] * file_stride;
+            file_stride *= header.extents[i];
+            im_offset += (int64_t) (pos[i] - im->dim(i).min()) * im->dim(i).stride();
+        }
+        uint8_t *row = (uint8_t *) im->data() + im_offset * elem_size;
+        if (!check(seek_file(f.f, (int64_t) header.data_offset + file_offset * elem_size) == 0,
+                   "Could not seek in .npy file")) {
+            return false;
+        }
+        bool ok;
+        if (row_is_dense) {
+            ok = writing ? f.write_bytes(row, (size_t) row_elems * elem_size) :
+                           f.read_bytes(row, (size_t) row_elems * elem_size);
+        } else if (writing) {
+            for (int x = 0; x < row_elems; x++) {
+                memcpy(&scratch[(size_t) x * elem_size], row + x * stride_bytes, elem_size);
+            }
+            ok = f.write_vector(scratch);
+        } else {
+            ok = f.read_vector(&scratch);
+            for (int x = 0; ok && x < row_elems; x++) {
+                memcpy(row + x * stride_bytes, &scratch[(size_t) x * elem_size], elem_size);
+            }
+        }
+        if (!check(ok, writing ? "Could not write .npy payload" : "Could not read .npy payload")) {
+            return false;
+        }
+
+        // Advance to the next row.
+        int d = 1;
+        while (d < im->dimensions() && pos[d] == im->dim(d).max()) {
+            pos[d] = im->dim(d).min();
+            d++;
+        }
+        if (d >= im->dimensions()) {
+            break;
+        }
+        pos[d]++;
+    }
+    return true;
+}
+
+}  // namespace Internal
+
+// Fill an already-allocated image with the corresponding region of the
+// array stored in a .npy file, reading only the parts of the file that
+// the region covers. The image's mins and extents select the region,
+// in the same dimension order load() would produce. This allows
+// streaming an array that is too large to hold in memory through a
+// series of tiles. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_npy_region(const std::string &filename, ImageType *im) {
+    im->copy_to_host();
+    if (!Internal::transfer_npy_region<ImageType, check>(filename, im, false)) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+// The inverse of load_npy_region(): overwrite the region of the array in
+// an existing .npy file that the image covers with the image's contents,
+// leaving the rest of the file alone. Use create_npy() to make a file of
+// the right type and shape to stream tiles into. Returns false upon
+// failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_npy_region(ImageType &im, const std::string &filename) {
+    im.copy_to_host();
+    return Internal::transfer_npy_region<ImageType, check>(filename, &im, true);
+}
+
+// Create a .npy file holding a zero-filled array of the given type and
+// extents (in Halide's dimension order). On most filesystems the payload
+// is left sparse, so this is cheap even for very large arrays. Returns
+// false upon failure.
+template<Internal::CheckFunc check = Internal::CheckReturn>
+bool create_npy(const std::string &filename, halide_type_t type, const std::vector<int> &extents) {
+    std::string header;
+    if (!Internal::make_npy_header<check>(type, extents, &header)) {
+        return false;
+    }
+    int64_t payload_bytes = type.bytes();
+    for (int e : extents) {
+        payload_bytes *= e;
+    }
+
+    Internal::FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!check(f.write_bytes(header.data(), header.size()), "Could not write .npy header")) {
+        return false;
+    }
+    if (payload_bytes > 0) {
+        // Extend the file by writing its last byte.
+        const uint8_t zero = 0;
+        if (!check(Internal::seek_file(f.f, (int64_t) header.size() + payload_bytes - 1) == 0 &&
+                   f.write_bytes(&zero, 1), "Could not write .npy payload")) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //
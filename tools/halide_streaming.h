@@ -0,0 +1,316 @@
+// This header defines a driver that runs a compiled Halide pipeline over
+// inputs and outputs that are too large to hold in memory, one output
+// tile at a time.
+//
+// For each output tile, the pipeline is first called in bounds-query
+// mode to find the region of each input it needs. Those regions are
+// then read from the inputs, the pipeline is run on the tile, and the
+// tile is handed to the output. While one tile is being computed, the
+// inputs for the next one are read and the previous output tile is
+// written, so I/O overlaps with compute. At most three tiles are live
+// at once: the inputs and output of the tile being computed and of the
+// next tile, plus the output of the previous tile while it is written.
+// So peak memory is bounded by the tile size rather than the image size.
+//
+// Inputs and outputs are described by a type, a shape, and a function
+// to read or write an arbitrary region; wrappers for in-memory (or
+// memory-mapped) buffers are provided. With halide_image_io.h, a .npy
+// file can be streamed in or out:
+//
+//    TileSource in {type, shape, [&](Runtime::Buffer<> &tile) {
+//        return load_npy_region(in_filename, &tile);
+//    }};
+//    create_npy(out_filename, out_type, out_extents);
+//    TileSink out {out_type, out_shape, [&](Runtime::Buffer<> &tile) {
+//        return save_npy_region(tile, out_filename);
+//    }};
+//
+// The pipeline can be anything that follows the bounds-query protocol
+// of a Halide AOT pipeline, e.g.
+//
+//    stream_tiles([&](const std::vector<halide_buffer_t *> &inputs, halide_buffer_t *output) {
+//        return my_pipeline(inputs[0], some_param, output);
+//    }, {in}, out, {1024, 1024});
+//
+// Note that the pipeline must not read outside the bounds of the full
+// input, as there is nothing to read there. A pipeline that clamps its
+// accesses to the bounds of its input buffer (e.g. via a
+// BoundaryConditions function) works, because the bounds query is
+// made with the full shape of each input.
+
+#ifndef HALIDE_STREAMING_H
+#define HALIDE_STREAMING_H
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+// An input to stream_tiles(). 'shape' gives the full bounds of the input
+// (only the mins and extents are used). 'read' must fill in the region
+// covered by the already-allocated buffer passed to it, returning false
+// upon failure.
+struct TileSource {
+    halide_type_t type;
+    std::vector<halide_dimension_t> shape;
+    std::function<bool(Runtime::Buffer<> &tile)> read;
+};
+
+// The output of stream_tiles(). 'write' is called once for each tile of
+// 'shape', with a buffer covering exactly that tile, and must store it,
+// returning false upon failure.
+struct TileSink {
+    halide_type_t type;
+    std::vector<halide_dimension_t> shape;
+    std::function<bool(Runtime::Buffer<> &tile)> write;
+};
+
+namespace Internal {
+
+inline std::vector<halide_dimension_t> get_shape(const Runtime::Buffer<> &b) {
+    std::vector<halide_dimension_t> shape(b.dimensions());
+    for (int i = 0; i < b.dimensions(); i++) {
+        shape[i] = b.raw_buffer()->dim[i];
+    }
+    return shape;
+}
+
+// Replace the strides of a shape with dense ones that keep the
+// dimensions in the same order in memory. Ties (e.g. the zero strides
+// of a shape no one has constrained) keep the dimensions in planar
+// order.
+inline void make_dense(std::vector<halide_dimension_t> *shape) {
+    std::vector<int> order(shape->size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = (int) i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return (*shape)[a].stride < (*shape)[b].stride;
+    });
+    int32_t stride = 1;
+    for (int i : order) {
+        (*shape)[i].stride = stride;
+        stride *= (*shape)[i].extent;
+    }
+}
+
+inline Runtime::Buffer<> allocate_dense(halide_type_t type, std::vector<halide_dimension_t> shape) {
+    make_dense(&shape);
+    Runtime::Buffer<> b(type, nullptr, (int) shape.size(), shape.data());
+    b.allocate();
+    return b;
+}
+
+// The buffers for one output tile.
+struct StreamingTile {
+    // The region of the output this tile covers.
+    std::vector<halide_dimension_t> region;
+    std::vector<Runtime::Buffer<>> inputs;
+    // Possibly larger than the region, if the pipeline constrains the
+    // shape of its output.
+    Runtime::Buffer<> output;
+};
+
+inline std::vector<halide_buffer_t *> raw_buffers(std::vector<Runtime::Buffer<>> &buffers) {
+    std::vector<halide_buffer_t *> raw(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        raw[i] = buffers[i].raw_buffer();
+    }
+    return raw;
+}
+
+// Run a bounds query for the given output region, and allocate (but
+// don't fill in) the buffers to compute it. Returns zero on success,
+// or an error code.
+template<typename Fn>
+int prepare_tile(Fn &pipeline, const std::vector<TileSource> &inputs, const TileSink &output,
+                 const std::vector<halide_dimension_t> &region, StreamingTile *tile) {
+    // Start from the full shape of each input, so that pipelines that
+    // clamp to the bounds of their inputs ask for the right region.
+    std::vector<Runtime::Buffer<>> query(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::vector<halide_dimension_t> shape = inputs[i].shape;
+        for (auto &d : shape) {
+            d.stride = 0;
+        }
+        make_dense(&shape);
+        query[i] = Runtime::Buffer<>(inputs[i].type, nullptr, (int) shape.size(), shape.data());
+    }
+    std::vector<halide_dimension_t> out_shape = region;
+    make_dense(&out_shape);
+    Runtime::Buffer<> out_query(output.type, nullptr, (int) out_shape.size(), out_shape.data());
+
+    std::vector<halide_buffer_t *> raw = raw_buffers(query);
+    int result = pipeline(raw, out_query.raw_buffer());
+    if (result != 0) {
+        return result;
+    }
+
+    tile->region = region;
+    tile->inputs.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::vector<halide_dimension_t> shape = get_shape(query[i]);
+        for (size_t d = 0; d < shape.size(); d++) {
+            const halide_dimension_t &full = inputs[i].shape[d];
+            if (shape[d].min < full.min || shape[d].min + shape[d].extent > full.min + full.extent) {
+                return halide_error_code_access_out_of_bounds;
+            }
+        }
+        tile->inputs[i] = allocate_dense(inputs[i].type, shape);
+    }
+    tile->output = allocate_dense(output.type, get_shape(out_query));
+    return 0;
+}
+
+inline bool read_tile(const std::vector<TileSource> &inputs, StreamingTile *tile) {
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (!inputs[i].read(tile->inputs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool write_tile(const TileSink &output, const std::vector<halide_dimension_t> &region,
+                       Runtime::Buffer<> tile_output) {
+    for (size_t d = 0; d < region.size(); d++) {
+        tile_output.crop((int) d, region[d].min, region[d].extent);
+    }
+    return output.write(tile_output);
+}
+
+}  // namespace Internal
+
+// Make a TileSource that copies regions out of an in-memory buffer,
+// e.g. one returned by load_mapped().
+inline TileSource buffer_tile_source(Runtime::Buffer<> buf) {
+    return {buf.type(), Internal::get_shape(buf), [buf](Runtime::Buffer<> &tile) {
+        tile.copy_from(buf);
+        return true;
+    }};
+}
+
+// Make a TileSink that copies tiles into an in-memory buffer.
+inline TileSink buffer_tile_sink(Runtime::Buffer<> buf) {
+    return {buf.type(), Internal::get_shape(buf), [buf](Runtime::Buffer<> &tile) mutable {
+        buf.copy_from(tile);
+        return true;
+    }};
+}
+
+// Compute 'output' by calling 'pipeline' once per tile of the given
+// extents (clamped at the edges of the output), reading inputs and
+// writing outputs one tile at a time. 'pipeline' is called as
+// pipeline(const std::vector<halide_buffer_t *> &inputs, halide_buffer_t *output),
+// with inputs in the same order as 'inputs', and must return zero on
+// success. Tiles are visited with dimension 0 innermost. If 'prefetch'
+// is true, the inputs of the next tile are read and the previous output
+// tile is written on other threads while each tile is computed, so up to
+// three tiles are live at once (see above): size the tiles accordingly.
+//
+// Returns zero on success. Otherwise returns the error code from the
+// pipeline, halide_error_code_access_out_of_bounds if the pipeline needs
+// part of an input outside of its shape, or
+// halide_error_code_generic_error if reading or writing a tile fails.
+template<typename Fn>
+int stream_tiles(Fn &&pipeline, const std::vector<TileSource> &inputs, const TileSink &output,
+                 const std::vector<int> &tile_extents, bool prefetch = true) {
+    const int dims = (int) output.shape.size();
+
+    // Enumerate the output tiles.
+    std::vector<std::vector<halide_dimension_t>> regions;
+    std::vector<int> pos(dims);
+    for (int d = 0; d < dims; d++) {
+        if (output.shape[d].extent <= 0) {
+            return 0;
+        }
+        pos[d] = output.shape[d].min;
+    }
+    while (true) {
+        std::vector<halide_dimension_t> region(dims);
+        for (int d = 0; d < dims; d++) {
+            const int max = output.shape[d].min + output.shape[d].extent;
+            const int extent = (size_t) d < tile_extents.size() && tile_extents[d] > 0 ?
+                                   tile_extents[d] : output.shape[d].extent;
+            region[d].min = pos[d];
+            region[d].extent = std::min(extent, max - pos[d]);
+        }
+        regions.push_back(region);
+
+        int d = 0;
+        while (d < dims && pos[d] + region[d].extent >= output.shape[d].min + output.shape[d].extent) {
+            pos[d] = output.shape[d].min;
+            d++;
+        }
+        if (d >= dims) {
+            break;
+        }
+        pos[d] += region[d].extent;
+    }
+
+    const std::launch policy = prefetch ? std::launch::async : std::launch::deferred;
+
+    Internal::StreamingTile current;
+    int result = Internal::prepare_tile(pipeline, inputs, output, regions[0], &current);
+    if (result != 0) {
+        return result;
+    }
+    if (!Internal::read_tile(inputs, &current)) {
+        return halide_error_code_generic_error;
+    }
+
+    std::future<bool> pending_write;
+    for (size_t t = 0; t < regions.size(); t++) {
+        // Start reading the inputs for the next tile.
+        Internal::StreamingTile next;
+        std::future<bool> pending_read;
+        if (t + 1 < regions.size()) {
+            result = Internal::prepare_tile(pipeline, inputs, output, regions[t + 1], &next);
+            if (result != 0) {
+                return result;
+            }
+            pending_read = std::async(policy, [&inputs, &next]() {
+                return Internal::read_tile(inputs, &next);
+            });
+        }
+
+        std::vector<halide_buffer_t *> raw = Internal::raw_buffers(current.inputs);
+        result = pipeline(raw, current.output.raw_buffer());
+        if (result != 0) {
+            return result;
+        }
+
+        // Only one write is in flight at a time, so that at most one
+        // previous output tile is live. The write holds on to the output
+        // only, so the inputs of this tile are freed once the next one
+        // takes its place.
+        if (pending_write.valid() && !pending_write.get()) {
+            return halide_error_code_generic_error;
+        }
+        pending_write = std::async(policy, [&output](std::vector<halide_dimension_t> region,
+                                                     Runtime::Buffer<> tile_output) {
+            return Internal::write_tile(output, region, std::move(tile_output));
+        }, current.region, current.output);
+
+        if (pending_read.valid()) {
+            if (!pending_read.get()) {
+                return halide_error_code_generic_error;
+            }
+            current = std::move(next);
+        }
+    }
+    if (!pending_write.get()) {
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_STREAMING_H